@@ -0,0 +1,122 @@
+/**
+ * Compares the hit rate of each `LucuCachePolicy` on Zipfian traffic
+ * mixed with scans over keys that are only ever used once.
+ *
+ * Only hits on Zipfian keys are counted, since scan keys can never hit.
+ */
+#include "lucu/cache.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define KEY_SPACE 100000
+#define CACHE_SIZE 1000
+#define REQUESTS 2000000
+#define SCAN_LENGTH 5000
+#define ZIPF_EXPONENT 0.99
+
+static long misses;
+
+static bool equal(void* key_1, void* key_2, void* p) {
+	(void)p;
+	return *(int*)key_1 == *(int*)key_2;
+}
+
+static size_t hash(void* key, void* p) {
+	(void)p;
+	// Fibonacci hashing, so sequential keys don't fill neighbouring index slots.
+	return (size_t)((uint64_t)(uint32_t)*(int*)key * 11400714819323198485ull >> 16);
+}
+
+static void* generate(void* key) {
+	misses++;
+	return key;
+}
+
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static int zipf_sample(const double* cdf, uint64_t* state) {
+	const double u = (double)(next_random(state) >> 11) / (double)(1ull << 53);
+	int low = 0;
+	int high = KEY_SPACE - 1;
+	while (low < high) {
+		const int middle = (low + high) / 2;
+		if (cdf[middle] < u) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+static double run(const LucuCachePolicy policy, const double scan_fraction, const double* cdf, int* keys) {
+	LucuCache cache = lucu_cache_new_with_policy(policy, CACHE_SIZE, hash, equal, NULL, generate, NULL, NULL);
+	uint64_t state = 88172645463325252ull;
+	int next_scan_key = KEY_SPACE;
+	long zipf_requests = 0;
+	long zipf_misses = 0;
+	// Chance of starting a scan instead of a single Zipfian request, so that
+	// `scan_fraction` of all requests end up being part of a scan.
+	const double scan_probability = scan_fraction / (SCAN_LENGTH * (1.0 - scan_fraction) + scan_fraction);
+
+	for (long i = 0; i < REQUESTS;) {
+		const double u = (double)(next_random(&state) >> 11) / (double)(1ull << 53);
+		if (u < scan_probability) {
+			for (int j = 0; j < SCAN_LENGTH && i < REQUESTS; j++, i++) {
+				lucu_cache_get(cache, &keys[next_scan_key++]);
+			}
+		} else {
+			const long before = misses;
+			lucu_cache_get(cache, &keys[zipf_sample(cdf, &state)]);
+			zipf_misses += misses - before;
+			zipf_requests++;
+			i++;
+		}
+	}
+
+	lucu_cache_destroy(cache);
+	return 1.0 - (double)zipf_misses / (double)zipf_requests;
+}
+
+int main(void) {
+	double* cdf = malloc(sizeof(double) * KEY_SPACE);
+	double total = 0;
+	for (int i = 0; i < KEY_SPACE; i++) {
+		total += 1.0 / pow((double)(i + 1), ZIPF_EXPONENT);
+		cdf[i] = total;
+	}
+	for (int i = 0; i < KEY_SPACE; i++) {
+		cdf[i] /= total;
+	}
+
+	int* keys = malloc(sizeof(int) * (KEY_SPACE + REQUESTS));
+	for (int i = 0; i < KEY_SPACE + REQUESTS; i++) {
+		keys[i] = i;
+	}
+
+	const char* names[] = {
+		[LUCU_CACHE_FIFO] = "fifo",
+		[LUCU_CACHE_LRU] = "lru",
+		[LUCU_CACHE_CLOCK] = "clock",
+		[LUCU_CACHE_S3FIFO] = "s3fifo",
+	};
+	const double scan_fractions[] = {0.0, 0.1, 0.3, 0.5};
+
+	printf("policy,scan_fraction,zipf_hit_rate\n");
+	for (int policy = LUCU_CACHE_FIFO; policy <= LUCU_CACHE_S3FIFO; policy++) {
+		for (size_t i = 0; i < sizeof(scan_fractions) / sizeof(scan_fractions[0]); i++) {
+			const double hit_rate = run((LucuCachePolicy)policy, scan_fractions[i], cdf, keys);
+			printf("%s,%.2f,%.4f\n", names[policy], scan_fractions[i], hit_rate);
+		}
+	}
+
+	free(keys);
+	free(cdf);
+	return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * Measures how `lucu_concurrent_cache_get` throughput scales with threads.
+ *
+ * Every thread does the same number of gets over a key space that
+ * mostly fits in the cache, so a perfectly scaling cache would show
+ * throughput rising linearly with the number of threads.
+ */
+#include "lucu/concurrent_cache.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define KEY_SPACE 100000
+#define CACHE_SIZE 65536
+#define GETS_PER_THREAD 2000000
+#define MAX_THREADS 16
+
+static int keys[KEY_SPACE];
+
+static bool equal(void* key_1, void* key_2, void* p) {
+	(void)p;
+	return *(int*)key_1 == *(int*)key_2;
+}
+
+static size_t hash(void* key, void* p) {
+	(void)p;
+	return (size_t)((uint64_t)(uint32_t)*(int*)key * 11400714819323198485ull >> 16);
+}
+
+static void* generate(void* key) {
+	return key;
+}
+
+typedef struct Worker {
+	pthread_t thread;
+	LucuConcurrentCache cache;
+	uint64_t seed;
+} Worker;
+
+static void* work(void* params) {
+	Worker* worker = params;
+	uint64_t state = worker->seed;
+	for (int i = 0; i < GETS_PER_THREAD; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		// Squaring skews traffic towards low keys, most of which stay cached.
+		const uint64_t r = state % 1000;
+		lucu_concurrent_cache_get(worker->cache, &keys[(r * r * KEY_SPACE / 1000000) % KEY_SPACE]);
+	}
+	return NULL;
+}
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+	for (int i = 0; i < KEY_SPACE; i++) {
+		keys[i] = i;
+	}
+
+	printf("threads,shards,gets_per_second\n");
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		const int shards = threads * 4;
+		LucuConcurrentCache cache = lucu_concurrent_cache_new(shards, LUCU_CACHE_CLOCK, CACHE_SIZE, hash, equal, NULL, generate, NULL, NULL);
+		Worker workers[MAX_THREADS];
+
+		const double start = now();
+		for (int i = 0; i < threads; i++) {
+			workers[i] = (Worker){ .cache = cache, .seed = 88172645463325252ull + (uint64_t)i * 7919 };
+			pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+		}
+		for (int i = 0; i < threads; i++) {
+			pthread_join(workers[i].thread, NULL);
+		}
+		const double elapsed = now() - start;
+
+		printf("%d,%d,%.0f\n", threads, shards, (double)threads * GETS_PER_THREAD / elapsed);
+		lucu_concurrent_cache_destroy(cache);
+	}
+
+	return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * Measures a priority queue built with `LucuHeap` against one built by
+ * inserting into a sorted `LucuVector`, pushing random elements and then
+ * popping them all.
+ */
+#include "lucu/heap.h"
+#include "lucu/vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool less(void* a, void* b, void* params) {
+	(void)params;
+	return *(int*)a < *(int*)b;
+}
+
+static int next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (int)(*state >> 33);
+}
+
+static void run(const int length) {
+	volatile int64_t sink = 0;
+	uint64_t state = 88172645463325252ull;
+	int* values = malloc(sizeof(int) * (size_t)length);
+	for (int i = 0; i < length; i++) {
+		values[i] = next_random(&state);
+	}
+
+	LucuHeap heap = lucu_heap_new(sizeof(int), NULL, less, NULL);
+	double start = now();
+	for (int i = 0; i < length; i++) {
+		lucu_heap_push(heap, &values[i]);
+	}
+	const double push = now() - start;
+	start = now();
+	int x;
+	while (lucu_heap_pop_into(heap, &x)) {
+		sink += x;
+	}
+	const double pop = now() - start;
+	lucu_heap_destroy(heap);
+	printf("heap,%d,push,%.3f\n", length, push * 1e9 / length);
+	printf("heap,%d,pop,%.3f\n", length, pop * 1e9 / length);
+
+	start = now();
+	heap = lucu_heap_from_vector(lucu_vector_from_array(values, length, sizeof(int), NULL), less, NULL);
+	printf("heap,%d,from_vector,%.3f\n", length, (now() - start) * 1e9 / length);
+	lucu_heap_destroy(heap);
+
+	if (length <= 10000) {
+		LucuVector vector = lucu_vector_new(sizeof(int), NULL);
+		start = now();
+		for (int i = 0; i < length; i++) {
+			int low = 0;
+			int high = lucu_vector_length(vector);
+			while (low < high) {
+				const int middle = (low + high) / 2;
+				if (*(int*)lucu_vector_get(vector, middle) < values[i]) {
+					low = middle + 1;
+				} else {
+					high = middle;
+				}
+			}
+			lucu_vector_insert(vector, &values[i], low);
+		}
+		const double insert = now() - start;
+		start = now();
+		while (lucu_vector_pop_front_into(vector, &x)) {
+			sink += x;
+		}
+		const double pop_front = now() - start;
+		lucu_vector_destroy(vector);
+		printf("sorted_vector,%d,push,%.3f\n", length, insert * 1e9 / length);
+		printf("sorted_vector,%d,pop,%.3f\n", length, pop_front * 1e9 / length);
+	}
+
+	free(values);
+}
+
+int main(void) {
+	printf("queue,length,operation,ns_per_element\n");
+	run(1000);
+	run(10000);
+	run(1000000);
+	return 0;
+}
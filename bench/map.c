@@ -0,0 +1,89 @@
+/**
+ * Measures `LucuMap` inserts and lookups of keys that are and aren't in
+ * the map, for a range of sizes, against a linear `lucu_vector_index`
+ * scan for the smallest size.
+ */
+#include "lucu/map.h"
+#include "lucu/vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define OPERATIONS (1 << 22)
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static size_t hash(void* key, void* params) {
+	(void)params;
+	return (size_t)*(uint64_t*)key;
+}
+
+static bool equal(void* a, void* b, void* params) {
+	(void)params;
+	return *(uint64_t*)a == *(uint64_t*)b;
+}
+
+static uint64_t xorshift(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void run(const int length) {
+	volatile int64_t sink = 0;
+	// Keys are odd, so even keys are never in the map.
+	uint64_t* keys = malloc(sizeof(uint64_t) * (size_t)length);
+	uint64_t state = 88172645463325252ull;
+	for (int i = 0; i < length; i++) {
+		keys[i] = xorshift(&state) | 1;
+	}
+
+	LucuMap map = lucu_map_new(sizeof(uint64_t), sizeof(uint64_t), hash, equal, NULL, NULL, NULL);
+	double start = now();
+	for (int i = 0; i < length; i++) {
+		lucu_map_insert(map, &keys[i], &keys[i]);
+	}
+	printf("map,%d,insert,%.3f\n", length, (now() - start) * 1e9 / length);
+
+	int64_t sum = 0;
+	start = now();
+	for (int i = 0; i < OPERATIONS; i++) {
+		sum += *(int64_t*)lucu_map_get(map, &keys[xorshift(&state) % (uint64_t)length]);
+	}
+	printf("map,%d,get_hit,%.3f\n", length, (now() - start) * 1e9 / OPERATIONS);
+
+	start = now();
+	for (int i = 0; i < OPERATIONS; i++) {
+		const uint64_t key = xorshift(&state) & ~(uint64_t)1;
+		sum += lucu_map_get(map, &key) != NULL;
+	}
+	printf("map,%d,get_miss,%.3f\n", length, (now() - start) * 1e9 / OPERATIONS);
+	lucu_map_destroy(map);
+
+	if (length <= 1000) {
+		LucuVector vector = lucu_vector_from_array(keys, length, sizeof(uint64_t), NULL);
+		start = now();
+		for (int i = 0; i < OPERATIONS / 64; i++) {
+			sum += lucu_vector_index(vector, &keys[xorshift(&state) % (uint64_t)length], equal, NULL);
+		}
+		printf("vector_index,%d,get_hit,%.3f\n", length, (now() - start) * 1e9 / (OPERATIONS / 64));
+		lucu_vector_destroy(vector);
+	}
+
+	sink += sum;
+	(void)sink;
+	free(keys);
+}
+
+int main(void) {
+	printf("container,length,operation,ns_per_operation\n");
+	run(1000);
+	run(100000);
+	run(1000000);
+	return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * Measures throughput of passing 32 byte records between threads through
+ * `LucuSpscQueue`, `LucuMpmcQueue` and a `LucuVector` guarded by a mutex,
+ * one element at a time and in batches.
+ */
+#include "lucu/queue.h"
+#include "lucu/vector.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define RECORDS (1 << 22)
+#define CAPACITY 1024
+#define BATCH 32
+
+typedef struct Record {
+	int64_t fields[4];
+} Record;
+
+typedef enum Kind {
+	SPSC,
+	MPMC,
+	MUTEX_VECTOR,
+} Kind;
+
+static const char* kind_names[] = {"spsc", "mpmc", "mutex_vector"};
+
+typedef struct Bench {
+	Kind kind;
+	int batch;
+	/// Number of producer and of consumer threads.
+	int threads;
+	LucuSpscQueue spsc;
+	LucuMpmcQueue mpmc;
+	LucuVector vector;
+	pthread_mutex_t lock;
+} Bench;
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int push(Bench* bench, const Record* records, const int length) {
+	switch (bench->kind) {
+	case SPSC:
+		return lucu_spsc_queue_enqueue_batch(bench->spsc, records, length);
+	case MPMC:
+		return lucu_mpmc_queue_enqueue_batch(bench->mpmc, records, length);
+	case MUTEX_VECTOR:
+		pthread_mutex_lock(&bench->lock);
+		const int free_slots = CAPACITY - lucu_vector_length(bench->vector);
+		const int n = free_slots < length ? free_slots : length;
+		if (n > 0) {
+			lucu_vector_append(bench->vector, records, n);
+		}
+		pthread_mutex_unlock(&bench->lock);
+		return n;
+	}
+	return 0;
+}
+
+static int pop(Bench* bench, Record* records, const int length) {
+	switch (bench->kind) {
+	case SPSC:
+		return lucu_spsc_queue_dequeue_batch(bench->spsc, records, length);
+	case MPMC:
+		return lucu_mpmc_queue_dequeue_batch(bench->mpmc, records, length);
+	case MUTEX_VECTOR:
+		pthread_mutex_lock(&bench->lock);
+		int n = 0;
+		while (n < length && lucu_vector_dequeue_into(bench->vector, &records[n])) {
+			n++;
+		}
+		pthread_mutex_unlock(&bench->lock);
+		return n;
+	}
+	return 0;
+}
+
+static void* produce(void* params) {
+	Bench* bench = params;
+	Record records[BATCH] = {0};
+	for (int sent = 0; sent < RECORDS / bench->threads; ) {
+		const int n = push(bench, records, bench->batch);
+		if (n == 0) {
+			sched_yield();
+		}
+		sent += n;
+	}
+	return NULL;
+}
+
+static void* consume(void* params) {
+	Bench* bench = params;
+	Record records[BATCH];
+	for (int received = 0; received < RECORDS / bench->threads; ) {
+		const int n = pop(bench, records, bench->batch);
+		if (n == 0) {
+			sched_yield();
+		}
+		received += n;
+	}
+	return NULL;
+}
+
+static void run(const Kind kind, const int batch, const int threads) {
+	Bench bench = {.kind = kind, .batch = batch, .threads = threads};
+	bench.spsc = lucu_spsc_queue_new(CAPACITY, sizeof(Record));
+	bench.mpmc = lucu_mpmc_queue_new(CAPACITY, sizeof(Record));
+	bench.vector = lucu_vector_new_with_size(CAPACITY, sizeof(Record), NULL);
+	pthread_mutex_init(&bench.lock, NULL);
+
+	pthread_t producers[4];
+	pthread_t consumers[4];
+	const double start = now();
+	for (int i = 0; i < threads; i++) {
+		pthread_create(&producers[i], NULL, produce, &bench);
+		pthread_create(&consumers[i], NULL, consume, &bench);
+	}
+	for (int i = 0; i < threads; i++) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+	}
+	const double seconds = now() - start;
+	printf("%s,%d,%d,%.3f\n", kind_names[kind], threads, batch, RECORDS / seconds / 1e6);
+
+	pthread_mutex_destroy(&bench.lock);
+	lucu_vector_destroy(bench.vector);
+	lucu_mpmc_queue_destroy(bench.mpmc);
+	lucu_spsc_queue_destroy(bench.spsc);
+}
+
+int main(void) {
+	printf("queue,threads,batch,million_records_per_second\n");
+	for (int batch = 1; batch <= BATCH; batch *= BATCH) {
+		run(SPSC, batch, 1);
+		run(MPMC, batch, 1);
+		run(MUTEX_VECTOR, batch, 1);
+		run(MPMC, batch, 4);
+		run(MUTEX_VECTOR, batch, 4);
+	}
+	return 0;
+}
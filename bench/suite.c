@@ -0,0 +1,665 @@
+/**
+ * Times the hot paths of the library so that changes can be checked for
+ * performance regressions.
+ *
+ * Every benchmark is run several times and the fastest run is reported, in
+ * nanoseconds per operation, as CSV or JSON. Results can be saved and later
+ * compared against:
+ *
+ * ```sh
+ * ./bench/bench_suite --save baseline.csv
+ * # change something and rebuild
+ * ./bench/bench_suite --baseline baseline.csv
+ * ```
+ *
+ * When comparing, every benchmark that got more than `--threshold` percent
+ * slower is marked as `slower` and the exit status is 1.
+ *
+ * Options:
+ * - `--format csv|json`: output format, CSV by default.
+ * - `--filter TEXT`: only run benchmarks whose name contains `TEXT`.
+ * - `--repeat N`: number of runs of each benchmark, 5 by default.
+ * - `--save FILE`: also write the results to `FILE` as CSV.
+ * - `--baseline FILE`: compare against results saved with `--save`.
+ * - `--threshold PERCENT`: allowed change before a result counts as slower
+ *   or faster, 10 by default.
+ */
+#include "lucu/cache.h"
+#include "lucu/heap.h"
+#include "lucu/map.h"
+#include "lucu/option.h"
+#include "lucu/vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/// Length of the vectors most vector benchmarks run on.
+#define VECTOR_LENGTH (1 << 16)
+/// Number of elements inserted and then removed by the insert and remove benchmarks.
+#define EDITS (1 << 10)
+#define GETS (1 << 22)
+#define CACHE_SIZE 1024
+/// Keys per `lucu_cache_get_batch` call. Divides `GETS / 4`.
+#define CACHE_BATCH 32
+#define MAX_BENCHMARKS 128
+#define MAX_NAME 64
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/// Keeps the compiler from optimizing the benchmarks away.
+static volatile int64_t sink;
+
+static bool int_less(void* a, void* b, void* params) {
+	(void)params;
+	return *(int*)a < *(int*)b;
+}
+
+static bool int_equal(void* a, void* b, void* params) {
+	(void)params;
+	return *(int*)a == *(int*)b;
+}
+
+static size_t int_hash(void* key, void* params) {
+	(void)params;
+	return (size_t)((uint64_t)(uint32_t)*(int*)key * 11400714819323198485ull >> 16);
+}
+
+static bool key_less(void* a, void* b, void* params) {
+	(void)params;
+	return *(uint32_t*)a < *(uint32_t*)b;
+}
+
+static LucuVector filled_vector(const int length) {
+	LucuVector vector = lucu_vector_new(sizeof(int), NULL);
+	for (int i = 0; i < length; i++) {
+		lucu_vector_push_back(vector, &i);
+	}
+	return vector;
+}
+
+static double vector_push_back(void) {
+	LucuVector vector = lucu_vector_new(sizeof(int), NULL);
+	const double start = now();
+	for (int i = 0; i < VECTOR_LENGTH; i++) {
+		lucu_vector_push_back(vector, &i);
+	}
+	const double elapsed = now() - start;
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+static double vector_push_front(void) {
+	LucuVector vector = lucu_vector_new(sizeof(int), NULL);
+	const double start = now();
+	for (int i = 0; i < VECTOR_LENGTH; i++) {
+		lucu_vector_push_front(vector, &i);
+	}
+	const double elapsed = now() - start;
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+static double vector_pop(const bool front) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	int64_t sum = 0;
+	int x;
+	const double start = now();
+	for (int i = 0; i < VECTOR_LENGTH; i++) {
+		if (front) {
+			lucu_vector_pop_front_into(vector, &x);
+		} else {
+			lucu_vector_pop_back_into(vector, &x);
+		}
+		sum += x;
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+static double vector_pop_back(void) {
+	return vector_pop(false);
+}
+
+static double vector_pop_front(void) {
+	return vector_pop(true);
+}
+
+static double vector_get_random(void) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	const double start = now();
+	for (int i = 0; i < GETS; i++) {
+		sum += *(int*)lucu_vector_get(vector, (int)(next_random(&state) % VECTOR_LENGTH));
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_vector_destroy(vector);
+	return elapsed / GETS;
+}
+
+/**
+ * Times inserting `EDITS` elements one at a time at `position` (0 for
+ * the front, 1 for the middle, 2 for the back), or removing them again.
+ */
+static double vector_edit(const int position, const bool insert) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	double elapsed = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		const bool inserting = pass == 0;
+		const double start = now();
+		for (int i = 0; i < EDITS; i++) {
+			const int length = lucu_vector_length(vector);
+			const int index = position == 0 ? 0 : position == 1 ? length / 2 : inserting ? length : length - 1;
+			if (inserting) {
+				lucu_vector_insert(vector, &i, index);
+			} else {
+				lucu_vector_remove(vector, index);
+			}
+		}
+		if (inserting == insert) {
+			elapsed = now() - start;
+		}
+	}
+	lucu_vector_destroy(vector);
+	return elapsed / EDITS;
+}
+
+static double vector_insert_front(void) {
+	return vector_edit(0, true);
+}
+
+static double vector_insert_middle(void) {
+	return vector_edit(1, true);
+}
+
+static double vector_insert_back(void) {
+	return vector_edit(2, true);
+}
+
+static double vector_remove_front(void) {
+	return vector_edit(0, false);
+}
+
+static double vector_remove_middle(void) {
+	return vector_edit(1, false);
+}
+
+static double vector_remove_back(void) {
+	return vector_edit(2, false);
+}
+
+static bool add_to_sum(void* element, void* sum) {
+	*(int64_t*)sum += *(int*)element;
+	return false;
+}
+
+static bool is_even(void* element, void* params) {
+	(void)params;
+	return *(int*)element % 2 == 0;
+}
+
+static void* to_double(void* element, void* params) {
+	static double result;
+	(void)params;
+	result = *(int*)element;
+	return &result;
+}
+
+static double vector_iterate(void) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	int64_t sum = 0;
+	const double start = now();
+	lucu_vector_iterate(vector, add_to_sum, &sum);
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+static double vector_filter(void) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	const double start = now();
+	LucuVector filtered = lucu_vector_filter(vector, is_even, NULL);
+	const double elapsed = now() - start;
+	sink += lucu_vector_length(filtered);
+	lucu_vector_destroy(filtered);
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+static double vector_map(void) {
+	LucuVector vector = filled_vector(VECTOR_LENGTH);
+	const double start = now();
+	LucuVector mapped = lucu_vector_map(vector, sizeof(double), NULL, to_double, NULL, NULL);
+	const double elapsed = now() - start;
+	sink += lucu_vector_length(mapped);
+	lucu_vector_destroy(mapped);
+	lucu_vector_destroy(vector);
+	return elapsed / VECTOR_LENGTH;
+}
+
+/**
+ * Times sorting `length` random elements of `bytewidth` bytes, each
+ * starting with a `uint32_t` key.
+ */
+static double vector_sort(const int length, const size_t bytewidth) {
+	LucuVector vector = lucu_vector_new_with_size(length, bytewidth, NULL);
+	unsigned char element[64] = {0};
+	uint64_t state = 88172645463325252ull;
+	for (int i = 0; i < length; i++) {
+		const uint32_t key = (uint32_t)next_random(&state);
+		memcpy(element, &key, sizeof(key));
+		lucu_vector_push_back(vector, element);
+	}
+	const double start = now();
+	lucu_vector_sort(vector, key_less, NULL);
+	const double elapsed = now() - start;
+	lucu_vector_destroy(vector);
+	return elapsed / length;
+}
+
+static double vector_sort_1k_4(void) {
+	return vector_sort(1000, 4);
+}
+
+static double vector_sort_1k_16(void) {
+	return vector_sort(1000, 16);
+}
+
+static double vector_sort_1k_64(void) {
+	return vector_sort(1000, 64);
+}
+
+static double vector_sort_100k_4(void) {
+	return vector_sort(100000, 4);
+}
+
+static double vector_sort_100k_16(void) {
+	return vector_sort(100000, 16);
+}
+
+static double vector_sort_100k_64(void) {
+	return vector_sort(100000, 64);
+}
+
+static void* generate(void* key) {
+	return key;
+}
+
+/**
+ * Times `lucu_cache_get` on keys that are already cached, or on a scan
+ * over more keys than fit so that every get misses and evicts.
+ * @param stats 0 to not count `LucuCacheStats`, 1 to count and 2 to count and time.
+ */
+static double cache_get(const bool hit, const int stats) {
+	static int keys[CACHE_SIZE * 4];
+	for (int i = 0; i < CACHE_SIZE * 4; i++) {
+		keys[i] = i;
+	}
+	LucuCache cache = lucu_cache_new_hashed(CACHE_SIZE, int_hash, int_equal, NULL, generate, NULL, NULL);
+	if (stats > 0) {
+		lucu_cache_enable_stats(cache, stats == 2);
+	}
+	for (int i = 0; i < CACHE_SIZE; i++) {
+		lucu_cache_get(cache, &keys[i]);
+	}
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	const double start = now();
+	for (int i = 0; i < GETS / 4; i++) {
+		int* key = hit ? &keys[next_random(&state) % CACHE_SIZE] : &keys[(CACHE_SIZE + i) % (CACHE_SIZE * 4)];
+		sum += *(int*)lucu_cache_get(cache, key);
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_cache_destroy(cache);
+	return elapsed / (GETS / 4);
+}
+
+/**
+ * Like `cache_get`, but gets the same keys `CACHE_BATCH` at a time
+ * with `lucu_cache_get_batch`. Returns the time per key.
+ */
+static double cache_get_batch(const bool hit) {
+	static int keys[CACHE_SIZE * 4];
+	for (int i = 0; i < CACHE_SIZE * 4; i++) {
+		keys[i] = i;
+	}
+	LucuCache cache = lucu_cache_new_hashed(CACHE_SIZE, int_hash, int_equal, NULL, generate, NULL, NULL);
+	for (int i = 0; i < CACHE_SIZE; i++) {
+		lucu_cache_get(cache, &keys[i]);
+	}
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	void* batch[CACHE_BATCH];
+	void* values[CACHE_BATCH];
+	const double start = now();
+	for (int i = 0; i < GETS / 4; i += CACHE_BATCH) {
+		for (int j = 0; j < CACHE_BATCH; j++) {
+			batch[j] = hit ? &keys[next_random(&state) % CACHE_SIZE] : &keys[(CACHE_SIZE + i + j) % (CACHE_SIZE * 4)];
+		}
+		lucu_cache_get_batch(cache, batch, values, CACHE_BATCH, NULL, NULL);
+		for (int j = 0; j < CACHE_BATCH; j++) {
+			sum += *(int*)values[j];
+		}
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_cache_destroy(cache);
+	return elapsed / (GETS / 4);
+}
+
+static double cache_get_hit(void) {
+	return cache_get(true, 0);
+}
+
+static double cache_get_miss(void) {
+	return cache_get(false, 0);
+}
+
+static double cache_get_batch_hit(void) {
+	return cache_get_batch(true);
+}
+
+static double cache_get_batch_miss(void) {
+	return cache_get_batch(false);
+}
+
+static double cache_get_hit_counting(void) {
+	return cache_get(true, 1);
+}
+
+static double cache_get_hit_timing(void) {
+	return cache_get(true, 2);
+}
+
+static double option_new_some_take_destroy(void) {
+	int64_t data[2] = {1, 2};
+	int64_t out[2];
+	int64_t sum = 0;
+	const double start = now();
+	for (int i = 0; i < GETS / 4; i++) {
+		data[0] = i;
+		LucuOption option = lucu_option_new_some(data, sizeof(data));
+		lucu_option_take_into(option, out);
+		sum += out[0];
+		lucu_option_destroy(option);
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	return elapsed / (GETS / 4);
+}
+
+static double option_set_take(void) {
+	LucuOptionData storage;
+	LucuOption option = lucu_option_init_none(&storage);
+	int64_t data[2] = {1, 2};
+	int64_t out[2];
+	int64_t sum = 0;
+	const double start = now();
+	for (int i = 0; i < GETS; i++) {
+		data[0] = i;
+		lucu_option_set(option, data, sizeof(data));
+		lucu_option_take_into(option, out);
+		sum += out[0];
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	return elapsed / GETS;
+}
+
+static double map_get_hit(void) {
+	LucuMap map = lucu_map_new(sizeof(int), sizeof(int), int_hash, int_equal, NULL, NULL, NULL);
+	for (int i = 0; i < VECTOR_LENGTH; i++) {
+		lucu_map_insert(map, &i, &i);
+	}
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	const double start = now();
+	for (int i = 0; i < GETS; i++) {
+		const int key = (int)(next_random(&state) % VECTOR_LENGTH);
+		sum += *(int*)lucu_map_get(map, &key);
+	}
+	const double elapsed = now() - start;
+	sink += sum;
+	lucu_map_destroy(map);
+	return elapsed / GETS;
+}
+
+static double heap_push_pop(void) {
+	LucuHeap heap = lucu_heap_new(sizeof(int), NULL, int_less, NULL);
+	uint64_t state = 88172645463325252ull;
+	const double start = now();
+	for (int i = 0; i < VECTOR_LENGTH; i++) {
+		const int x = (int)(next_random(&state) >> 33);
+		lucu_heap_push(heap, &x);
+	}
+	int x;
+	while (lucu_heap_pop_into(heap, &x)) {
+		sink += x;
+	}
+	const double elapsed = now() - start;
+	lucu_heap_destroy(heap);
+	return elapsed / VECTOR_LENGTH;
+}
+
+typedef struct Benchmark {
+	const char* name;
+	/// Runs the benchmark once and returns the seconds per operation.
+	double (*run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+	{"vector/push_back", vector_push_back},
+	{"vector/push_front", vector_push_front},
+	{"vector/pop_back", vector_pop_back},
+	{"vector/pop_front", vector_pop_front},
+	{"vector/get_random", vector_get_random},
+	{"vector/insert_front", vector_insert_front},
+	{"vector/insert_middle", vector_insert_middle},
+	{"vector/insert_back", vector_insert_back},
+	{"vector/remove_front", vector_remove_front},
+	{"vector/remove_middle", vector_remove_middle},
+	{"vector/remove_back", vector_remove_back},
+	{"vector/iterate", vector_iterate},
+	{"vector/filter", vector_filter},
+	{"vector/map", vector_map},
+	{"vector/sort/1000x4", vector_sort_1k_4},
+	{"vector/sort/1000x16", vector_sort_1k_16},
+	{"vector/sort/1000x64", vector_sort_1k_64},
+	{"vector/sort/100000x4", vector_sort_100k_4},
+	{"vector/sort/100000x16", vector_sort_100k_16},
+	{"vector/sort/100000x64", vector_sort_100k_64},
+	{"cache/get_hit", cache_get_hit},
+	{"cache/get_miss", cache_get_miss},
+	{"cache/get_batch_hit", cache_get_batch_hit},
+	{"cache/get_batch_miss", cache_get_batch_miss},
+	{"cache/get_hit_counting", cache_get_hit_counting},
+	{"cache/get_hit_timing", cache_get_hit_timing},
+	{"option/new_some_take_destroy", option_new_some_take_destroy},
+	{"option/set_take", option_set_take},
+	{"map/get_hit", map_get_hit},
+	{"heap/push_pop", heap_push_pop},
+};
+
+typedef struct Result {
+	char name[MAX_NAME];
+	double ns_per_op;
+} Result;
+
+/**
+ * Reads results saved with `--save`.
+ * @return The number of results read, or -1 if `path` can't be opened.
+ */
+static int read_results(const char* path, Result* results) {
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		return -1;
+	}
+	char line[256];
+	int count = 0;
+	while (count < MAX_BENCHMARKS && fgets(line, sizeof(line), file) != NULL) {
+		char* comma = strchr(line, ',');
+		if (comma == NULL || comma - line >= MAX_NAME) {
+			continue;
+		}
+		char* end;
+		const double ns_per_op = strtod(comma + 1, &end);
+		if (end == comma + 1) {
+			// The header, or a malformed line.
+			continue;
+		}
+		memcpy(results[count].name, line, (size_t)(comma - line));
+		results[count].name[comma - line] = '\0';
+		results[count].ns_per_op = ns_per_op;
+		count++;
+	}
+	fclose(file);
+	return count;
+}
+
+static const Result* find_result(const Result* results, const int count, const char* name) {
+	for (int i = 0; i < count; i++) {
+		if (strcmp(results[i].name, name) == 0) {
+			return &results[i];
+		}
+	}
+	return NULL;
+}
+
+static int usage(const char* program) {
+	fprintf(stderr, "usage: %s [--format csv|json] [--filter TEXT] [--repeat N] [--save FILE] [--baseline FILE] [--threshold PERCENT]\n", program);
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	bool json = false;
+	const char* filter = NULL;
+	int repeat = 5;
+	const char* save_path = NULL;
+	const char* baseline_path = NULL;
+	double threshold = 10;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc) {
+			return usage(argv[0]);
+		}
+		if (strcmp(argv[i], "--format") == 0) {
+			i++;
+			if (strcmp(argv[i], "json") == 0) {
+				json = true;
+			} else if (strcmp(argv[i], "csv") == 0) {
+				json = false;
+			} else {
+				return usage(argv[0]);
+			}
+		} else if (strcmp(argv[i], "--filter") == 0) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "--repeat") == 0) {
+			repeat = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--save") == 0) {
+			save_path = argv[++i];
+		} else if (strcmp(argv[i], "--baseline") == 0) {
+			baseline_path = argv[++i];
+		} else if (strcmp(argv[i], "--threshold") == 0) {
+			threshold = atof(argv[++i]);
+		} else {
+			return usage(argv[0]);
+		}
+	}
+	if (repeat < 1) {
+		return usage(argv[0]);
+	}
+
+	static Result baseline[MAX_BENCHMARKS];
+	int baseline_count = 0;
+	if (baseline_path != NULL) {
+		baseline_count = read_results(baseline_path, baseline);
+		if (baseline_count < 0) {
+			fprintf(stderr, "%s: can't read baseline %s\n", argv[0], baseline_path);
+			return 2;
+		}
+	}
+	FILE* save = NULL;
+	if (save_path != NULL) {
+		save = fopen(save_path, "w");
+		if (save == NULL) {
+			fprintf(stderr, "%s: can't write %s\n", argv[0], save_path);
+			return 2;
+		}
+		fprintf(save, "name,ns_per_op\n");
+	}
+
+	if (json) {
+		printf("{\n  \"benchmarks\": [");
+	} else {
+		printf(baseline_path != NULL ? "name,ns_per_op,baseline_ns_per_op,change_percent,status\n" : "name,ns_per_op\n");
+	}
+	bool first = true;
+	int slower = 0;
+	for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+		const Benchmark* benchmark = &benchmarks[b];
+		if (filter != NULL && strstr(benchmark->name, filter) == NULL) {
+			continue;
+		}
+		double best = benchmark->run();
+		for (int r = 1; r < repeat; r++) {
+			const double seconds = benchmark->run();
+			best = seconds < best ? seconds : best;
+		}
+		const double ns_per_op = best * 1e9;
+		if (save != NULL) {
+			fprintf(save, "%s,%.3f\n", benchmark->name, ns_per_op);
+		}
+
+		const Result* old = find_result(baseline, baseline_count, benchmark->name);
+		const double change = old != NULL && old->ns_per_op > 0 ? (ns_per_op / old->ns_per_op - 1) * 100 : 0;
+		const char* status = old == NULL ? "new" : change > threshold ? "slower" : change < -threshold ? "faster" : "same";
+		slower += old != NULL && change > threshold;
+
+		if (json) {
+			printf("%s\n    {\"name\": \"%s\", \"ns_per_op\": %.3f", first ? "" : ",", benchmark->name, ns_per_op);
+			if (baseline_path != NULL && old != NULL) {
+				printf(", \"baseline_ns_per_op\": %.3f, \"change_percent\": %.1f", old->ns_per_op, change);
+			}
+			if (baseline_path != NULL) {
+				printf(", \"status\": \"%s\"", status);
+			}
+			printf("}");
+		} else if (baseline_path != NULL && old != NULL) {
+			printf("%s,%.3f,%.3f,%.1f,%s\n", benchmark->name, ns_per_op, old->ns_per_op, change, status);
+		} else if (baseline_path != NULL) {
+			printf("%s,%.3f,,,%s\n", benchmark->name, ns_per_op, status);
+		} else {
+			printf("%s,%.3f\n", benchmark->name, ns_per_op);
+		}
+		fflush(stdout);
+		first = false;
+	}
+	if (json) {
+		printf("\n  ]");
+		if (baseline_path != NULL) {
+			printf(",\n  \"slower\": %d", slower);
+		}
+		printf("\n}\n");
+	}
+
+	if (save != NULL) {
+		fclose(save);
+	}
+	return slower > 0 ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Measures random and sequential `lucu_vector_get`, popping and pushing
+ * back every element, and inserting and removing at random indexes, on
+ * vectors created with `lucu_vector_new_with_size` and
+ * `lucu_vector_new_power_of_two`, and all but the last on a vector defined
+ * with `LUCU_VECTOR_DEFINE`.
+ *
+ * All of the vectors are wrapped around the end of their allocation, so
+ * every access goes through the index wrapping that the modes differ in.
+ */
+#include "lucu/typed_vector.h"
+#include "lucu/vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define LENGTH (1 << 20)
+#define ACCESSES (1 << 25)
+#define EDITS (1 << 12)
+
+LUCU_VECTOR_DEFINE(IntVector, int);
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static LucuVector wrapped(LucuVector vector) {
+	for (int i = 0; i < LENGTH; i++) {
+		lucu_vector_push_back(vector, &i);
+	}
+	for (int i = 0; i < LENGTH / 2; i++) {
+		int n = 0;
+		lucu_vector_pop_front_into(vector, &n);
+		lucu_vector_push_back(vector, &n);
+	}
+	return vector;
+}
+
+static void run(const char* mode, LucuVector vector) {
+	// Keeps the compiler from optimizing the loops away.
+	volatile int64_t sink = 0;
+
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	double start = now();
+	for (int i = 0; i < ACCESSES; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		sum += *(int*)lucu_vector_get(vector, (int)(state % LENGTH));
+	}
+	double elapsed = now() - start;
+	sink += sum;
+	printf("%s,random_get,%.3f\n", mode, elapsed * 1e9 / ACCESSES);
+
+	sum = 0;
+	start = now();
+	for (int round = 0; round < ACCESSES / LENGTH; round++) {
+		const int length = lucu_vector_length(vector);
+		for (int i = 0; i < length; i++) {
+			sum += *(int*)lucu_vector_get(vector, i);
+		}
+	}
+	elapsed = now() - start;
+	sink += sum;
+	printf("%s,sequential_get,%.3f\n", mode, elapsed * 1e9 / ACCESSES);
+
+	sum = 0;
+	start = now();
+	for (int i = 0; i < ACCESSES; i++) {
+		int n = 0;
+		lucu_vector_pop_front_into(vector, &n);
+		sum += n;
+		lucu_vector_push_back(vector, &n);
+	}
+	elapsed = now() - start;
+	sink += sum;
+	printf("%s,pop_push,%.3f\n", mode, elapsed * 1e9 / ACCESSES);
+
+	start = now();
+	for (int i = 0; i < EDITS; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		const int index = (int)(state % LENGTH);
+		lucu_vector_insert(vector, &i, index);
+		lucu_vector_remove(vector, index);
+	}
+	elapsed = now() - start;
+	printf("%s,insert_remove,%.3f\n", mode, elapsed * 1e9 / EDITS);
+
+	(void)sink;
+	lucu_vector_destroy(vector);
+}
+
+static void run_typed(void) {
+	volatile int64_t sink = 0;
+	IntVector vector = IntVector_new_with_size(LENGTH + LENGTH / 3);
+	for (int i = 0; i < LENGTH; i++) {
+		IntVector_push_back(vector, i);
+	}
+	for (int i = 0; i < LENGTH / 2; i++) {
+		int n = 0;
+		IntVector_pop_front_into(vector, &n);
+		IntVector_push_back(vector, n);
+	}
+
+	uint64_t state = 88172645463325252ull;
+	int64_t sum = 0;
+	double start = now();
+	for (int i = 0; i < ACCESSES; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		sum += *IntVector_get(vector, (int)(state % LENGTH));
+	}
+	double elapsed = now() - start;
+	sink += sum;
+	printf("typed,random_get,%.3f\n", elapsed * 1e9 / ACCESSES);
+
+	sum = 0;
+	start = now();
+	for (int round = 0; round < ACCESSES / LENGTH; round++) {
+		const int length = IntVector_length(vector);
+		for (int i = 0; i < length; i++) {
+			sum += *IntVector_get(vector, i);
+		}
+	}
+	elapsed = now() - start;
+	sink += sum;
+	printf("typed,sequential_get,%.3f\n", elapsed * 1e9 / ACCESSES);
+
+	sum = 0;
+	start = now();
+	for (int i = 0; i < ACCESSES; i++) {
+		int n = 0;
+		IntVector_pop_front_into(vector, &n);
+		sum += n;
+		IntVector_push_back(vector, n);
+	}
+	elapsed = now() - start;
+	sink += sum;
+	printf("typed,pop_push,%.3f\n", elapsed * 1e9 / ACCESSES);
+
+	(void)sink;
+	IntVector_destroy(vector);
+}
+
+int main(void) {
+	printf("mode,operation,ns_per_element\n");
+	// Sized so that neither vector grows before the benchmark.
+	run("with_size", wrapped(lucu_vector_new_with_size(LENGTH + LENGTH / 3, sizeof(int), NULL)));
+	run("power_of_two", wrapped(lucu_vector_new_power_of_two(LENGTH + LENGTH / 3, sizeof(int), NULL)));
+	run_typed();
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * Measures `lucu_vector_sort` over a range of lengths and element sizes,
+ * on random input and on input that is already sorted, and
+ * `lucu_vector_sort_parallel` using every processor on the larger lengths,
+ * and `lucu_vector_sort_by_key`.
+ */
+#include "lucu/vector.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_WIDTH 64
+
+typedef enum Sort {
+	SEQUENTIAL,
+	PARALLEL,
+	BY_KEY,
+} Sort;
+
+static const char* const sort_names[] = {"sequential", "parallel", "by_key"};
+
+static double now(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * Elements are compared by the `uint32_t` at their start,
+ * the rest of each element is padding.
+ */
+static bool less(void* a, void* b, void* params) {
+	(void)params;
+	uint32_t x;
+	uint32_t y;
+	memcpy(&x, a, sizeof(x));
+	memcpy(&y, b, sizeof(y));
+	return x < y;
+}
+
+static void run(const int length, const size_t width, const bool sorted, const Sort sort) {
+	unsigned char element[MAX_WIDTH] = {0};
+	uint64_t state = 88172645463325252ull;
+	// Sort enough elements in total for the timing to be meaningful.
+	const int rounds = length >= (1 << 20) ? 1 : (1 << 20) / length;
+
+	double elapsed = 0;
+	for (int round = 0; round < rounds; round++) {
+		LucuVector vector = lucu_vector_new_with_size(length, width, NULL);
+		for (int i = 0; i < length; i++) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			const uint32_t key = sorted ? (uint32_t)i : (uint32_t)state;
+			memcpy(element, &key, sizeof(key));
+			lucu_vector_push_back(vector, element);
+		}
+		const double start = now();
+		switch (sort) {
+			case SEQUENTIAL:
+				lucu_vector_sort(vector, less, NULL);
+				break;
+			case PARALLEL:
+				lucu_vector_sort_parallel(vector, less, NULL, 0);
+				break;
+			case BY_KEY:
+				lucu_vector_sort_by_key(vector, LUCU_VECTOR_KEY_UINT32, 0);
+				break;
+		}
+		elapsed += now() - start;
+		lucu_vector_destroy(vector);
+	}
+	printf("%s,%d,%zu,%s,%.3f\n", sort_names[sort], length, width, sorted ? "sorted" : "random", elapsed * 1e9 / ((double)rounds * length));
+}
+
+int main(void) {
+	const int lengths[] = {16, 1000, 100000, 1000000};
+	const size_t widths[] = {4, 16, MAX_WIDTH};
+	printf("sort,length,bytewidth,input,ns_per_element\n");
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+			run(lengths[l], widths[w], false, SEQUENTIAL);
+			run(lengths[l], widths[w], true, SEQUENTIAL);
+			if (lengths[l] >= 100000) {
+				run(lengths[l], widths[w], false, PARALLEL);
+				run(lengths[l], widths[w], true, PARALLEL);
+			}
+			run(lengths[l], widths[w], false, BY_KEY);
+			run(lengths[l], widths[w], true, BY_KEY);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,61 @@
+/// @file allocator.h
+#ifndef LUCU_ALLOCATOR_H
+#define LUCU_ALLOCATOR_H
+
+#include <stdlib.h>
+
+/**
+ * A source of memory for the containers of liblucu.
+ *
+ * Constructors that take a `const LucuAllocator*` copy it and get all of the
+ * container's memory from it. Passing `NULL`, or an allocator whose
+ * `allocate` is `NULL`, uses `malloc`, `realloc` and `free`.
+ * See `lucu_arena_allocator` and `lucu_pool_allocator` for allocators
+ * provided by liblucu.
+ */
+typedef struct LucuAllocator {
+	/// Allocates `size` bytes, suitably aligned for any type.
+	/// Takes the size and `params`.
+	void* (*allocate)(size_t, void*);
+	/// Resizes an allocation, moving it if necessary. Takes the allocation,
+	/// its current size, the size it should have and `params`.
+	/// Can be `NULL` to always allocate, copy and deallocate.
+	void* (*reallocate)(void*, size_t, size_t, void*);
+	/// Frees an allocation. Takes the allocation and `params`.
+	/// Can be `NULL` if memory is only ever freed all at once.
+	void (*deallocate)(void*, void*);
+	/// Passed as the last parameter to each function.
+	void* params;
+} LucuAllocator;
+
+/**
+ * Allocates memory from a `LucuAllocator`.
+ *
+ * @param allocator The `LucuAllocator` to use. Can be `NULL` to use `malloc`.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory.
+ */
+void* lucu_allocate(const LucuAllocator* allocator, const size_t size);
+
+/**
+ * Resizes memory allocated from a `LucuAllocator`.
+ *
+ * @param allocator The `LucuAllocator` that `ptr` was allocated from.
+ * Can be `NULL` to use `realloc`.
+ * @param ptr The memory to resize. Can be `NULL` to allocate new memory.
+ * @param old_size The current size in bytes of `ptr`.
+ * @param new_size The size in bytes `ptr` should have.
+ * @return The resized memory, which may have moved.
+ */
+void* lucu_reallocate(const LucuAllocator* allocator, void* ptr, const size_t old_size, const size_t new_size);
+
+/**
+ * Frees memory allocated from a `LucuAllocator`.
+ *
+ * @param allocator The `LucuAllocator` that `ptr` was allocated from.
+ * Can be `NULL` to use `free`.
+ * @param ptr The memory to free. Can be `NULL` to do nothing.
+ */
+void lucu_deallocate(const LucuAllocator* allocator, void* ptr);
+
+#endif
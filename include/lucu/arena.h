@@ -0,0 +1,68 @@
+/// @file arena.h
+#ifndef LUCU_ARENA_H
+#define LUCU_ARENA_H
+
+#include "lucu/allocator.h"
+#include <stdlib.h>
+
+typedef struct LucuArenaData LucuArenaData;
+
+/**
+ * Allocates memory by bumping a pointer through large blocks.
+ *
+ * Individual allocations are never freed (except the most recent one).
+ * Instead everything allocated from the arena is freed at once with
+ * `lucu_arena_reset` or `lucu_arena_destroy`, which suits state that all
+ * lives for the same time, such as the state of a single request.
+ * A `LucuArena` is not safe to use from multiple threads at once.
+ */
+typedef LucuArenaData* LucuArena;
+
+/**
+ * Creates a new `LucuArena`.
+ *
+ * @param block_size The size in bytes of the blocks the arena allocates from.
+ * Can be 0 to use a default of 64 KiB. Allocations larger than a block get
+ * a block of their own.
+ * @return A newly created `LucuArena`.
+ */
+LucuArena lucu_arena_new(const size_t block_size);
+
+/**
+ * Frees a `LucuArena` and everything allocated from it.
+ *
+ * @param arena The `LucuArena` to destroy.
+ */
+void lucu_arena_destroy(LucuArena arena);
+
+/**
+ * Allocates memory from a `LucuArena`.
+ *
+ * @param arena The `LucuArena` to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return Memory suitably aligned for any type, valid until `arena` is
+ * reset or destroyed.
+ */
+void* lucu_arena_alloc(LucuArena arena, const size_t size);
+
+/**
+ * Frees everything allocated from a `LucuArena` at once.
+ *
+ * Takes *O(1)* time. The blocks are kept and reused by later allocations.
+ * @param arena The `LucuArena` to reset.
+ */
+void lucu_arena_reset(LucuArena arena);
+
+/**
+ * Gets a `LucuAllocator` that allocates from a `LucuArena`.
+ *
+ * Deallocating is a no-op except for the most recent allocation, which is
+ * given back to the arena, and reallocating the most recent allocation
+ * grows it in place when the block has room.
+ * @param arena The `LucuArena` to allocate from. **Must** outlive
+ * every container using the allocator.
+ * @return A `LucuAllocator` using `arena`.
+ */
+LucuAllocator lucu_arena_allocator(LucuArena arena);
+
+#endif
@@ -2,8 +2,20 @@
 #ifndef LUCU_CACHE_H
 #define LUCU_CACHE_H
 
+#include "lucu/allocator.h"
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Whether `LucuCacheStats` can be enabled.
+ *
+ * Defined to 0 for everything linking liblucu when it is configured with
+ * `LIBLUCU_CACHE_STATS` off, which compiles out every trace of them.
+ */
+#ifndef LUCU_CACHE_STATS
+#define LUCU_CACHE_STATS 1
+#endif
 
 typedef struct LucuCacheData LucuCacheData;
 
@@ -12,6 +24,60 @@ typedef struct LucuCacheData LucuCacheData;
  */
 typedef LucuCacheData* LucuCache;
 
+/**
+ * Decides which value a `LucuCache` evicts when it is full.
+ */
+typedef enum LucuCachePolicy {
+	/// Evicts the value that was inserted first. Hits don't affect eviction order.
+	LUCU_CACHE_FIFO,
+	/// Evicts the value that was least recently returned by `lucu_cache_get`.
+	LUCU_CACHE_LRU,
+	/// Approximates LRU with a reference bit per value. Values are given a
+	/// second chance instead of being reordered on every hit.
+	LUCU_CACHE_CLOCK,
+	/// Admits new values into a small FIFO queue first, and only keeps values
+	/// that get hit again while there. Resists being flushed by keys that
+	/// are only used once, such as a scan over a large range of keys.
+	/// Uses hashes to remember recently evicted keys, which is disabled if
+	/// the cache has no `key_hash_function`.
+	LUCU_CACHE_S3FIFO,
+} LucuCachePolicy;
+
+/**
+ * Number of buckets in `LucuCacheStats::get_latency`.
+ */
+#define LUCU_CACHE_LATENCY_BUCKETS 32
+
+/**
+ * Counts of what a `LucuCache` has been doing.
+ *
+ * See `lucu_cache_enable_stats`.
+ */
+typedef struct LucuCacheStats {
+	/// Keys found by `lucu_cache_get` and `lucu_cache_lookup`.
+	uint64_t hits;
+	/// Keys not found by `lucu_cache_get` and `lucu_cache_lookup`.
+	uint64_t misses;
+	/// Values evicted to make room for new ones.
+	uint64_t evictions;
+	/// Calls to `generate_function`, counting each value created by
+	/// `lucu_cache_get_batch` as one call.
+	uint64_t generate_calls;
+	/// Total time spent in `generate_function`, in nanoseconds. Only counted with timing enabled.
+	uint64_t generate_nanoseconds;
+	/// Total number of stored keys looked at while finding keys: index
+	/// slots probed for a hashed cache, keys compared otherwise.
+	/// Divide by `hits + misses` for the average.
+	uint64_t probes;
+	/// Most keys looked at while finding a single key.
+	uint64_t max_probes;
+	/// Histogram of how long `lucu_cache_get` took. Bucket `i` counts calls
+	/// that took from 2<sup>i</sup> up to 2<sup>i+1</sup> nanoseconds, except that
+	/// the first and last buckets also count faster and slower calls.
+	/// Only counted with timing enabled.
+	uint64_t get_latency[LUCU_CACHE_LATENCY_BUCKETS];
+} LucuCacheStats;
+
 /**
  * Creates a new `LucuCache`.
  *
@@ -35,6 +101,81 @@ typedef LucuCacheData* LucuCache;
  */
 LucuCache lucu_cache_new(const int cache_size, bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*));
 
+/**
+ * Creates a new `LucuCache` that indexes its keys by hash.
+ *
+ * Behaves exactly like a `LucuCache` created with `lucu_cache_new`,
+ * including the order values are evicted in, but keeps a hash index
+ * of the stored keys so that `lucu_cache_get` takes *O(1)* expected
+ * time instead of comparing against every stored key.
+ * @param cache_size The max number of elements to store at a time.
+ * @param key_hash_function Function used to hash keys. The first parameter
+ * is a pointer to the key and the second parameter is the value passed to
+ * `keys_equal_function_params`. Keys that are equal according to
+ * `keys_equal_function` **must** have the same hash.
+ * @param keys_equal_function Function used to determine if two keys are equal
+ * (see `lucu_cache_new`).
+ * @param keys_equal_function_params A value passed as the last parameter to
+ * `key_hash_function` and `keys_equal_function`.
+ * @param generate_function Function used to create new values to be cached
+ * (see `lucu_cache_new`).
+ * @param key_free_function Function used to free memory used by a key
+ * (see `lucu_cache_new`).
+ * @param value_free_function Function used to free memory used by a cached value
+ * (see `lucu_cache_new`).
+ * @return A newly created `LucuCache`
+ */
+LucuCache lucu_cache_new_hashed(const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*));
+
+/**
+ * Creates a new `LucuCache` with a given eviction policy.
+ *
+ * `lucu_cache_new` and `lucu_cache_new_hashed` both create a
+ * `LUCU_CACHE_FIFO` cache. Every policy takes *O(1)* time to record a hit
+ * and to evict, so the cost of `lucu_cache_get` is dominated by finding the key.
+ * @param policy The `LucuCachePolicy` used to choose values to evict.
+ * @param cache_size The max number of elements to store at a time.
+ * @param key_hash_function Function used to hash keys (see `lucu_cache_new_hashed`).
+ * Can be `NULL` to compare against every stored key instead.
+ * @param keys_equal_function Function used to determine if two keys are equal
+ * (see `lucu_cache_new`).
+ * @param keys_equal_function_params A value passed as the last parameter to
+ * `key_hash_function` and `keys_equal_function`.
+ * @param generate_function Function used to create new values to be cached
+ * (see `lucu_cache_new`).
+ * @param key_free_function Function used to free memory used by a key
+ * (see `lucu_cache_new`).
+ * @param value_free_function Function used to free memory used by a cached value
+ * (see `lucu_cache_new`).
+ * @return A newly created `LucuCache`
+ */
+LucuCache lucu_cache_new_with_policy(const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*));
+
+/**
+ * Creates a new `LucuCache` that gets its memory from a `LucuAllocator`.
+ *
+ * Behaves the same as a `LucuCache` created with `lucu_cache_new_with_policy`,
+ * but the cache, its slots and its indexes are allocated from `allocator`.
+ * Keys and values are still created and freed by the caller's functions.
+ * @param policy The `LucuCachePolicy` used to choose values to evict.
+ * @param cache_size The max number of elements to store at a time.
+ * @param key_hash_function Function used to hash keys (see `lucu_cache_new_with_policy`).
+ * @param keys_equal_function Function used to determine if two keys are equal
+ * (see `lucu_cache_new`).
+ * @param keys_equal_function_params A value passed as the last parameter to
+ * `key_hash_function` and `keys_equal_function`.
+ * @param generate_function Function used to create new values to be cached
+ * (see `lucu_cache_new`).
+ * @param key_free_function Function used to free memory used by a key
+ * (see `lucu_cache_new`).
+ * @param value_free_function Function used to free memory used by a cached value
+ * (see `lucu_cache_new`).
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ * @return A newly created `LucuCache`
+ */
+LucuCache lucu_cache_new_with_allocator(const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*), const LucuAllocator* allocator);
+
 /**
  * Frees the memory used by a `LucuCache` and any memory used
  * by cached values and keys.
@@ -55,4 +196,96 @@ void lucu_cache_destroy(LucuCache cache);
  */
 void* lucu_cache_get(LucuCache cache, void* key);
 
+/**
+ * Gets the values of several keys from a `LucuCache` at once.
+ *
+ * Gives the same values as calling `lucu_cache_get` for each key, but finds
+ * every key before creating any values: a hashed cache prefetches where each
+ * key is in its index, and any other cache compares the keys against its
+ * stored keys in a single pass. The keys that weren't found are then created
+ * together, so a slow backend can fetch them all in one round trip. Keys that
+ * appear more than once are only created once. None of the returned values
+ * are evicted to make room for the others.
+ * @param cache The `LucuCache` to get from.
+ * @param keys Array of `length` keys. `cache` takes ownership of the keys it
+ * creates values for, like `lucu_cache_get`.
+ * @param[out] values Array of `length` pointers, set to the values
+ * corresponding to `keys`.
+ * @param length Number of keys. **Must** be at most the size of `cache`.
+ * @param generate_batch_function Function used to create the values of keys
+ * that aren't cached. Takes an array of keys, an array of the same length to
+ * store the created values in, that length, and `params`.
+ * Can be `NULL` to call `generate_function` for each key instead.
+ * @param params Passed to `generate_batch_function`.
+ */
+void lucu_cache_get_batch(LucuCache cache, void** keys, void** values, const int length, void (*generate_batch_function)(void**, void**, int, void*), void* params);
+
+/**
+ * Looks up a value in a `LucuCache` without creating it.
+ *
+ * Finding `key` counts as a hit, the same as it would for `lucu_cache_get`.
+ * @param cache The `LucuCache` to look in.
+ * @param key The key used to find the value.
+ * @param[out] value Set to the value corresponding to `key` if it is found.
+ * Can be `NULL`.
+ * @return `true` if `key` is in `cache` and `false` if it isn't.
+ */
+bool lucu_cache_lookup(LucuCache cache, void* key, void** value);
+
+/**
+ * Stores a value in a `LucuCache` without calling `generate_function`.
+ *
+ * Evicts a value first if `cache` is full. `cache` takes ownership of
+ * `key` and `value`, just like it does for a generated value.
+ * @pre `key` **must not** already be in `cache` (check with `lucu_cache_lookup` first).
+ * @param cache The `LucuCache` to store in.
+ * @param key The key used to identify `value`.
+ * @param value The value to store.
+ */
+void lucu_cache_insert(LucuCache cache, void* key, void* value);
+
+/**
+ * Starts counting `LucuCacheStats` for a `LucuCache`.
+ *
+ * Caches don't count anything until this is called. Counting costs a few
+ * increments per operation, while timing reads the clock two to four times per
+ * `lucu_cache_get`. Does nothing if `LUCU_CACHE_STATS` is 0.
+ * @param cache The `LucuCache` to count for. Counts so far are kept.
+ * @param timing `true` to also time `lucu_cache_get` and `generate_function`.
+ */
+void lucu_cache_enable_stats(LucuCache cache, const bool timing);
+
+/**
+ * Stops counting `LucuCacheStats` for a `LucuCache`, and frees the counts.
+ *
+ * @param cache The `LucuCache` to stop counting for.
+ */
+void lucu_cache_disable_stats(LucuCache cache);
+
+/**
+ * Copies the `LucuCacheStats` of a `LucuCache`.
+ *
+ * @param cache The `LucuCache` to get the counts of.
+ * @param[out] stats Where to copy the counts to. All zero if counting isn't enabled.
+ */
+void lucu_cache_stats_snapshot(const LucuCache cache, LucuCacheStats* stats);
+
+/**
+ * Sets every count in the `LucuCacheStats` of a `LucuCache` back to zero.
+ *
+ * To scrape counts periodically, call this right after `lucu_cache_stats_snapshot`
+ * so that every snapshot holds the counts since the last one.
+ * @param cache The `LucuCache` to reset the counts of.
+ */
+void lucu_cache_stats_reset(LucuCache cache);
+
+/**
+ * Adds one `LucuCacheStats` to another.
+ *
+ * Useful for totalling the counts of several caches.
+ * @param[in,out] total The counts to add to.
+ * @param stats The counts to add.
+ */
+void lucu_cache_stats_add(LucuCacheStats* total, const LucuCacheStats* stats);
+
 #endif
@@ -0,0 +1,176 @@
+/// @file concurrent_cache.h
+#ifndef LUCU_CONCURRENT_CACHE_H
+#define LUCU_CONCURRENT_CACHE_H
+
+#include "lucu/cache.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct LucuConcurrentCacheData LucuConcurrentCacheData;
+
+/**
+ * A `LucuCache` that can be shared between threads.
+ *
+ * Keys are spread by hash across a number of shards, each of which is
+ * a `LucuCache` with its own lock, so threads only contend when they
+ * use keys in the same shard.
+ */
+typedef LucuConcurrentCacheData* LucuConcurrentCache;
+
+typedef struct LucuCacheFutureData LucuCacheFutureData;
+
+/**
+ * A value of a `LucuConcurrentCache` that is still being generated.
+ *
+ * Returned by `lucu_concurrent_cache_get_async`. Every future **must** be
+ * passed to either `lucu_cache_future_wait` or `lucu_cache_future_release`
+ * exactly once, and before the cache is destroyed.
+ */
+typedef LucuCacheFutureData* LucuCacheFuture;
+
+/**
+ * Creates a new `LucuConcurrentCache`.
+ *
+ * `generate_function` is called without holding any lock, so it may be slow
+ * or call back into the cache for other keys. Threads that miss on a key
+ * that is already being generated wait for that value instead of calling
+ * `generate_function` again.
+ * @param shard_count The number of independently locked shards.
+ * About the number of threads using the cache is a good choice.
+ * @param policy The `LucuCachePolicy` each shard uses to choose values to evict.
+ * @param cache_size The max number of elements to store at a time, split evenly between shards.
+ * @param key_hash_function Function used to hash keys (see `lucu_cache_new_hashed`).
+ * **Must not** be `NULL`, since it is also used to pick a key's shard.
+ * @param keys_equal_function Function used to determine if two keys are equal
+ * (see `lucu_cache_new`).
+ * @param keys_equal_function_params A value passed as the last parameter to
+ * `key_hash_function` and `keys_equal_function`.
+ * @param generate_function Function used to create new values to be cached
+ * (see `lucu_cache_new`). Can be called from any thread using the cache.
+ * @param key_free_function Function used to free memory used by a key
+ * (see `lucu_cache_new`).
+ * @param value_free_function Function used to free memory used by a cached value
+ * (see `lucu_cache_new`).
+ * @return A newly created `LucuConcurrentCache`
+ */
+LucuConcurrentCache lucu_concurrent_cache_new(const int shard_count, const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*));
+
+/**
+ * Frees the memory used by a `LucuConcurrentCache` and any memory used
+ * by cached values and keys.
+ *
+ * @pre No other thread is using `cache`.
+ * @param cache The `LucuConcurrentCache` to destroy.
+ */
+void lucu_concurrent_cache_destroy(LucuConcurrentCache cache);
+
+/**
+ * Gets a value from a `LucuConcurrentCache`.
+ *
+ * Returns a pointer to a value stored in a `LucuConcurrentCache`.
+ * May create a new value if one isn't already in the cache.
+ * Safe to call from multiple threads at once.
+ *
+ * Another thread can evict the value while it is still being used,
+ * so if `value_free_function` isn't `NULL` it should only free values
+ * once nothing else refers to them (by reference counting, for instance).
+ * @param cache The `LucuConcurrentCache` to get from.
+ * @param key The key used to get the value from the cache.
+ * @return A pointer to the value in the cache corresponding to `key`.
+ */
+void* lucu_concurrent_cache_get(LucuConcurrentCache cache, void* key);
+
+/**
+ * Starts threads that generate values for `lucu_concurrent_cache_get_async`.
+ *
+ * Call at most once, before other threads start using `cache`. The workers
+ * are stopped by `lucu_concurrent_cache_destroy`, once they have generated
+ * every value that was asked for.
+ * @param cache The `LucuConcurrentCache` to generate values for.
+ * @param worker_count The number of threads to start. **Must** be greater than 0.
+ */
+void lucu_concurrent_cache_start_workers(LucuConcurrentCache cache, const int worker_count);
+
+/**
+ * Gets a value from a `LucuConcurrentCache` without waiting for it to be generated.
+ *
+ * If `key` is cached, its value is returned right away like
+ * `lucu_concurrent_cache_get`. Otherwise the key is queued for one of the
+ * workers started by `lucu_concurrent_cache_start_workers` and a future is
+ * returned instead. If `key` is already being generated, by a worker or by
+ * `lucu_concurrent_cache_get` on another thread, the future waits for that
+ * value instead of generating it again. Without workers, the value is
+ * generated by the calling thread.
+ * Safe to call from multiple threads at once.
+ * @param cache The `LucuConcurrentCache` to get from.
+ * @param key The key used to get the value from the cache.
+ * @param[out] value Set to the value corresponding to `key` if it is ready.
+ * @param[out] future Set to a `LucuCacheFuture` for the value if it isn't ready.
+ * @return `true` if `value` was set and `false` if `future` was set.
+ */
+bool lucu_concurrent_cache_get_async(LucuConcurrentCache cache, void* key, void** value, LucuCacheFuture* future);
+
+/**
+ * Tests if the value of a `LucuCacheFuture` is ready, without waiting.
+ *
+ * @param future The `LucuCacheFuture` to test.
+ * @return `true` if `lucu_cache_future_wait` will return straight away.
+ */
+bool lucu_cache_future_is_done(const LucuCacheFuture future);
+
+/**
+ * Waits for the value of a `LucuCacheFuture` and frees the future.
+ *
+ * If no worker has started generating the value yet, the calling thread
+ * generates it instead of waiting for one to.
+ * @param future The `LucuCacheFuture` to wait for. **Must not** be used afterwards.
+ * @return The value, like `lucu_concurrent_cache_get` would return.
+ */
+void* lucu_cache_future_wait(LucuCacheFuture future);
+
+/**
+ * Frees a `LucuCacheFuture` without waiting for its value.
+ *
+ * The value is still generated and stored in the cache.
+ * @param future The `LucuCacheFuture` to free. **Must not** be used afterwards.
+ */
+void lucu_cache_future_release(LucuCacheFuture future);
+
+/**
+ * Starts counting `LucuCacheStats` for a `LucuConcurrentCache`.
+ *
+ * Works like `lucu_cache_enable_stats`. Counts are kept per shard under the
+ * shard's lock, so counting adds no contention between threads.
+ * A thread that misses on a key that is already being generated counts as
+ * a miss, but not as a call to `generate_function`.
+ * @param cache The `LucuConcurrentCache` to count for.
+ * @param timing `true` to also time `lucu_concurrent_cache_get` and `generate_function`.
+ */
+void lucu_concurrent_cache_enable_stats(LucuConcurrentCache cache, const bool timing);
+
+/**
+ * Stops counting `LucuCacheStats` for a `LucuConcurrentCache`, and frees the counts.
+ *
+ * @param cache The `LucuConcurrentCache` to stop counting for.
+ */
+void lucu_concurrent_cache_disable_stats(LucuConcurrentCache cache);
+
+/**
+ * Totals the `LucuCacheStats` of every shard of a `LucuConcurrentCache`.
+ *
+ * Safe to call while other threads use `cache`. Locks one shard at a time,
+ * so the total isn't an atomic snapshot of the whole cache.
+ * @param cache The `LucuConcurrentCache` to get the counts of.
+ * @param[out] stats Where to store the totals.
+ */
+void lucu_concurrent_cache_stats_snapshot(LucuConcurrentCache cache, LucuCacheStats* stats);
+
+/**
+ * Sets every count of a `LucuConcurrentCache` back to zero.
+ *
+ * Safe to call while other threads use `cache`.
+ * @param cache The `LucuConcurrentCache` to reset the counts of.
+ */
+void lucu_concurrent_cache_stats_reset(LucuConcurrentCache cache);
+
+#endif
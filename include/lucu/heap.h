@@ -0,0 +1,153 @@
+/// @file heap.h
+#ifndef LUCU_HEAP_H
+#define LUCU_HEAP_H
+
+#include "lucu/allocator.h"
+#include "lucu/vector.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct LucuHeapData LucuHeapData;
+
+/**
+ * A priority queue.
+ *
+ * A binary heap stored in a contiguous `LucuVector`. The element at the
+ * front is always the one that sorts first according to the heap's compare
+ * function, so with a less than comparison it is the smallest element.
+ * Pushing and popping take *O(log n)* time, where keeping a `LucuVector`
+ * sorted with `lucu_vector_insert` takes *O(n)*.
+ */
+typedef LucuHeapData* LucuHeap;
+
+/**
+ * Creates a new, empty `LucuHeap`.
+ *
+ * @param bytewidth The number of bytes that an element takes up.
+ * @param free_function Function used to free elements. Can be `NULL` to forgo
+ * freeing elements. Takes a `void*` pointing to the element to be freed.
+ * @param compare_function Function used to compare two elements, like in
+ * `lucu_vector_sort`. Returns `true` if the first element should be popped
+ * before the second element and `false` otherwise.
+ * @param params Passed to `compare_function` and the index function.
+ * @return A new `LucuHeap`.
+ */
+LucuHeap lucu_heap_new(const size_t bytewidth, void (*free_function)(void*), bool (*compare_function)(void*, void*, void*), void* params);
+
+/**
+ * Creates a new, empty `LucuHeap` that gets its memory from a `LucuAllocator`.
+ *
+ * See `lucu_heap_new` for the other parameters.
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ * @return A new `LucuHeap`.
+ */
+LucuHeap lucu_heap_new_with_allocator(const size_t bytewidth, void (*free_function)(void*), bool (*compare_function)(void*, void*, void*), void* params, const LucuAllocator* allocator);
+
+/**
+ * Turns a `LucuVector` into a `LucuHeap`.
+ *
+ * Reorders the elements in place in *O(n)* time, which is faster than
+ * pushing them one at a time. The heap takes ownership of `vector`,
+ * including its free function and allocator, so `vector` **must not**
+ * be used or destroyed afterwards.
+ * @param vector The `LucuVector` holding the elements.
+ * @param compare_function Function used to compare two elements (see `lucu_heap_new`).
+ * @param params Passed to `compare_function` and the index function.
+ * @return A `LucuHeap` holding the elements of `vector`.
+ */
+LucuHeap lucu_heap_from_vector(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params);
+
+/**
+ * Frees the memory used by a `LucuHeap`, and its elements.
+ *
+ * @param heap The `LucuHeap` to destroy.
+ */
+void lucu_heap_destroy(LucuHeap heap);
+
+/**
+ * Tells a `LucuHeap` to report where its elements are.
+ *
+ * `index_function` is called with a pointer to the element, its new index
+ * and the heap's `params` whenever an element is put at an index, so
+ * elements can keep track of their own index for `lucu_heap_decrease_key`.
+ * It is called for every element already in `heap` right away.
+ * @param heap The `LucuHeap` to report on.
+ * @param index_function The function to call. Can be `NULL` to stop reporting.
+ */
+void lucu_heap_set_index_function(LucuHeap heap, void (*index_function)(void*, int, void*));
+
+/**
+ * Number of elements in a `LucuHeap`.
+ *
+ * @param heap The `LucuHeap` to test.
+ * @return The number of elements in `heap`.
+ */
+int lucu_heap_length(const LucuHeap heap);
+
+/**
+ * Tests if a `LucuHeap` is empty.
+ *
+ * @param heap The `LucuHeap` to test.
+ * @return `true` if `heap` has no elements.
+ */
+bool lucu_heap_is_empty(const LucuHeap heap);
+
+/**
+ * Adds an element to a `LucuHeap`.
+ *
+ * Pointers to elements in `heap` are invalidated.
+ * @param heap The `LucuHeap` to add to.
+ * @param data Element to copy into `heap`.
+ */
+void lucu_heap_push(LucuHeap heap, const void* data);
+
+/**
+ * Gets the front element of a `LucuHeap`, without removing it.
+ *
+ * @param heap The `LucuHeap` to look in.
+ * @return A pointer to the element that sorts first, or `NULL` if `heap` is empty.
+ */
+void* lucu_heap_peek(const LucuHeap heap);
+
+/**
+ * Removes the front element of a `LucuHeap`.
+ *
+ * @param heap The `LucuHeap` to remove from.
+ * @param[out] out Where to copy the element to, handing it to the caller.
+ * Can be `NULL` to free it with the free function instead.
+ * @return `true` if an element was removed and `false` if `heap` was empty.
+ */
+bool lucu_heap_pop_into(LucuHeap heap, void* out);
+
+/**
+ * Gets an element of a `LucuHeap` by its index.
+ *
+ * Indices are the ones given to the index function. Index 0 is the front.
+ * @param heap The `LucuHeap` to look in.
+ * @param index The index of the element. **Must** be less than the length of `heap`.
+ * @return A pointer to the element.
+ */
+void* lucu_heap_get(const LucuHeap heap, const int index);
+
+/**
+ * Moves an element of a `LucuHeap` towards the front after it was changed.
+ *
+ * Change the element through `lucu_heap_get` so that it sorts before,
+ * or the same as, it did before, then call this to restore the order
+ * in *O(log n)* time.
+ * @param heap The `LucuHeap` holding the element.
+ * @param index The index of the changed element.
+ */
+void lucu_heap_decrease_key(LucuHeap heap, const int index);
+
+/**
+ * Moves an element of a `LucuHeap` to its place after it was changed.
+ *
+ * Like `lucu_heap_decrease_key`, but the element may also sort after where it used to.
+ * @param heap The `LucuHeap` holding the element.
+ * @param index The index of the changed element.
+ */
+void lucu_heap_update(LucuHeap heap, const int index);
+
+#endif
@@ -0,0 +1,169 @@
+/// @file map.h
+#ifndef LUCU_MAP_H
+#define LUCU_MAP_H
+
+#include "lucu/allocator.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct LucuMapData LucuMapData;
+
+/**
+ * Maps keys to values with a hash table.
+ *
+ * Keys and values are copied into the map, like the elements of a `LucuVector`.
+ * Uses open addressing: each entry's slot has a control byte holding
+ * part of its hash, and a lookup compares a whole group of control bytes
+ * at once (with SSE2 when available), so most lookups only compare keys
+ * that are very likely to be equal.
+ */
+typedef LucuMapData* LucuMap;
+
+/**
+ * Creates a new `LucuMap`.
+ *
+ * @param key_bytewidth The number of bytes that a key takes up.
+ * @param value_bytewidth The number of bytes that a value takes up. Can be 0
+ * to use the map as a set.
+ * @param key_hash_function Function used to hash keys. The first parameter
+ * is a pointer to the key and the second parameter is `params`.
+ * Keys that are equal according to `keys_equal_function` **must** have the same hash.
+ * @param keys_equal_function Function used to determine if two keys are equal.
+ * The first parameter is a pointer to a key stored in the map, the second
+ * is a pointer to the key being searched for and the third is `params`.
+ * @param params A value passed as the last parameter to
+ * `key_hash_function` and `keys_equal_function`.
+ * @param key_free_function Function used to free keys. Takes a pointer
+ * to the key. Can be `NULL` to forgo freeing keys.
+ * @param value_free_function Function used to free values. Takes a pointer
+ * to the value. Can be `NULL` to forgo freeing values.
+ * @return A new `LucuMap`
+ */
+LucuMap lucu_map_new(const size_t key_bytewidth, const size_t value_bytewidth, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* params, void (*key_free_function)(void*), void (*value_free_function)(void*));
+
+/**
+ * Creates a new `LucuMap` that gets its memory from a `LucuAllocator`.
+ *
+ * See `lucu_map_new` for the other parameters.
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ * @return A new `LucuMap`
+ */
+LucuMap lucu_map_new_with_allocator(const size_t key_bytewidth, const size_t value_bytewidth, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* params, void (*key_free_function)(void*), void (*value_free_function)(void*), const LucuAllocator* allocator);
+
+/**
+ * Frees the memory used by a `LucuMap`, and its keys and values.
+ *
+ * @param map The `LucuMap` to destroy.
+ */
+void lucu_map_destroy(LucuMap map);
+
+/**
+ * Number of entries in a `LucuMap`.
+ *
+ * @param map The `LucuMap` to test.
+ * @return The number of keys in `map`.
+ */
+int lucu_map_length(const LucuMap map);
+
+/**
+ * Number of entries a `LucuMap` can hold without growing.
+ *
+ * @param map The `LucuMap` to test.
+ * @return The number of entries that fit in the memory allocated to `map`.
+ */
+int lucu_map_capacity(const LucuMap map);
+
+/**
+ * Makes sure a `LucuMap` can hold `length` entries without growing.
+ *
+ * @param map The `LucuMap` to reserve space in.
+ * @param length The number of entries `map` should be able to hold.
+ */
+void lucu_map_reserve(LucuMap map, const int length);
+
+/**
+ * Inserts an entry into a `LucuMap`.
+ *
+ * If `key` is already in `map`, the stored key and value are freed
+ * and replaced. Either way, `map` takes ownership of `key` and `value`.
+ * Pointers to keys and values in `map` are invalidated.
+ * @param map The `LucuMap` to insert into.
+ * @param key Key to copy into `map`.
+ * @param value Value to copy into `map`. Can be `NULL` if the value bytewidth is 0.
+ * @return `true` if `key` wasn't in `map` yet and `false` if it replaced an entry.
+ */
+bool lucu_map_insert(LucuMap map, const void* key, const void* value);
+
+/**
+ * Gets the value of a key in a `LucuMap`.
+ *
+ * @param map The `LucuMap` to look in.
+ * @param key The key to look up.
+ * @return A pointer to the value stored for `key`, or `NULL` if `key` isn't
+ * in `map`. Valid until `map` is next modified.
+ */
+void* lucu_map_get(const LucuMap map, const void* key);
+
+/**
+ * Removes an entry from a `LucuMap`.
+ *
+ * Frees the stored key and value.
+ * @param map The `LucuMap` to remove from.
+ * @param key The key of the entry to remove.
+ * @return `true` if `key` was in `map` and `false` if it wasn't.
+ */
+bool lucu_map_remove(LucuMap map, const void* key);
+
+/**
+ * Removes an entry from a `LucuMap`, copying it out instead of freeing it.
+ *
+ * @param map The `LucuMap` to remove from.
+ * @param key The key of the entry to remove.
+ * @param[out] key_out Where to copy the stored key to. Can be `NULL` to free it.
+ * @param[out] value_out Where to copy the stored value to. Can be `NULL` to free it.
+ * @return `true` if `key` was in `map` and `false` if it wasn't.
+ */
+bool lucu_map_remove_into(LucuMap map, const void* key, void* key_out, void* value_out);
+
+/**
+ * Removes every entry from a `LucuMap`, keeping its memory.
+ *
+ * @param map The `LucuMap` to clear.
+ */
+void lucu_map_clear(LucuMap map);
+
+/**
+ * Steps through the entries of a `LucuMap`.
+ *
+ * Entries are visited in no particular order. The map **must not**
+ * be modified while stepping through it.
+ * @code
+ * int position = 0;
+ * void* key;
+ * void* value;
+ * while (lucu_map_next(map, &position, &key, &value)) {
+ *     // use key and value
+ * }
+ * @endcode
+ * @param map The `LucuMap` to step through.
+ * @param[in,out] position Where to continue from. Start at 0.
+ * @param[out] key Set to a pointer to the next key. Can be `NULL`.
+ * @param[out] value Set to a pointer to the next value. Can be `NULL`.
+ * @return `true` if there was another entry and `false` if all have been visited.
+ */
+bool lucu_map_next(const LucuMap map, int* position, void** key, void** value);
+
+/**
+ * Iterate over the entries of a `LucuMap`.
+ *
+ * Runs `func` on every entry of `map`, in no particular order.
+ * @param map The `LucuMap` to iterate over.
+ * @param func Function to run for each entry. Accepts a pointer to the key,
+ * a pointer to the value and `params`. Returns `true` to stop iterating
+ * and `false` to continue.
+ * @param params Passed to func.
+ */
+void lucu_map_iterate(LucuMap map, bool (*func)(void*, void*, void*), void* params);
+
+#endif
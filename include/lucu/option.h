@@ -2,7 +2,15 @@
 #ifndef LUCU_OPTION_H
 #define LUCU_OPTION_H
 
+#include "lucu/allocator.h"
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Largest data, in bytes, that a `LucuOption` holds without allocating.
+ */
+#define LUCU_OPTION_INLINE_SIZE 16
 
 typedef struct LucuOptionData LucuOptionData;
 /**
@@ -12,22 +20,80 @@ typedef struct LucuOptionData LucuOptionData;
  */
 typedef LucuOptionData* LucuOption;
 
+/**
+ * Data of a `LucuOption`.
+ *
+ * Public only so that a `LucuOption` can be put on the stack with
+ * `lucu_option_init_none`. Don't access the fields directly, and don't
+ * copy a `LucuOptionData`, since `data` may point into the struct itself.
+ */
+struct LucuOptionData {
+	/// The held data, or `NULL` if the option is `None`.
+	void* data;
+	/// The size in bytes of `data`.
+	size_t data_size;
+	/// Holds data of up to `LUCU_OPTION_INLINE_SIZE` bytes, so that
+	/// it doesn't need a separate allocation.
+	union {
+		max_align_t align;
+		unsigned char bytes[LUCU_OPTION_INLINE_SIZE];
+	} inline_data;
+	/// Where the option gets its memory from.
+	LucuAllocator allocator;
+};
+
 /**
  * Creates a `None` varient of `LucuOption`.
  * @return A new `None`
  */
 LucuOption lucu_option_new_none();
 
+/**
+ * Creates a `None` varient of `LucuOption` that gets its memory from a `LucuAllocator`.
+ *
+ * The option itself, data too large to store inline, and data returned by
+ * `lucu_option_take` are all allocated from `allocator`.
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ * @return A new `None`
+ */
+LucuOption lucu_option_new_none_with_allocator(const LucuAllocator* allocator);
+
+/**
+ * Initializes a `None` varient of `LucuOption` in memory provided by the caller.
+ *
+ * Makes no heap allocations, and neither does setting the option to
+ * data of up to `LUCU_OPTION_INLINE_SIZE` bytes. An initialized option
+ * isn't destroyed with `lucu_option_destroy`, but **must** be a `None`
+ * when `option` goes out of scope, so that any data it allocated is freed.
+ * @param option Memory to hold the `LucuOption`, for instance on the stack.
+ * @return `option`, to be used like any other `LucuOption`.
+ */
+LucuOption lucu_option_init_none(LucuOptionData* option);
+
 /**
  * Creates a `Some` varient of `LucuOption`.
  *
- * Stores some data which is copied from `data`.
+ * Stores some data which is copied from `data`. Data of up to
+ * `LUCU_OPTION_INLINE_SIZE` bytes is stored in the `LucuOption` itself.
  * @param data Pointer to the data to be copied and held in the `LucuOption`.
  * @param data_size The size in bytes of the data that `data` points to.
  * @return A `Some` `LucuOption` with the provided data.
  */
 LucuOption lucu_option_new_some(void* data, size_t data_size);
 
+/**
+ * Creates a `Some` varient of `LucuOption` that gets its memory from a `LucuAllocator`.
+ *
+ * See `lucu_option_new_none_with_allocator`.
+ * @param data Pointer to the data to be copied and held in the `LucuOption`.
+ * @param data_size The size in bytes of the data that `data` points to.
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ * @return A `Some` `LucuOption` with the provided data.
+ */
+LucuOption lucu_option_new_some_with_allocator(void* data, size_t data_size, const LucuAllocator* allocator);
+
 /**
  * Destroys a `LucuOption`.
  * @pre `option` **must** be a `None` (use `lucu_option_take` to take the data out first).
@@ -58,9 +124,23 @@ void* lucu_option_get(const LucuOption option);
  * @post `option` will become a `None`.
  * @param option The `LucuOption` to take data from.
  * @return A pointer to the data that was held by `option`.
+ * Has to be freed with `free`, or with `lucu_deallocate` if `option`
+ * was created with an allocator.
  */
 void* lucu_option_take(LucuOption option);
 
+/**
+ * Takes the data held in a `LucuOption` by copying it out.
+ *
+ * Unlike `lucu_option_take`, never allocates memory for the data.
+ * @pre `option` **must** be a `Some` (check with `lucu_option_is_some` first).
+ * @post `option` will become a `None`.
+ * @param option The `LucuOption` to take data from.
+ * @param[out] out Where to copy the data to. **Must** have room for the
+ * number of bytes that was given when setting `option`.
+ */
+void lucu_option_take_into(LucuOption option, void* out);
+
 /**
  * Sets the data held in a `LucuOption`.
  * @pre `option` **must** be a `None` (check with `lucu_option_is_some` first).
@@ -0,0 +1,67 @@
+/// @file pool.h
+#ifndef LUCU_POOL_H
+#define LUCU_POOL_H
+
+#include "lucu/allocator.h"
+#include <stdlib.h>
+
+typedef struct LucuPoolData LucuPoolData;
+
+/**
+ * Allocates fixed size elements from large blocks.
+ *
+ * Freed elements are kept in a free list and handed out again, so
+ * allocating and freeing take *O(1)* time and many short lived objects
+ * of the same size don't fragment the heap. Blocks are only given back
+ * when the pool is destroyed.
+ * A `LucuPool` is not safe to use from multiple threads at once.
+ */
+typedef LucuPoolData* LucuPool;
+
+/**
+ * Creates a new `LucuPool`.
+ *
+ * @param element_size The size in bytes of every element.
+ * @param elements_per_block The number of elements to allocate room for at a time.
+ * **Must** be greater than 0.
+ * @return A newly created `LucuPool`.
+ */
+LucuPool lucu_pool_new(const size_t element_size, const int elements_per_block);
+
+/**
+ * Frees a `LucuPool` and every element allocated from it.
+ *
+ * @param pool The `LucuPool` to destroy.
+ */
+void lucu_pool_destroy(LucuPool pool);
+
+/**
+ * Allocates an element from a `LucuPool`.
+ *
+ * @param pool The `LucuPool` to allocate from.
+ * @return Memory for one element, suitably aligned for any type.
+ */
+void* lucu_pool_alloc(LucuPool pool);
+
+/**
+ * Gives an element back to a `LucuPool`.
+ *
+ * @param pool The `LucuPool` `element` was allocated from.
+ * @param element The element to free.
+ */
+void lucu_pool_free(LucuPool pool, void* element);
+
+/**
+ * Gets a `LucuAllocator` that allocates from a `LucuPool`.
+ *
+ * Allocations that fit in an element come from the pool. Bigger ones, such
+ * as the element storage of a `LucuVector` or `LucuMap`, come from `malloc`
+ * and are looked for among each other whenever something is freed, so it
+ * suits containers that mostly make element sized allocations.
+ * @param pool The `LucuPool` to allocate from. **Must** outlive
+ * every container using the allocator.
+ * @return A `LucuAllocator` using `pool`.
+ */
+LucuAllocator lucu_pool_allocator(LucuPool pool);
+
+#endif
@@ -0,0 +1,190 @@
+/// @file queue.h
+#ifndef LUCU_QUEUE_H
+#define LUCU_QUEUE_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct LucuSpscQueueData LucuSpscQueueData;
+
+/**
+ * Bounded first in first out queue for passing elements from one thread to another.
+ *
+ * Like a `LucuVector` used with `lucu_vector_enqueue` and `lucu_vector_dequeue`,
+ * it is a circular array of elements that are `bytewidth` bytes each, but it
+ * never grows and it is lock-free: exactly one thread may enqueue and exactly
+ * one (other) thread may dequeue at the same time without any locking.
+ * The head and tail indices are kept on separate cache lines so that the
+ * two threads don't slow each other down.
+ */
+typedef LucuSpscQueueData* LucuSpscQueue;
+
+typedef struct LucuMpmcQueueData LucuMpmcQueueData;
+
+/**
+ * Bounded first in first out queue shared by any number of threads.
+ *
+ * Like `LucuSpscQueue`, but any number of threads may enqueue and dequeue
+ * at the same time. Each slot has a sequence number saying whether it is
+ * ready to be written or read, so threads only contend on the head or tail
+ * index and never wait for a lock.
+ */
+typedef LucuMpmcQueueData* LucuMpmcQueue;
+
+/**
+ * Creates a new `LucuSpscQueue`.
+ *
+ * @param capacity The minimum number of elements the queue can hold.
+ * Rounded up to a power of two. **Must** be greater than 0.
+ * @param bytewidth The number of bytes each element takes up.
+ * @return A new `LucuSpscQueue`.
+ */
+LucuSpscQueue lucu_spsc_queue_new(const int capacity, const size_t bytewidth);
+
+/**
+ * Frees the memory used by a `LucuSpscQueue`.
+ *
+ * No other thread may be using the queue.
+ * @param queue The `LucuSpscQueue` to destroy.
+ */
+void lucu_spsc_queue_destroy(LucuSpscQueue queue);
+
+/**
+ * Number of elements a `LucuSpscQueue` can hold.
+ *
+ * @param queue The `LucuSpscQueue` to test.
+ * @return The capacity of `queue`.
+ */
+int lucu_spsc_queue_capacity(const LucuSpscQueue queue);
+
+/**
+ * Number of elements in a `LucuSpscQueue`.
+ *
+ * Only a snapshot if other threads are using the queue.
+ * @param queue The `LucuSpscQueue` to test.
+ * @return The number of elements in `queue`.
+ */
+int lucu_spsc_queue_length(const LucuSpscQueue queue);
+
+/**
+ * Adds an element to the back of a `LucuSpscQueue`.
+ *
+ * Only the producer thread may call this.
+ * @param queue The `LucuSpscQueue` to add to.
+ * @param data Element to copy into `queue`.
+ * @return `true` if the element was added and `false` if `queue` was full.
+ */
+bool lucu_spsc_queue_enqueue(LucuSpscQueue queue, const void* data);
+
+/**
+ * Adds as many elements as fit to the back of a `LucuSpscQueue`.
+ *
+ * Cheaper than calling `lucu_spsc_queue_enqueue` for each element, since
+ * the elements are copied with at most two `memcpy`s and the consumer is
+ * only notified once. Only the producer thread may call this.
+ * @param queue The `LucuSpscQueue` to add to.
+ * @param arr Array of elements to copy into `queue`.
+ * @param length Number of elements in `arr`.
+ * @return The number of elements added, from the start of `arr`.
+ */
+int lucu_spsc_queue_enqueue_batch(LucuSpscQueue queue, const void* arr, const int length);
+
+/**
+ * Removes the element at the front of a `LucuSpscQueue`.
+ *
+ * Only the consumer thread may call this.
+ * @param queue The `LucuSpscQueue` to remove from.
+ * @param[out] out Where to copy the element. Can be `NULL` to drop it.
+ * @return `true` if an element was removed and `false` if `queue` was empty.
+ */
+bool lucu_spsc_queue_dequeue(LucuSpscQueue queue, void* out);
+
+/**
+ * Removes up to `length` elements from the front of a `LucuSpscQueue`.
+ *
+ * Only the consumer thread may call this.
+ * @param queue The `LucuSpscQueue` to remove from.
+ * @param[out] out Array with room for `length` elements to copy the elements into.
+ * @param length The maximum number of elements to remove.
+ * @return The number of elements removed.
+ */
+int lucu_spsc_queue_dequeue_batch(LucuSpscQueue queue, void* out, const int length);
+
+/**
+ * Creates a new `LucuMpmcQueue`.
+ *
+ * @param capacity The minimum number of elements the queue can hold.
+ * Rounded up to a power of two. **Must** be greater than 0.
+ * @param bytewidth The number of bytes each element takes up.
+ * @return A new `LucuMpmcQueue`.
+ */
+LucuMpmcQueue lucu_mpmc_queue_new(const int capacity, const size_t bytewidth);
+
+/**
+ * Frees the memory used by a `LucuMpmcQueue`.
+ *
+ * No other thread may be using the queue.
+ * @param queue The `LucuMpmcQueue` to destroy.
+ */
+void lucu_mpmc_queue_destroy(LucuMpmcQueue queue);
+
+/**
+ * Number of elements a `LucuMpmcQueue` can hold.
+ *
+ * @param queue The `LucuMpmcQueue` to test.
+ * @return The capacity of `queue`.
+ */
+int lucu_mpmc_queue_capacity(const LucuMpmcQueue queue);
+
+/**
+ * Number of elements in a `LucuMpmcQueue`.
+ *
+ * Only a snapshot if other threads are using the queue. Counts elements
+ * that are still being enqueued or dequeued.
+ * @param queue The `LucuMpmcQueue` to test.
+ * @return The number of elements in `queue`.
+ */
+int lucu_mpmc_queue_length(const LucuMpmcQueue queue);
+
+/**
+ * Adds an element to the back of a `LucuMpmcQueue`.
+ *
+ * @param queue The `LucuMpmcQueue` to add to.
+ * @param data Element to copy into `queue`.
+ * @return `true` if the element was added and `false` if `queue` was full.
+ */
+bool lucu_mpmc_queue_enqueue(LucuMpmcQueue queue, const void* data);
+
+/**
+ * Adds as many elements as fit to the back of a `LucuMpmcQueue`.
+ *
+ * The elements claim consecutive slots with a single atomic operation,
+ * so they stay together in the queue and contention on the tail index
+ * is paid once per batch instead of once per element.
+ * @param queue The `LucuMpmcQueue` to add to.
+ * @param arr Array of elements to copy into `queue`.
+ * @param length Number of elements in `arr`.
+ * @return The number of elements added, from the start of `arr`.
+ */
+int lucu_mpmc_queue_enqueue_batch(LucuMpmcQueue queue, const void* arr, const int length);
+
+/**
+ * Removes the element at the front of a `LucuMpmcQueue`.
+ *
+ * @param queue The `LucuMpmcQueue` to remove from.
+ * @param[out] out Where to copy the element. Can be `NULL` to drop it.
+ * @return `true` if an element was removed and `false` if `queue` was empty.
+ */
+bool lucu_mpmc_queue_dequeue(LucuMpmcQueue queue, void* out);
+
+/**
+ * Removes up to `length` consecutive elements from the front of a `LucuMpmcQueue`.
+ *
+ * @param queue The `LucuMpmcQueue` to remove from.
+ * @param[out] out Array with room for `length` elements to copy the elements into.
+ * @param length The maximum number of elements to remove.
+ * @return The number of elements removed.
+ */
+int lucu_mpmc_queue_dequeue_batch(LucuMpmcQueue queue, void* out, const int length);
+
+#endif
@@ -0,0 +1,73 @@
+/// @file typed_option.h
+#ifndef LUCU_TYPED_OPTION_H
+#define LUCU_TYPED_OPTION_H
+
+#include <assert.h>
+#include <stdbool.h>
+
+/**
+ * Defines an option type holding a value of type `type`.
+ *
+ * Works like a `LucuOption`, but the option is a plain struct that is
+ * passed and returned by value with the value stored inside it, so creating,
+ * setting and taking never touch the heap. Every function is `static inline`.
+ *
+ * `LUCU_OPTION_DEFINE(IntOption, int)` defines the struct type `IntOption`
+ * and the following functions, which work like the `lucu_option_` function
+ * with the same suffix:
+ *
+ * - `IntOption IntOption_new_none(void)`
+ * - `IntOption IntOption_new_some(int value)`
+ * - `bool IntOption_is_some(const IntOption* option)`
+ * - `int* IntOption_get(IntOption* option)`
+ * - `int IntOption_take(IntOption* option)`
+ * - `void IntOption_set(IntOption* option, int value)`
+ *
+ * There is no `_destroy`: an option owns nothing beyond its own storage.
+ *
+ * Use at file scope. Defining the same name twice in one translation unit
+ * is an error, so put the definition in a shared header when several files
+ * use the same option type.
+ * @param name Name of the struct type, also used as the prefix of every function.
+ * @param type The type of the held value. Values are copied by assignment.
+ */
+#define LUCU_OPTION_DEFINE(name, type) \
+	typedef struct name { \
+		bool is_some; \
+		type value; \
+	} name; \
+	\
+	static inline name name##_new_none(void) { \
+		const name option = { .is_some = false }; \
+		return option; \
+	} \
+	\
+	static inline name name##_new_some(const type value) { \
+		const name option = { .is_some = true, .value = value }; \
+		return option; \
+	} \
+	\
+	static inline bool name##_is_some(const name* const option) { \
+		return option->is_some; \
+	} \
+	\
+	static inline type* name##_get(name* const option) { \
+		assert(option->is_some); \
+		return &option->value; \
+	} \
+	\
+	static inline type name##_take(name* const option) { \
+		assert(option->is_some); \
+		option->is_some = false; \
+		return option->value; \
+	} \
+	\
+	static inline void name##_set(name* const option, const type value) { \
+		assert(!option->is_some); \
+		option->is_some = true; \
+		option->value = value; \
+	} \
+	\
+	typedef int name##Defined
+
+#endif
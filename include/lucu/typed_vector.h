@@ -0,0 +1,328 @@
+/// @file typed_vector.h
+#ifndef LUCU_TYPED_VECTOR_H
+#define LUCU_TYPED_VECTOR_H
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Default size increase multiplier of typed vectors.
+ *
+ * Same as the default for `LucuVector`.
+ */
+#define LUCU_TYPED_VECTOR_SIZE_INCREASE 1.5
+
+/**
+ * Initial size of a typed vector created with `_new`.
+ *
+ * Same as the initial size of a `LucuVector`.
+ */
+#define LUCU_TYPED_VECTOR_INIT_SIZE 16
+
+/**
+ * Defines a vector of elements of type `type`.
+ *
+ * Behaves like a `LucuVector` (a circular array with one slot left empty),
+ * but every function is `static inline` and knows the element type, so
+ * elements are copied with plain assignment instead of `memcpy` of a
+ * runtime `bytewidth`, and accessors inline down to a load or store.
+ *
+ * `LUCU_VECTOR_DEFINE(IntVector, int)` defines the handle type `IntVector`
+ * and the following functions, which work like the `lucu_vector_` function
+ * with the same suffix except that elements are passed and returned by value
+ * or as `type*`:
+ *
+ * - `IntVector_new`, `IntVector_new_with_size`, `IntVector_from_array`,
+ *   `IntVector_destroy`, `IntVector_to_array`
+ * - `IntVector_wrap_index`, `IntVector_is_empty`, `IntVector_length`,
+ *   `IntVector_capacity`, `IntVector_reserve`, `IntVector_shrink_to_fit`,
+ *   `IntVector_set_growth_factor`
+ * - `IntVector_push_back`, `IntVector_push_front`, `IntVector_push`,
+ *   `IntVector_enqueue`, `IntVector_append`, `IntVector_prepend`, `IntVector_extend`
+ * - `IntVector_pop_front_into`, `IntVector_pop_back_into`, `IntVector_pop_into`,
+ *   `IntVector_dequeue_into`
+ * - `IntVector_get`, `IntVector_swap`, `IntVector_remove`, `IntVector_insert`,
+ *   `IntVector_make_contiguous`
+ *
+ * Typed vectors have no `free_function`: elements are values that are simply
+ * dropped when removed. Use `LucuVector` when elements need to be freed.
+ * Every vector uses compare-and-subtract wrapping, like a `LucuVector` created
+ * with `lucu_vector_new`.
+ *
+ * Use at file scope. Defining the same name twice in one translation unit
+ * is an error, so put the definition in a shared header when several files
+ * use the same vector type.
+ * @param name Name of the handle type, also used as the prefix of every function.
+ * @param type The element type. Elements are copied by assignment.
+ */
+#define LUCU_VECTOR_DEFINE(name, type) \
+	typedef struct name##Data { \
+		type* v; \
+		int size; \
+		int head; \
+		int tail; \
+		double growth_factor; \
+	} name##Data; \
+	\
+	typedef name##Data* name; \
+	\
+	static inline int name##_wrap_index(const name vector, const int index) { \
+		if (index >= vector->size) { \
+			return index - vector->size; \
+		} \
+		if (index < 0) { \
+			return index + vector->size; \
+		} \
+		return index; \
+	} \
+	\
+	static inline name name##_new_with_size(const int length) { \
+		assert(length >= 0); \
+		name vector = malloc(sizeof(name##Data)); \
+		vector->size = (length > 0 ? length : LUCU_TYPED_VECTOR_INIT_SIZE) + 1; \
+		vector->v = malloc(sizeof(type) * (size_t)vector->size); \
+		vector->head = 0; \
+		vector->tail = 0; \
+		vector->growth_factor = LUCU_TYPED_VECTOR_SIZE_INCREASE; \
+		return vector; \
+	} \
+	\
+	static inline name name##_new(void) { \
+		return name##_new_with_size(0); \
+	} \
+	\
+	static inline name name##_from_array(const type* const arr, const int length) { \
+		assert(length > 0); \
+		name vector = name##_new_with_size(length); \
+		memcpy(vector->v, arr, sizeof(type) * (size_t)length); \
+		vector->tail = length; \
+		return vector; \
+	} \
+	\
+	static inline void name##_destroy(name vector) { \
+		free(vector->v); \
+		free(vector); \
+	} \
+	\
+	static inline bool name##_is_empty(const name vector) { \
+		return vector->head == vector->tail; \
+	} \
+	\
+	static inline int name##_length(const name vector) { \
+		const int length = vector->tail - vector->head; \
+		return length < 0 ? length + vector->size : length; \
+	} \
+	\
+	static inline int name##_capacity(const name vector) { \
+		return vector->size - 1; \
+	} \
+	\
+	static inline type* name##_get(const name vector, const int index) { \
+		assert(index >= 0 && index < name##_length(vector)); \
+		return &vector->v[name##_wrap_index(vector, vector->head + index)]; \
+	} \
+	\
+	static inline type* name##_to_array(const name vector, size_t* const size) { \
+		const int length = name##_length(vector); \
+		if (size != NULL) { \
+			*size = sizeof(type) * (size_t)length; \
+		} \
+		if (length == 0) { \
+			return NULL; \
+		} \
+		type* arr = malloc(sizeof(type) * (size_t)length); \
+		const int first = vector->tail >= vector->head ? length : vector->size - vector->head; \
+		memcpy(arr, &vector->v[vector->head], sizeof(type) * (size_t)first); \
+		memcpy(&arr[first], vector->v, sizeof(type) * (size_t)(length - first)); \
+		return arr; \
+	} \
+	\
+	static inline void name##_resize(name vector, const int size) { \
+		const int length = name##_length(vector); \
+		assert(size > length); \
+		if (vector->head == 0) { \
+			vector->v = realloc(vector->v, sizeof(type) * (size_t)size); \
+		} else { \
+			type* new_v = malloc(sizeof(type) * (size_t)size); \
+			const int first = vector->tail >= vector->head ? length : vector->size - vector->head; \
+			memcpy(new_v, &vector->v[vector->head], sizeof(type) * (size_t)first); \
+			memcpy(&new_v[first], vector->v, sizeof(type) * (size_t)(length - first)); \
+			free(vector->v); \
+			vector->v = new_v; \
+		} \
+		vector->size = size; \
+		vector->head = 0; \
+		vector->tail = length; \
+	} \
+	\
+	static inline void name##_reserve_more(name vector, const int additional) { \
+		const int needed = name##_length(vector) + additional + 1; \
+		if (needed <= vector->size) { \
+			return; \
+		} \
+		const int grown = (int)(vector->size * vector->growth_factor); \
+		name##_resize(vector, grown > needed ? grown : needed); \
+	} \
+	\
+	static inline void name##_reserve(name vector, const int length) { \
+		if (length + 1 > vector->size) { \
+			name##_resize(vector, length + 1); \
+		} \
+	} \
+	\
+	static inline void name##_shrink_to_fit(name vector) { \
+		const int size = name##_length(vector) + 1; \
+		if (size < vector->size) { \
+			name##_resize(vector, size); \
+		} \
+	} \
+	\
+	static inline void name##_set_growth_factor(name vector, const double growth_factor) { \
+		assert(growth_factor > 1); \
+		vector->growth_factor = growth_factor; \
+	} \
+	\
+	static inline void name##_push_back(name vector, const type data) { \
+		if (vector->head == name##_wrap_index(vector, vector->tail + 1)) { \
+			name##_reserve_more(vector, 1); \
+		} \
+		vector->v[vector->tail] = data; \
+		vector->tail = name##_wrap_index(vector, vector->tail + 1); \
+	} \
+	\
+	static inline void name##_push(name vector, const type data) { \
+		name##_push_back(vector, data); \
+	} \
+	\
+	static inline void name##_enqueue(name vector, const type data) { \
+		name##_push_back(vector, data); \
+	} \
+	\
+	static inline void name##_push_front(name vector, const type data) { \
+		if (name##_wrap_index(vector, vector->head - 1) == vector->tail) { \
+			name##_reserve_more(vector, 1); \
+		} \
+		vector->head = name##_wrap_index(vector, vector->head - 1); \
+		vector->v[vector->head] = data; \
+	} \
+	\
+	static inline void name##_copy_in(name vector, const int start, const type* const arr, const int length) { \
+		const int first = length < vector->size - start ? length : vector->size - start; \
+		memcpy(&vector->v[start], arr, sizeof(type) * (size_t)first); \
+		memcpy(vector->v, &arr[first], sizeof(type) * (size_t)(length - first)); \
+	} \
+	\
+	static inline void name##_append(name vector, const type* const arr, const int length) { \
+		assert(length >= 0); \
+		if (length == 0) { \
+			return; \
+		} \
+		name##_reserve_more(vector, length); \
+		name##_copy_in(vector, vector->tail, arr, length); \
+		vector->tail = name##_wrap_index(vector, vector->tail + length); \
+	} \
+	\
+	static inline void name##_prepend(name vector, const type* const arr, const int length) { \
+		assert(length >= 0); \
+		if (length == 0) { \
+			return; \
+		} \
+		name##_reserve_more(vector, length); \
+		vector->head = name##_wrap_index(vector, vector->head - length); \
+		name##_copy_in(vector, vector->head, arr, length); \
+	} \
+	\
+	static inline void name##_extend(name vector, const name other) { \
+		const int length = name##_length(other); \
+		if (length == 0) { \
+			return; \
+		} \
+		/* Reserve first, since `other` may be `vector` itself. */ \
+		name##_reserve_more(vector, length); \
+		const int first = other->tail >= other->head ? length : other->size - other->head; \
+		name##_copy_in(vector, vector->tail, &other->v[other->head], first); \
+		name##_copy_in(vector, name##_wrap_index(vector, vector->tail + first), other->v, length - first); \
+		vector->tail = name##_wrap_index(vector, vector->tail + length); \
+	} \
+	\
+	static inline bool name##_pop_front_into(name vector, type* const out) { \
+		if (name##_is_empty(vector)) { \
+			return false; \
+		} \
+		if (out != NULL) { \
+			*out = vector->v[vector->head]; \
+		} \
+		vector->head = name##_wrap_index(vector, vector->head + 1); \
+		return true; \
+	} \
+	\
+	static inline bool name##_dequeue_into(name vector, type* const out) { \
+		return name##_pop_front_into(vector, out); \
+	} \
+	\
+	static inline bool name##_pop_back_into(name vector, type* const out) { \
+		if (name##_is_empty(vector)) { \
+			return false; \
+		} \
+		vector->tail = name##_wrap_index(vector, vector->tail - 1); \
+		if (out != NULL) { \
+			*out = vector->v[vector->tail]; \
+		} \
+		return true; \
+	} \
+	\
+	static inline bool name##_pop_into(name vector, type* const out) { \
+		return name##_pop_back_into(vector, out); \
+	} \
+	\
+	static inline void name##_swap(name vector, const int index_1, const int index_2) { \
+		type* const a = name##_get(vector, index_1); \
+		type* const b = name##_get(vector, index_2); \
+		const type tmp = *a; \
+		*a = *b; \
+		*b = tmp; \
+	} \
+	\
+	static inline void name##_remove(name vector, const int index) { \
+		assert(index < name##_length(vector) && index >= 0); \
+		int i = name##_wrap_index(vector, vector->head + index); \
+		const int last = name##_wrap_index(vector, vector->tail - 1); \
+		while (i != last) { \
+			const int next = name##_wrap_index(vector, i + 1); \
+			vector->v[i] = vector->v[next]; \
+			i = next; \
+		} \
+		vector->tail = last; \
+	} \
+	\
+	static inline void name##_insert(name vector, const type data, const int index) { \
+		assert(index >= 0); \
+		if (index >= name##_length(vector)) { \
+			name##_push_back(vector, data); \
+			return; \
+		} \
+		if (vector->head == name##_wrap_index(vector, vector->tail + 1)) { \
+			name##_reserve_more(vector, 1); \
+		} \
+		const int in = name##_wrap_index(vector, vector->head + index); \
+		for (int i = vector->tail; i != in; ) { \
+			const int previous = name##_wrap_index(vector, i - 1); \
+			vector->v[i] = vector->v[previous]; \
+			i = previous; \
+		} \
+		vector->v[in] = data; \
+		vector->tail = name##_wrap_index(vector, vector->tail + 1); \
+	} \
+	\
+	static inline type* name##_make_contiguous(name vector) { \
+		if (vector->tail < vector->head && vector->tail != 0) { \
+			name##_resize(vector, vector->size); \
+		} \
+		return &vector->v[vector->head]; \
+	} \
+	\
+	typedef int name##Defined
+
+#endif
@@ -2,8 +2,10 @@
 #ifndef LUCU_VECTOR_H
 #define LUCU_VECTOR_H
 
+#include "lucu/allocator.h"
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct LucuVectorData LucuVectorData;
 /**
@@ -13,6 +15,138 @@ typedef struct LucuVectorData LucuVectorData;
  */
 typedef LucuVectorData* LucuVector;
 
+/**
+ * The data behind a `LucuVector`.
+ *
+ * Only defined here so that the most frequently used accessors can be
+ * inlined. Treat every field as private and use the `lucu_vector_`
+ * functions instead. Since those accessors are compiled into programs
+ * using liblucu, the layout is part of its ABI and only changes with
+ * a new major version.
+ */
+struct LucuVectorData {
+	/// Array where elements are stored
+	void* v;
+	/// The number of bytes that an element takes up
+	size_t bytewidth;
+	/// Number of elements that can be stored in the currently allocated space.
+	/// **Not** the number of elements in the array.
+	/// **Not** the number of bytes allocated.
+	int size;
+	/// The index of the first element of the circular array.
+	int head;
+	/// The index of the last element of the circular array plus 1 mod `size`.
+	int tail;
+	/// If `size` is kept at a power of two, so indexes can be wrapped with a mask.
+	bool power_of_two;
+	/// What `size` is multiplied by when the vector runs out of space.
+	double growth_factor;
+	/// Function used to free elements of the `LucuVector`.
+	/// See `lucu_vector_new` for more information
+	void (*free_function)(void*);
+	/// If `v` was allocated on its own and has to be freed along with the vector.
+	/// `false` while the elements are stored in the same allocation as the
+	/// vector or in a buffer given to `lucu_vector_init`.
+	bool owns_v;
+	/// Number of elements that fit in storage following the vector in its own
+	/// allocation, which `lucu_vector_new_with_allocator` makes for small
+	/// vectors. 0 if there is none. Only used for `LucuVectorHooks`.
+	int inline_size;
+	/// Where the vector gets its memory from. See `lucu_vector_new_with_allocator`.
+	LucuAllocator allocator;
+};
+
+/**
+ * The type of the key `lucu_vector_sort_by_key` sorts by.
+ */
+typedef enum LucuVectorKeyType {
+	/// `uint32_t`
+	LUCU_VECTOR_KEY_UINT32,
+	/// `int32_t`
+	LUCU_VECTOR_KEY_INT32,
+	/// `uint64_t`
+	LUCU_VECTOR_KEY_UINT64,
+	/// `int64_t`
+	LUCU_VECTOR_KEY_INT64,
+	/// `float`
+	LUCU_VECTOR_KEY_FLOAT,
+	/// `double`
+	LUCU_VECTOR_KEY_DOUBLE,
+} LucuVectorKeyType;
+
+/**
+ * A run of elements of a `LucuVector` that are next to each other in memory.
+ *
+ * See `lucu_vector_spans`.
+ */
+typedef struct LucuVectorSpan {
+	/// Pointer to the first element of the span.
+	void* data;
+	/// Number of elements in the span.
+	int length;
+} LucuVectorSpan;
+
+/**
+ * Whether `lucu_vector_set_hooks` calls any hooks.
+ *
+ * Defined to 0 for everything linking liblucu when it is configured with
+ * `LIBLUCU_VECTOR_HOOKS` off, which compiles out every trace of the hooks.
+ */
+#ifndef LUCU_VECTOR_HOOKS
+#define LUCU_VECTOR_HOOKS 1
+#endif
+
+/**
+ * Functions called when any `LucuVector` allocates or frees memory.
+ *
+ * Installed with `lucu_vector_set_hooks`. Only the memory elements are stored
+ * in is reported, not the vector itself or scratch space used while sorting,
+ * and not buffers given to `lucu_vector_init`. Sizes are in bytes and include
+ * the one slot a vector always leaves empty. The bytes reported by `on_alloc`
+ * minus those reported by `on_free` is how much element storage is allocated,
+ * including the storage a small vector keeps in its own allocation, which is
+ * only freed along with the vector. Any function can be `NULL`.
+ * They are called on whichever thread changes the vector, with the hooks' `params`.
+ */
+typedef struct LucuVectorHooks {
+	/// Called after `vector` allocates `bytes` bytes to store elements in.
+	void (*on_alloc)(const LucuVector vector, size_t bytes, void* params);
+	/// Called when `vector` is done with `bytes` bytes it allocated to store elements in.
+	void (*on_free)(const LucuVector vector, size_t bytes, void* params);
+	/// Called after the capacity of `vector` grows, with `bytes_copied` bytes
+	/// of elements copied to the new memory. `bytes_copied` is 0 when
+	/// `realloc` could grow the memory in place.
+	void (*on_grow)(const LucuVector vector, int old_capacity, int new_capacity, size_t bytes_copied, void* params);
+	/// Called after the capacity of `vector` shrinks. Like `on_grow`.
+	void (*on_shrink)(const LucuVector vector, int old_capacity, int new_capacity, size_t bytes_copied, void* params);
+	/// Passed to every function.
+	void* params;
+} LucuVectorHooks;
+
+/**
+ * Wraps an index into the allocated space of a `LucuVector`.
+ *
+ * Used by the inline accessors, which is why it is in this header.
+ * Replaces a modulo with a mask or a comparison, which is much cheaper
+ * than integer division.
+ * @param vector The `LucuVector` the index belongs to.
+ * @param index Index into the allocated space of `vector`, offset by at most
+ * one `size` in either direction.
+ * @return `index` mod the allocated size of `vector`.
+ */
+static inline int lucu_vector_wrap_index(const LucuVector vector, const int index) {
+	if (vector->power_of_two) {
+		return index & (vector->size - 1);
+	}
+	if (index >= vector->size) {
+		return index - vector->size;
+	}
+	if (index < 0) {
+		return index + vector->size;
+	}
+	return index;
+}
+
 /**
  * Create a new `LucuVector`.
  *
@@ -31,13 +165,44 @@ LucuVector lucu_vector_new(const size_t bytewidth, void (*free_function)(void*))
  * Create a `LucuVector` with a specified allocated size
  *
  * Creates a `LucuVector` so that it can hold `length` elements
- * without needing to reallocate.
+ * without needing to reallocate. If the elements take up at most 256 bytes,
+ * the vector and its elements share a single allocation.
  * @param length Number of elements to allocate memory for.
  * @param bytewidth The number of bytes that an element takes up.
  * @param free_function Function used to free elements (see `lucu_vector_new`).
  */
 LucuVector lucu_vector_new_with_size(const int length, const size_t bytewidth, void (*free_function)(void*));
 
+/**
+ * Create a `LucuVector` that gets its memory from a `LucuAllocator`.
+ *
+ * Behaves the same as a `LucuVector` created with `lucu_vector_new_with_size`,
+ * but the vector, its elements, all memory used while sorting, and
+ * vectors created from it with `lucu_vector_filter` and `lucu_vector_map`
+ * are all allocated from `allocator`. Memory returned to the caller, such as
+ * by `lucu_vector_pop_front` and `lucu_vector_to_array`, still comes from
+ * `malloc` so that it can be freed with `free`.
+ * @param length Number of elements to allocate memory for.
+ * @param bytewidth The number of bytes that an element takes up.
+ * @param free_function Function used to free elements (see `lucu_vector_new`).
+ * @param allocator The `LucuAllocator` to use, which is copied.
+ * Can be `NULL` to use `malloc`.
+ */
+LucuVector lucu_vector_new_with_allocator(const int length, const size_t bytewidth, void (*free_function)(void*), const LucuAllocator* allocator);
+
+/**
+ * Create a `LucuVector` that keeps its allocated size at a power of two.
+ *
+ * Behaves the same as a `LucuVector` created with `lucu_vector_new_with_size`,
+ * but wrapping indexes around the circular array only takes a bit mask.
+ * In exchange, the vector always grows by doubling (ignoring
+ * `lucu_vector_set_growth_factor`) and may use up to twice the memory.
+ * @param length Number of elements to allocate memory for, at least.
+ * @param bytewidth The number of bytes that an element takes up.
+ * @param free_function Function used to free elements (see `lucu_vector_new`).
+ */
+LucuVector lucu_vector_new_power_of_two(const int length, const size_t bytewidth, void (*free_function)(void*));
+
 /**
  * Deconstructs a `LucuVector`.
  *
@@ -46,6 +211,34 @@ LucuVector lucu_vector_new_with_size(const int length, const size_t bytewidth, v
  */
 void lucu_vector_destroy(LucuVector vector);
 
+/**
+ * Initializes a `LucuVector` in memory provided by the caller.
+ *
+ * Makes no heap allocations until the vector outgrows `buffer`, after which
+ * the elements are moved to memory the vector allocates itself. Both `vector`
+ * and `buffer` can be on the stack, which suits short lived vectors with a
+ * small expected length. `buffer` is never freed by the `LucuVector`.
+ * @param vector Memory to hold the vector itself.
+ * @param buffer Memory to store elements in, suitably aligned for them.
+ * @param buffer_length The number of elements `buffer` has room for. **Must** be greater
+ * than 0. The vector holds up to `buffer_length - 1` elements before allocating.
+ * @param bytewidth The number of bytes that an element takes up.
+ * @param free_function Function used to free elements (see `lucu_vector_new`).
+ * @return `vector`, to be used like any other `LucuVector`.
+ * Clean it up with `lucu_vector_deinit`, **not** `lucu_vector_destroy`.
+ */
+LucuVector lucu_vector_init(LucuVectorData* vector, void* buffer, const int buffer_length, const size_t bytewidth, void (*free_function)(void*));
+
+/**
+ * Frees the elements of a `LucuVector` created with `lucu_vector_init`.
+ *
+ * Also frees any memory the vector allocated after outgrowing its buffer,
+ * but not the `LucuVectorData` or the buffer passed to `lucu_vector_init`.
+ * @post `vector` will no longer be useable.
+ * @param vector The `LucuVector` to clean up.
+ */
+void lucu_vector_deinit(LucuVector vector);
+
 /**
  * Creates a new `LucuVector` from an existing array.
  *
@@ -86,7 +279,9 @@ void lucu_vector_print(const LucuVector vector, void (*print_function)(void*, vo
  * @param vector The `LucuVector` to test.
  * @return `bool` of if `vector` is empty.
  */
-bool lucu_vector_is_empty(const LucuVector vector);
+static inline bool lucu_vector_is_empty(const LucuVector vector) {
+	return vector->head == vector->tail;
+}
 
 /**
  * Length of a `LucuVector`.
@@ -95,7 +290,80 @@ bool lucu_vector_is_empty(const LucuVector vector);
  * @param vector The `LucuVector` to test.
  * @return The number of elements in `vector`.
  */
-int lucu_vector_length(const LucuVector vector);
+static inline int lucu_vector_length(const LucuVector vector) {
+	return (vector->tail < vector->head ? vector->tail + vector->size : vector->tail) - vector->head;
+}
+
+/**
+ * Number of elements a `LucuVector` can hold without reallocating.
+ *
+ * @param vector The `LucuVector` to test.
+ * @return The number of elements that fit in the memory allocated to `vector`.
+ * Always at least `lucu_vector_length(vector)`.
+ */
+int lucu_vector_capacity(const LucuVector vector);
+
+/**
+ * Number of bytes each element of a `LucuVector` takes up.
+ *
+ * @param vector The `LucuVector` to test.
+ * @return The `bytewidth` `vector` was created with.
+ */
+size_t lucu_vector_bytewidth(const LucuVector vector);
+
+/**
+ * Number of bytes of memory a `LucuVector` has to store elements in.
+ *
+ * Compare with `lucu_vector_length(vector) * lucu_vector_bytewidth(vector)`
+ * to see how much of it is unused.
+ * @param vector The `LucuVector` to test.
+ * @return The size of the element storage of `vector`, including the one
+ * slot it always leaves empty.
+ */
+size_t lucu_vector_allocated_bytes(const LucuVector vector);
+
+/**
+ * Sets the functions called when any `LucuVector` allocates or frees memory.
+ *
+ * Meant for finding out how vectors are sized in a real program, for example
+ * to pick better initial sizes. Does nothing if `LUCU_VECTOR_HOOKS` is 0.
+ * With no hooks set, vectors only pay for one atomic load each time they
+ * allocate or free.
+ * @param hooks The `LucuVectorHooks` to call. Not copied, so it **must** stay
+ * valid until other hooks are set. Can be `NULL` to stop calling hooks.
+ */
+void lucu_vector_set_hooks(const LucuVectorHooks* hooks);
+
+/**
+ * Makes sure a `LucuVector` can hold `length` elements without reallocating.
+ *
+ * Does nothing if `vector` can already hold `length` elements.
+ * Otherwise allocates room for exactly `length` elements.
+ * @param vector The `LucuVector` to reserve space in.
+ * @param length The number of elements `vector` should be able to hold.
+ */
+void lucu_vector_reserve(LucuVector vector, const int length);
+
+/**
+ * Frees any memory a `LucuVector` isn't using to hold elements.
+ *
+ * Afterwards the capacity of `vector` equals its length,
+ * so the next push will reallocate. Does nothing while the elements are
+ * stored in the same allocation as the vector or in a buffer given to
+ * `lucu_vector_init`, since moving them wouldn't free any memory.
+ * @param vector The `LucuVector` to shrink.
+ */
+void lucu_vector_shrink_to_fit(LucuVector vector);
+
+/**
+ * Sets how much a `LucuVector` grows when it runs out of space.
+ *
+ * When a push doesn't fit, the allocated size is multiplied by `growth_factor`.
+ * Larger factors reallocate less often but waste more memory. Defaults to 1.5.
+ * @param vector The `LucuVector` to configure.
+ * @param growth_factor Multiplier applied to the size. **Must** be greater than 1.
+ */
+void lucu_vector_set_growth_factor(LucuVector vector, const double growth_factor);
 
 /**
  * Push an element to the back of a `LucuVector`.
@@ -117,6 +385,39 @@ void lucu_vector_push_back(LucuVector vector, const void* data);
  */
 void lucu_vector_push_front(LucuVector vector, const void* data);
 
+/**
+ * Push an array of elements to the back of a `LucuVector`.
+ *
+ * Same as calling `lucu_vector_push_back` for each element of `arr`
+ * in order, but allocates at most once and copies with at most two `memcpy`s.
+ * @param vector The `LucuVector` to append data to.
+ * @param arr Array of elements to copy into `vector`.
+ * @param length The number of elements in `arr`.
+ */
+void lucu_vector_append(LucuVector vector, const void* const arr, const int length);
+
+/**
+ * Push an array of elements to the front of a `LucuVector`.
+ *
+ * Afterwards the first `length` elements of `vector` are the elements of
+ * `arr` in the same order. Allocates at most once and copies with at most
+ * two `memcpy`s.
+ * @param vector The `LucuVector` to prepend data to.
+ * @param arr Array of elements to copy into `vector`.
+ * @param length The number of elements in `arr`.
+ */
+void lucu_vector_prepend(LucuVector vector, const void* const arr, const int length);
+
+/**
+ * Push the elements of another `LucuVector` to the back of a `LucuVector`.
+ *
+ * Elements are copied, so `other` is unchanged.
+ * @param vector The `LucuVector` to append data to.
+ * @param other The `LucuVector` to copy elements from. **Must** have the same
+ * `bytewidth` as `vector`. Can be `vector` itself.
+ */
+void lucu_vector_extend(LucuVector vector, const LucuVector other);
+
 /**
  * Pop an element from the front of a `LucuVector`.
  *
@@ -137,6 +438,30 @@ void* lucu_vector_pop_front(LucuVector vector);
  */
 void* lucu_vector_pop_back(LucuVector vector);
 
+/**
+ * Pop an element from the front of a `LucuVector` without allocating.
+ *
+ * Same as `lucu_vector_pop_front`, but copies the element into
+ * memory provided by the caller instead of a newly allocated buffer.
+ * @param vector The `LucuVector` to pop from.
+ * @param[out] out Where the element is copied to. **Must** have room for
+ * the `bytewidth` used to create `vector`. Can be `NULL` to discard the element.
+ * @return `true` if an element was popped, `false` if `vector` is empty,
+ * in which case `out` is left untouched.
+ */
+bool lucu_vector_pop_front_into(LucuVector vector, void* const out);
+
+/**
+ * Pop an element from the back of a `LucuVector` without allocating.
+ *
+ * Same as `lucu_vector_pop_back`, but copies the element into
+ * memory provided by the caller instead of a newly allocated buffer.
+ * @param vector The `LucuVector` to pop from.
+ * @param[out] out Where the element is copied to (see `lucu_vector_pop_front_into`).
+ * @return `true` if an element was popped, `false` if `vector` is empty.
+ */
+bool lucu_vector_pop_back_into(LucuVector vector, void* const out);
+
 /**
  * Alias for `lucu_vector_push_back`.
  * Useful when using a `LucuVector` as a stack.
@@ -149,6 +474,12 @@ void lucu_vector_push(LucuVector vector, const void* data);
  */
 void* lucu_vector_pop(LucuVector vector);
 
+/**
+ * Alias for `lucu_vector_pop_back_into`.
+ * Useful when using a `LucuVector` as a stack.
+ */
+bool lucu_vector_pop_into(LucuVector vector, void* const out);
+
 /**
  * Alias for `lucu_vector_push_back`.
  * Useful when using a `LucuVector` as a queue.
@@ -161,6 +492,12 @@ void lucu_vector_enqueue(LucuVector vector, const void* data);
  */
 void* lucu_vector_dequeue(LucuVector vector);
 
+/**
+ * Alias for `lucu_vector_pop_front_into`.
+ * Useful when using a `LucuVector` as a queue.
+ */
+bool lucu_vector_dequeue_into(LucuVector vector, void* const out);
+
 /**
  * Swap the elements of `vector` at `index_1` and `index_2`.
  * @param vector `LucuVector` to modify.
@@ -192,26 +529,84 @@ int lucu_vector_index(LucuVector vector, void* const data, bool (*equal)(void*,
  * @return Pointer to the element at `index`.
  * @pre `index` **must** be a valid index within the bounds of `vector`. Otherwise will give a pointer to junk data.
  */
-void* lucu_vector_get(const LucuVector vector, const int index);
+static inline void* lucu_vector_get(const LucuVector vector, const int index) {
+	return (void*)((uintptr_t)vector->v + (size_t)lucu_vector_wrap_index(vector, vector->head + index) * vector->bytewidth);
+}
 
 /**
  * Remove an element from a `LucuVector`.
  *
+ * Shifts whichever of the elements before or after `index` are fewer,
+ * so removing near either end is cheap.
  * @param vector `LucuVector` to remove element from.
  * @param index Index of the element to remove.
  * @pre `index` **must** be a valid index within the bounds of `vector`.
  */
 void lucu_vector_remove(LucuVector vector, const int index);
 
+/**
+ * Remove a range of elements from a `LucuVector`.
+ *
+ * Frees the removed elements, then closes the gap by moving whichever
+ * side of it is shorter with at most three `memmove`s, so removing `length`
+ * elements costs one shift instead of `length`.
+ * @param vector `LucuVector` to remove elements from.
+ * @param index Index of the first element to remove.
+ * @param length Number of elements to remove.
+ * @pre `index + length` **must** not be greater than the length of `vector`.
+ */
+void lucu_vector_remove_range(LucuVector vector, const int index, const int length);
+
 /**
  * Insert an element at an index into a `LucuVector`.
  *
+ * Shifts whichever of the elements before or after `index` are fewer.
  * @param vector 'LucuVector' to insert into.
  * @param data Element to insert and copy into `vector`.
- * @param index Index to insert into.
+ * @param index Index to insert into. Pushes to the back if it is past the end.
 */
 void lucu_vector_insert(LucuVector vector, const void* const data, const int index);
 
+/**
+ * Insert an array of elements at an index into a `LucuVector`.
+ *
+ * Afterwards the elements of `arr` start at `index`, in the same order.
+ * Allocates at most once and opens the gap with a single shift of
+ * whichever side of `index` is shorter.
+ * @param vector 'LucuVector' to insert into.
+ * @param arr Array of elements to copy into `vector`.
+ * @param length The number of elements in `arr`.
+ * @param index Index to insert the first element at.
+ * **Must** not be greater than the length of `vector`.
+ */
+void lucu_vector_insert_range(LucuVector vector, const void* const arr, const int length, const int index);
+
+/**
+ * Gets the elements of a `LucuVector` as contiguous runs of memory.
+ *
+ * A `LucuVector` is a circular array, so its elements are stored in at most
+ * two runs: from the front element to the end of the allocation, and from
+ * the start of the allocation to the back element. Looping over the spans
+ * directly avoids calling a function per element like `lucu_vector_iterate` does.
+ * The spans are valid until `vector` is next modified.
+ * @param vector `LucuVector` to get the elements of.
+ * @param[out] spans Set to the runs of elements, in order.
+ * Only the first as many as are returned are set.
+ * @return The number of spans, which is 0 if `vector` is empty and at most 2.
+ */
+int lucu_vector_spans(const LucuVector vector, LucuVectorSpan spans[2]);
+
+/**
+ * Rearranges a `LucuVector` so all its elements are contiguous.
+ *
+ * Afterwards `lucu_vector_spans` returns at most one span, until the
+ * vector is modified in a way that wraps it around again.
+ * Takes *O(n)* time if the elements aren't contiguous already and *O(1)* if they are.
+ * @param vector `LucuVector` to rearrange.
+ * @return Pointer to the first element of `vector`, followed directly by the rest.
+ */
+void* lucu_vector_make_contiguous(LucuVector vector);
+
 /**
  * Iterate over elements of a `LucuVector`.
  *
@@ -268,14 +663,55 @@ void* lucu_vector_min_max(LucuVector vector, bool (* const compare_function)(voi
 /**
  * Sorts a `LucuVector`.
  *
- * Modifies `vector` so that it is sorted.
- * Takes *O(n log(n))* time and *O(n)* extra space.
+ * Modifies `vector` so that it is sorted. The sort is stable: elements
+ * that neither should be sorted before the other keep their order.
+ * Takes *O(n log(n))* time and *O(n)* extra space, allocated once.
  * @param vector `LucuVector` to sort.
  * @param compare_function Function used to compare two elements.
  * Takes a pointer to each element and `params`. Returns `true` if
  * the first element should be sorted before the second element and
  * `false` if the second element should be sorted before the first element.
+ * Must return `false` for equal elements, like `<` rather than `<=`.
+ * A comparison that returns `true` for equal elements still sorts
+ * `vector`, but equal elements may not keep their order.
  */
 void lucu_vector_sort(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params);
 
+/**
+ * Sorts a `LucuVector` using several threads.
+ *
+ * Sorts the same way as `lucu_vector_sort`, including keeping equal
+ * elements in order. The vector is split into a chunk per thread,
+ * the chunks are sorted at the same time, and then merged with every
+ * merge split between the threads. Vectors too short to be worth
+ * splitting are sorted on the calling thread.
+ * @param vector `LucuVector` to sort.
+ * @param compare_function Function used to compare two elements
+ * (see `lucu_vector_sort`). Must return `false` for equal elements
+ * for them to keep their order. Called from several threads at once,
+ * so it **must** be safe to do so with `params`.
+ * @param params Passed to compare_function.
+ * @param thread_count The most threads to use, including the calling thread.
+ * Can be 0 to use one per online processor.
+ */
+void lucu_vector_sort_parallel(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params, int thread_count);
+
+/**
+ * Sorts a `LucuVector` by a number stored in each element.
+ *
+ * Sorts in ascending order of the key, keeping elements with equal keys
+ * in order, like `lucu_vector_sort` with a less than comparison on the key.
+ * Uses a radix sort instead of calling a compare function, taking *O(n)*
+ * time and *O(n)* extra space, allocated once.
+ *
+ * Floating point keys are ordered by their sign and then their magnitude,
+ * so `-0.0` comes before `0.0`, and `NaN`s come before `-INFINITY` or after
+ * `INFINITY` depending on their sign bit.
+ * @param vector `LucuVector` to sort.
+ * @param key_type The type of the key.
+ * @param key_offset The offset of the key in bytes from the start of each element.
+ * The key does not have to be aligned.
+ */
+void lucu_vector_sort_by_key(LucuVector vector, const LucuVectorKeyType key_type, const size_t key_offset);
+
 #endif
@@ -0,0 +1,45 @@
+/// @file align.h
+/// Sizes and rounding shared by the containers of liblucu.
+#ifndef LUCU_SRC_ALIGN_H
+#define LUCU_SRC_ALIGN_H
+
+#include <assert.h>
+#include <limits.h>
+#include <stdalign.h>
+#include <stddef.h>
+
+/**
+ * Size of a cache line.
+ *
+ * Data written by different threads is aligned to this so that writing
+ * one doesn't invalidate the cache line holding the other.
+ */
+#define LUCU_CACHE_LINE_SIZE 64
+
+/**
+ * Rounds `n` up to a multiple of `align`.
+ */
+static inline size_t round_up(const size_t n, const size_t align) {
+	return (n + align - 1) / align * align;
+}
+
+/**
+ * Rounds `n` up so that memory following `n` bytes is aligned for any type.
+ */
+static inline size_t align_up(const size_t n) {
+	return round_up(n, alignof(max_align_t));
+}
+
+/**
+ * Smallest power of two that is at least `n`.
+ */
+static inline int next_power_of_two(const int n) {
+	assert(n <= INT_MAX / 2 + 1);
+	int p = 1;
+	while (p < n) {
+		p *= 2;
+	}
+	return p;
+}
+
+#endif
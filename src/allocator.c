@@ -0,0 +1,35 @@
+#include "lucu/allocator.h"
+#include <string.h>
+
+void* lucu_allocate(const LucuAllocator* allocator, const size_t size) {
+	if (allocator == NULL || allocator->allocate == NULL) {
+		return malloc(size);
+	}
+	return allocator->allocate(size, allocator->params);
+}
+
+void* lucu_reallocate(const LucuAllocator* allocator, void* ptr, const size_t old_size, const size_t new_size) {
+	if (allocator == NULL || allocator->allocate == NULL) {
+		return realloc(ptr, new_size);
+	}
+	if (allocator->reallocate != NULL) {
+		return allocator->reallocate(ptr, old_size, new_size, allocator->params);
+	}
+	void* new_ptr = allocator->allocate(new_size, allocator->params);
+	if (ptr != NULL) {
+		memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+		lucu_deallocate(allocator, ptr);
+	}
+	return new_ptr;
+}
+
+void lucu_deallocate(const LucuAllocator* allocator, void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	if (allocator == NULL || allocator->allocate == NULL) {
+		free(ptr);
+	} else if (allocator->deallocate != NULL) {
+		allocator->deallocate(ptr, allocator->params);
+	}
+}
@@ -0,0 +1,123 @@
+#include "lucu/arena.h"
+#include "align.h"
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Default size in bytes of the blocks of a `LucuArena`.
+ */
+#define LUCU_ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock {
+	struct ArenaBlock* next;
+	/// Number of bytes of data in the block.
+	size_t size;
+	/// Number of bytes of data handed out.
+	size_t used;
+} ArenaBlock;
+
+struct LucuArenaData {
+	ArenaBlock* first;
+	/// The block being allocated from. Blocks after it are unused.
+	ArenaBlock* current;
+	size_t block_size;
+	/// The most recent allocation, which can still be resized or freed.
+	void* last;
+};
+
+static void* block_data(ArenaBlock* block) {
+	return (void*)((uintptr_t)block + align_up(sizeof(ArenaBlock)));
+}
+
+static ArenaBlock* block_new(const size_t size, ArenaBlock* next) {
+	ArenaBlock* block = malloc(align_up(sizeof(ArenaBlock)) + size);
+	block->next = next;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+LucuArena lucu_arena_new(const size_t block_size) {
+	LucuArena arena = malloc(sizeof(LucuArenaData));
+	arena->block_size = block_size > 0 ? align_up(block_size) : LUCU_ARENA_BLOCK_SIZE;
+	arena->first = block_new(arena->block_size, NULL);
+	arena->current = arena->first;
+	arena->last = NULL;
+	return arena;
+}
+
+void lucu_arena_destroy(LucuArena arena) {
+	ArenaBlock* block = arena->first;
+	while (block != NULL) {
+		ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	free(arena);
+}
+
+void* lucu_arena_alloc(LucuArena arena, const size_t size) {
+	const size_t aligned = align_up(size > 0 ? size : 1);
+	ArenaBlock* block = arena->current;
+	if (block->size - block->used < aligned) {
+		// Move on to the next block, unless it is too small for this allocation.
+		ArenaBlock* next = block->next;
+		if (next == NULL || next->size < aligned) {
+			next = block_new(aligned > arena->block_size ? aligned : arena->block_size, next);
+			block->next = next;
+		}
+		next->used = 0;
+		arena->current = next;
+		block = next;
+	}
+	void* ptr = (void*)((uintptr_t)block_data(block) + block->used);
+	block->used += aligned;
+	arena->last = ptr;
+	return ptr;
+}
+
+void lucu_arena_reset(LucuArena arena) {
+	arena->current = arena->first;
+	arena->first->used = 0;
+	arena->last = NULL;
+}
+
+static void* arena_allocate(size_t size, void* arena) {
+	return lucu_arena_alloc(arena, size);
+}
+
+static void* arena_reallocate(void* ptr, size_t old_size, size_t new_size, void* a) {
+	LucuArena arena = a;
+	if (ptr != NULL && ptr == arena->last) {
+		ArenaBlock* block = arena->current;
+		const size_t offset = (size_t)((uintptr_t)ptr - (uintptr_t)block_data(block));
+		if (block->size - offset >= align_up(new_size)) {
+			block->used = offset + align_up(new_size);
+			return ptr;
+		}
+	}
+	void* new_ptr = lucu_arena_alloc(arena, new_size);
+	if (ptr != NULL) {
+		memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+	}
+	return new_ptr;
+}
+
+static void arena_deallocate(void* ptr, void* a) {
+	LucuArena arena = a;
+	if (ptr == arena->last) {
+		arena->current->used = (size_t)((uintptr_t)ptr - (uintptr_t)block_data(arena->current));
+		arena->last = NULL;
+	}
+}
+
+LucuAllocator lucu_arena_allocator(LucuArena arena) {
+	return (LucuAllocator){
+		.allocate = arena_allocate,
+		.reallocate = arena_reallocate,
+		.deallocate = arena_deallocate,
+		.params = arena,
+	};
+}
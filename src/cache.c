@@ -1,13 +1,39 @@
 #include "lucu/cache.h"
-#include "lucu/lucu.h"
 #include "lucu/vector.h"
+#include "cache_stats.h"
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Queue of `KeyValue`s that have made it past admission.
+#define QUEUE_MAIN 0
+/// Probationary queue used by `LUCU_CACHE_S3FIFO` for newly inserted `KeyValue`s.
+#define QUEUE_SMALL 1
+/// Highest value a `KeyValue`'s `freq` is allowed to reach.
+#define FREQ_MAX 3
+/// Bytes of bookkeeping `lucu_cache_get_batch` needs per key.
+#define BATCH_KEY_SIZE (2 * sizeof(size_t) + sizeof(void*) + 3 * sizeof(int))
+/// Most keys `lucu_cache_get_batch` keeps its bookkeeping on the stack for.
+#define BATCH_STACK_LENGTH 64
 
 typedef struct KeyValue {
 	void* key;
 	void* value;
 	void (*key_free_function)(void*);
 	void (*value_free_function)(void*);
+	/// Hash of `key`. Only meaningful if the cache has a `key_hash_function`.
+	size_t hash;
+	/// Slot of the previous `KeyValue` in the same queue, or -1.
+	int prev;
+	/// Slot of the next `KeyValue` in the same queue, or -1.
+	int next;
+	/// Which queue the `KeyValue` is in.
+	unsigned char queue;
+	/// Saturating count of hits used by `LUCU_CACHE_CLOCK` and `LUCU_CACHE_S3FIFO`.
+	unsigned char freq;
+	/// Set while `lucu_cache_get_batch` is returning the value, so it isn't evicted.
+	bool pinned;
 } KeyValue;
 
 static void keyvalue_destroy(void* keyvalue) {
@@ -20,69 +46,728 @@ static void keyvalue_destroy(void* keyvalue) {
 	}
 }
 
+/**
+ * A doubly linked list of slots.
+ */
+typedef struct Queue {
+	/// Slot at the front of the queue, or -1 if empty.
+	int first;
+	/// Slot at the back of the queue, or -1 if empty.
+	int last;
+	/// Number of slots in the queue.
+	int length;
+} Queue;
+
+/**
+ * An entry of an open addressing hash index.
+ */
+typedef struct IndexSlot {
+	/// Hash of the key, as returned by `key_hash_function`.
+	size_t hash;
+	/// Slot the entry refers to, or -1 if unused.
+	int slot;
+} IndexSlot;
+
+/**
+ * The operations that make up a `LucuCachePolicy`.
+ *
+ * Policies only decide eviction order. Finding keys, storing
+ * `KeyValue`s and freeing them is shared between all policies.
+ */
+typedef struct CachePolicy {
+	/// Allocates any state the policy needs.
+	void (*init)(LucuCache cache);
+	/// Picks the queue a new key with the given hash is inserted into.
+	/// Called before making room for the key.
+	int (*admit)(LucuCache cache, const size_t hash);
+	/// Records a hit on a slot.
+	void (*hit)(LucuCache cache, const int slot);
+	/// Picks the next slot to evict and removes it from eviction order.
+	int (*victim)(LucuCache cache);
+	/// Frees anything allocated by `init`.
+	void (*destroy)(LucuCache cache);
+} CachePolicy;
+
 struct LucuCacheData {
+	/// `KeyValue`s stored by slot. Once filled, a slot is only ever
+	/// overwritten in place, so slots can be used as stable handles.
 	LucuVector cache;
 	int cache_size;
+	const CachePolicy* policy;
 	bool (*keys_equal_function)(void*, void*, void*);
 	void* keys_equal_function_params;
+	size_t (*key_hash_function)(void*, void*);
 	void* (*generate_function)(void*);
 	void (*key_free_function)(void*);
 	void (*value_free_function)(void*);
+	/// Eviction order. Policies other than `LUCU_CACHE_S3FIFO` only use `QUEUE_MAIN`.
+	Queue queues[2];
+	/// Linear probing index of the keys in `cache`.
+	/// `NULL` if the cache was created without a `key_hash_function`.
+	IndexSlot* index;
+	/// Number of slots in `index`. Always a power of two.
+	size_t index_size;
+	/// Ring of hashes of keys recently evicted from `QUEUE_SMALL`, used by `LUCU_CACHE_S3FIFO`.
+	size_t* ghost;
+	/// Position of the oldest hash in `ghost`.
+	int ghost_head;
+	/// Number of hashes in `ghost`.
+	int ghost_length;
+	/// Index of the hashes in `ghost`, referring to their position in `ghost`.
+	IndexSlot* ghost_index;
+	/// Where the cache gets its memory from.
+	LucuAllocator allocator;
+	/// Counts of what the cache has been doing, or `NULL` if not counting.
+	LucuCacheStats* stats;
+	/// Whether to time `lucu_cache_get` and `generate_function` while counting.
+	bool stats_timing;
+};
+
+/**
+ * The stats to count into, or `NULL` if not counting.
+ *
+ * Always `NULL` without `LUCU_CACHE_STATS`, so the compiler drops
+ * every `if` that checks it.
+ */
+static inline LucuCacheStats* stats_of(const LucuCache cache) {
+	return LUCU_CACHE_STATS ? cache->stats : NULL;
+}
+
+static KeyValue* slot_get(const LucuCache cache, const int slot) {
+	return lucu_vector_get(cache->cache, slot);
+}
+
+static void queue_remove(LucuCache cache, const int slot) {
+	KeyValue* kv = slot_get(cache, slot);
+	Queue* queue = &cache->queues[kv->queue];
+	if (kv->prev == -1) {
+		queue->first = kv->next;
+	} else {
+		slot_get(cache, kv->prev)->next = kv->next;
+	}
+	if (kv->next == -1) {
+		queue->last = kv->prev;
+	} else {
+		slot_get(cache, kv->next)->prev = kv->prev;
+	}
+	queue->length--;
+}
+
+static void queue_append(LucuCache cache, const int queue_id, const int slot) {
+	KeyValue* kv = slot_get(cache, slot);
+	Queue* queue = &cache->queues[queue_id];
+	kv->queue = (unsigned char)queue_id;
+	kv->prev = queue->last;
+	kv->next = -1;
+	if (queue->last == -1) {
+		queue->first = slot;
+	} else {
+		slot_get(cache, queue->last)->next = slot;
+	}
+	queue->last = slot;
+	queue->length++;
+}
+
+/**
+ * Removes and returns the slot at the front of a queue.
+ */
+static int queue_pop(LucuCache cache, const int queue_id) {
+	const int slot = cache->queues[queue_id].first;
+	queue_remove(cache, slot);
+	return slot;
+}
+
+static IndexSlot* index_new(LucuCache cache, const size_t index_size) {
+	IndexSlot* index = lucu_allocate(&cache->allocator, sizeof(IndexSlot) * index_size);
+	for (size_t i = 0; i < index_size; i++) {
+		index[i].slot = -1;
+	}
+	return index;
+}
+
+static void index_insert(IndexSlot* index, const size_t index_size, const size_t hash, const int slot) {
+	const size_t mask = index_size - 1;
+	size_t i = hash & mask;
+	while (index[i].slot != -1) {
+		i = (i + 1) & mask;
+	}
+	index[i].hash = hash;
+	index[i].slot = slot;
+}
+
+/**
+ * Removes the index entry referring to `slot`.
+ *
+ * Uses backward shift deletion, so no tombstones are left behind
+ * and lookups never have to probe past removed keys.
+ */
+static void index_remove(IndexSlot* index, const size_t index_size, const size_t hash, const int slot) {
+	const size_t mask = index_size - 1;
+	size_t i = hash & mask;
+	while (index[i].slot != slot) {
+		assert(index[i].slot != -1);
+		i = (i + 1) & mask;
+	}
+	size_t j = i;
+	while (true) {
+		j = (j + 1) & mask;
+		if (index[j].slot == -1) {
+			break;
+		}
+		// Distance from each entry's home position, wrapping around the table.
+		const size_t home = index[j].hash & mask;
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			index[i] = index[j];
+			i = j;
+		}
+	}
+	index[i].slot = -1;
+}
+
+/**
+ * Finds the slot of `key` in the cache's index.
+ *
+ * @param[out] probes Incremented for every index entry looked at.
+ * @return The slot holding `key` or -1 if `key` isn't cached.
+ */
+static int index_find(LucuCache cache, const size_t hash, void* key, uint64_t* const probes) {
+	const size_t mask = cache->index_size - 1;
+	for (size_t i = hash & mask; cache->index[i].slot != -1; i = (i + 1) & mask) {
+		(*probes)++;
+		if (cache->index[i].hash != hash) {
+			continue;
+		}
+		const int slot = cache->index[i].slot;
+		if (cache->keys_equal_function(slot_get(cache, slot)->key, key, cache->keys_equal_function_params)) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+static int fifo_admit(LucuCache cache, const size_t hash) {
+	(void)cache;
+	(void)hash;
+	return QUEUE_MAIN;
+}
+
+static void fifo_hit(LucuCache cache, const int slot) {
+	(void)cache;
+	(void)slot;
+}
+
+static int fifo_victim(LucuCache cache) {
+	return queue_pop(cache, QUEUE_MAIN);
+}
+
+static void lru_hit(LucuCache cache, const int slot) {
+	if (slot != cache->queues[QUEUE_MAIN].last) {
+		queue_remove(cache, slot);
+		queue_append(cache, QUEUE_MAIN, slot);
+	}
+}
+
+static void clock_hit(LucuCache cache, const int slot) {
+	slot_get(cache, slot)->freq = 1;
+}
+
+/**
+ * Sweeps the clock hand, which is the front of `QUEUE_MAIN`.
+ *
+ * Slots with their reference bit set get it cleared and are passed
+ * over by moving them to the back, which is the same as advancing the hand.
+ */
+static int clock_victim(LucuCache cache) {
+	while (true) {
+		const int slot = queue_pop(cache, QUEUE_MAIN);
+		KeyValue* kv = slot_get(cache, slot);
+		if (kv->freq == 0) {
+			return slot;
+		}
+		kv->freq = 0;
+		queue_append(cache, QUEUE_MAIN, slot);
+	}
+}
+
+static void s3fifo_init(LucuCache cache) {
+	if (cache->index == NULL) {
+		return;
+	}
+	cache->ghost = lucu_allocate(&cache->allocator, sizeof(size_t) * (size_t)cache->cache_size);
+	cache->ghost_index = index_new(cache, cache->index_size);
+}
+
+static void s3fifo_destroy(LucuCache cache) {
+	lucu_deallocate(&cache->allocator, cache->ghost);
+	lucu_deallocate(&cache->allocator, cache->ghost_index);
+}
+
+static bool ghost_contains(LucuCache cache, const size_t hash) {
+	const size_t mask = cache->index_size - 1;
+	for (size_t i = hash & mask; cache->ghost_index[i].slot != -1; i = (i + 1) & mask) {
+		if (cache->ghost_index[i].hash == hash) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ghost_add(LucuCache cache, const size_t hash) {
+	if (cache->ghost_length == cache->cache_size) {
+		index_remove(cache->ghost_index, cache->index_size, cache->ghost[cache->ghost_head], cache->ghost_head);
+		cache->ghost_head = (cache->ghost_head + 1) % cache->cache_size;
+		cache->ghost_length--;
+	}
+	const int position = (cache->ghost_head + cache->ghost_length) % cache->cache_size;
+	cache->ghost[position] = hash;
+	index_insert(cache->ghost_index, cache->index_size, hash, position);
+	cache->ghost_length++;
+}
+
+/**
+ * New keys go to the small queue, unless they were evicted from it
+ * recently, in which case they have proven themselves and go to the main queue.
+ */
+static int s3fifo_admit(LucuCache cache, const size_t hash) {
+	if (cache->ghost != NULL && ghost_contains(cache, hash)) {
+		return QUEUE_MAIN;
+	}
+	return QUEUE_SMALL;
+}
+
+static void s3fifo_hit(LucuCache cache, const int slot) {
+	KeyValue* kv = slot_get(cache, slot);
+	if (kv->freq < FREQ_MAX) {
+		kv->freq++;
+	}
+}
+
+/**
+ * Evicts from the small queue while it is over 10% of the cache.
+ *
+ * Keys in the small queue that were hit are promoted to the main queue
+ * instead of evicted, and `evict` remembers keys that weren't in the ghost
+ * queue. The main queue is a CLOCK with a 2 bit counter instead of a bit.
+ */
+static int s3fifo_victim(LucuCache cache) {
+	const int small_size = cache->cache_size / 10 > 0 ? cache->cache_size / 10 : 1;
+	while (true) {
+		if (cache->queues[QUEUE_SMALL].length >= small_size || cache->queues[QUEUE_MAIN].length == 0) {
+			const int slot = queue_pop(cache, QUEUE_SMALL);
+			KeyValue* kv = slot_get(cache, slot);
+			if (kv->freq == 0) {
+				return slot;
+			}
+			kv->freq = 0;
+			queue_append(cache, QUEUE_MAIN, slot);
+		} else {
+			const int slot = queue_pop(cache, QUEUE_MAIN);
+			KeyValue* kv = slot_get(cache, slot);
+			if (kv->freq == 0) {
+				return slot;
+			}
+			kv->freq--;
+			queue_append(cache, QUEUE_MAIN, slot);
+		}
+	}
+}
+
+static void no_state(LucuCache cache) {
+	(void)cache;
+}
+
+static const CachePolicy policies[] = {
+	[LUCU_CACHE_FIFO] = { no_state, fifo_admit, fifo_hit, fifo_victim, no_state },
+	[LUCU_CACHE_LRU] = { no_state, fifo_admit, lru_hit, fifo_victim, no_state },
+	[LUCU_CACHE_CLOCK] = { no_state, fifo_admit, clock_hit, clock_victim, no_state },
+	[LUCU_CACHE_S3FIFO] = { s3fifo_init, s3fifo_admit, s3fifo_hit, s3fifo_victim, s3fifo_destroy },
 };
 
 LucuCache lucu_cache_new(const int cache_size, bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*)) {
-	LucuCache cache = malloc(sizeof(LucuCacheData));
-	cache->cache = lucu_vector_new_with_size(cache_size, sizeof(KeyValue), keyvalue_destroy);
+	return lucu_cache_new_with_policy(LUCU_CACHE_FIFO, cache_size, NULL, keys_equal_function, keys_equal_function_params, generate_function, key_free_function, value_free_function);
+}
+
+LucuCache lucu_cache_new_hashed(const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*)) {
+	return lucu_cache_new_with_policy(LUCU_CACHE_FIFO, cache_size, key_hash_function, keys_equal_function, keys_equal_function_params, generate_function, key_free_function, value_free_function);
+}
+
+LucuCache lucu_cache_new_with_policy(const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*)) {
+	return lucu_cache_new_with_allocator(policy, cache_size, key_hash_function, keys_equal_function, keys_equal_function_params, generate_function, key_free_function, value_free_function, NULL);
+}
+
+LucuCache lucu_cache_new_with_allocator(const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*), const LucuAllocator* allocator) {
+	assert(cache_size > 0);
+	assert(policy >= LUCU_CACHE_FIFO && policy <= LUCU_CACHE_S3FIFO);
+	LucuCache cache = lucu_allocate(allocator, sizeof(LucuCacheData));
+	cache->allocator = allocator != NULL ? *allocator : (LucuAllocator){ .allocate = NULL };
+	cache->cache = lucu_vector_new_with_allocator(cache_size, sizeof(KeyValue), keyvalue_destroy, allocator);
 	cache->cache_size = cache_size;
+	cache->policy = &policies[policy];
 	cache->generate_function = generate_function;
 	cache->keys_equal_function = keys_equal_function;
 	cache->keys_equal_function_params = keys_equal_function_params;
+	cache->key_hash_function = key_hash_function;
 	cache->key_free_function = key_free_function;
 	cache->value_free_function = value_free_function;
+	for (int i = 0; i < 2; i++) {
+		cache->queues[i] = (Queue){ .first = -1, .last = -1, .length = 0 };
+	}
+	cache->index = NULL;
+	cache->index_size = 0;
+	if (key_hash_function != NULL) {
+		// Keep the load factor at or below 0.5 so probe sequences stay short.
+		size_t index_size = 2;
+		while (index_size < 2 * (size_t)cache_size) {
+			index_size *= 2;
+		}
+		cache->index = index_new(cache, index_size);
+		cache->index_size = index_size;
+	}
+	cache->ghost = NULL;
+	cache->ghost_head = 0;
+	cache->ghost_length = 0;
+	cache->ghost_index = NULL;
+	cache->stats = NULL;
+	cache->stats_timing = false;
+	cache->policy->init(cache);
 	return cache;
 }
 
 void lucu_cache_destroy(LucuCache cache) {
+	cache->policy->destroy(cache);
 	lucu_vector_destroy(cache->cache);
-	free(cache);
+	lucu_deallocate(&cache->allocator, cache->index);
+	lucu_deallocate(&cache->allocator, cache->stats);
+	const LucuAllocator allocator = cache->allocator;
+	lucu_deallocate(&allocator, cache);
+}
+
+static int find_unhashed(LucuCache cache, void* key, uint64_t* const probes) {
+	// Slots are never removed from `cache`, so it never wraps and slots are
+	// positions in its first span.
+	LucuVectorSpan spans[2];
+	if (lucu_vector_spans(cache->cache, spans) == 0) {
+		return -1;
+	}
+	KeyValue* keyvalues = spans[0].data;
+	for (int slot = 0; slot < spans[0].length; slot++) {
+		if (cache->keys_equal_function(keyvalues[slot].key, key, cache->keys_equal_function_params)) {
+			*probes = (uint64_t)slot + 1;
+			return slot;
+		}
+	}
+	*probes = (uint64_t)spans[0].length;
+	return -1;
+}
+
+/**
+ * Counts a hit, or a miss if `slot` is -1, that looked at `probes` keys.
+ */
+static void count_find(LucuCache cache, const int slot, const uint64_t probes) {
+	LucuCacheStats* const stats = stats_of(cache);
+	if (stats != NULL) {
+		if (slot == -1) {
+			stats->misses++;
+		} else {
+			stats->hits++;
+		}
+		stats->probes += probes;
+		stats->max_probes = probes > stats->max_probes ? probes : stats->max_probes;
+	}
+}
+
+/**
+ * Finds the slot holding `key`, counting a hit or a miss.
+ *
+ * @param[out] hash Set to the hash of `key` if the cache is hashed.
+ * @return The slot holding `key` or -1 if `key` isn't cached.
+ */
+static int find(LucuCache cache, void* key, size_t* hash) {
+	uint64_t probes = 0;
+	int slot;
+	if (cache->index != NULL) {
+		*hash = cache->key_hash_function(key, cache->keys_equal_function_params);
+		slot = index_find(cache, *hash, key, &probes);
+	} else {
+		*hash = 0;
+		slot = find_unhashed(cache, key, &probes);
+	}
+	count_find(cache, slot, probes);
+	return slot;
+}
+
+/**
+ * Finds the slots holding `length` keys, counting hits and misses like `find`.
+ *
+ * A hashed cache hashes every key and prefetches where it will look in the
+ * index before looking, so the cache misses of different keys overlap.
+ * Otherwise the slots are scanned once, comparing each against every key
+ * that hasn't been found yet.
+ * @param[out] hashes Set to the hashes of `keys` if the cache is hashed.
+ * @param[out] slots Set to the slots holding `keys`, or -1 for keys that aren't cached.
+ * @param pending Scratch space for `length` indices.
+ */
+static void find_batch(LucuCache cache, void** keys, const int length, size_t* hashes, int* slots, int* pending) {
+	if (cache->index != NULL) {
+		for (int i = 0; i < length; i++) {
+			hashes[i] = cache->key_hash_function(keys[i], cache->keys_equal_function_params);
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(&cache->index[hashes[i] & (cache->index_size - 1)]);
+#endif
+		}
+		for (int i = 0; i < length; i++) {
+			uint64_t probes = 0;
+			slots[i] = index_find(cache, hashes[i], keys[i], &probes);
+			count_find(cache, slots[i], probes);
+		}
+		return;
+	}
+	int pending_length = length;
+	for (int i = 0; i < length; i++) {
+		hashes[i] = 0;
+		slots[i] = -1;
+		pending[i] = i;
+	}
+	// Slots are never removed from `cache`, see `find_unhashed`.
+	LucuVectorSpan spans[2];
+	const int stored = lucu_vector_spans(cache->cache, spans) == 0 ? 0 : spans[0].length;
+	for (int slot = 0; slot < stored && pending_length > 0; slot++) {
+		void* const stored_key = ((KeyValue*)spans[0].data)[slot].key;
+		for (int p = 0; p < pending_length;) {
+			const int i = pending[p];
+			if (cache->keys_equal_function(stored_key, keys[i], cache->keys_equal_function_params)) {
+				slots[i] = slot;
+				count_find(cache, slot, (uint64_t)slot + 1);
+				pending[p] = pending[--pending_length];
+			} else {
+				p++;
+			}
+		}
+	}
+	for (int p = 0; p < pending_length; p++) {
+		count_find(cache, -1, (uint64_t)stored);
+	}
 }
 
-static void evict(LucuCache cache) {
-	KeyValue* keyvalue = lucu_vector_dequeue(cache->cache);
+/**
+ * Evicts the next `KeyValue` according to the cache's policy.
+ *
+ * Pinned `KeyValue`s are passed over by putting them back at the end of
+ * their queue with a hit, so that policies with a second chance move on
+ * to other queues instead of picking them again straight away.
+ * @return The slot that was freed up.
+ */
+static int evict(LucuCache cache) {
+	int slot = cache->policy->victim(cache);
+	while (slot_get(cache, slot)->pinned) {
+		KeyValue* pinned = slot_get(cache, slot);
+		if (pinned->freq == 0) {
+			pinned->freq = 1;
+		}
+		queue_append(cache, pinned->queue, slot);
+		slot = cache->policy->victim(cache);
+	}
+	KeyValue* keyvalue = slot_get(cache, slot);
+	// Only once the victim is certain to leave, or a pinned key would be ghosted while still cached.
+	if (cache->ghost != NULL && keyvalue->queue == QUEUE_SMALL) {
+		ghost_add(cache, keyvalue->hash);
+	}
+	LucuCacheStats* const stats = stats_of(cache);
+	if (stats != NULL) {
+		stats->evictions++;
+	}
+	if (cache->index != NULL) {
+		index_remove(cache->index, cache->index_size, keyvalue->hash, slot);
+	}
 	keyvalue_destroy(keyvalue);
-	free(keyvalue);
+	return slot;
 }
 
-static void insert(LucuCache cache, KeyValue* keyvalue) {
+static int insert(LucuCache cache, void* key, void* value, const size_t hash) {
+	KeyValue keyvalue = {
+		.key = key,
+		.value = value,
+		.key_free_function = cache->key_free_function,
+		.value_free_function = cache->value_free_function,
+		.hash = hash,
+		.freq = 0,
+		.pinned = false
+	};
+	const int queue = cache->policy->admit(cache, hash);
+	int slot;
 	if (lucu_vector_length(cache->cache) == cache->cache_size) {
-		evict(cache);
+		slot = evict(cache);
+		*slot_get(cache, slot) = keyvalue;
+	} else {
+		slot = lucu_vector_length(cache->cache);
+		lucu_vector_push_back(cache->cache, &keyvalue);
+	}
+	queue_append(cache, queue, slot);
+	if (cache->index != NULL) {
+		index_insert(cache->index, cache->index_size, hash, slot);
 	}
-	lucu_vector_enqueue(cache->cache, keyvalue);
+	return slot;
 }
 
-static bool key_matches(void* keyvalue, void* key, void* params) {
-	KeyValue* kv = (KeyValue*)keyvalue;
-	void** pars = (void**)params;
-	bool (*keys_equal_function)(void*, void*, void*) = (bool(*)(void*, void*, void*))((LucuGenericFunction*)pars[0])->f;
-	void* p = pars[1];
-	return keys_equal_function(kv->key, key, p);
+bool lucu_cache_lookup(LucuCache cache, void* key, void** value) {
+	size_t hash;
+	const int slot = find(cache, key, &hash);
+	if (slot == -1) {
+		return false;
+	}
+	cache->policy->hit(cache, slot);
+	if (value != NULL) {
+		*value = slot_get(cache, slot)->value;
+	}
+	return true;
+}
+
+void lucu_cache_insert(LucuCache cache, void* key, void* value) {
+	const size_t hash = cache->index != NULL ? cache->key_hash_function(key, cache->keys_equal_function_params) : 0;
+#ifndef NDEBUG
+	uint64_t probes = 0;
+	assert(cache->index == NULL || index_find(cache, hash, key, &probes) == -1);
+#endif
+	insert(cache, key, value, hash);
 }
 
 void* lucu_cache_get(LucuCache cache, void* key) {
-	LucuGenericFunction ke = { (void(*)(void))cache->keys_equal_function };
-	void* params[] = {(void*)&ke, cache->keys_equal_function_params};
-	int i = lucu_vector_index(cache->cache, key, key_matches, params);
-	if (i == -1) {
+	LucuCacheStats* const stats = stats_of(cache);
+	const bool timing = stats != NULL && cache->stats_timing;
+	const uint64_t start = timing ? now_nanoseconds() : 0;
+	size_t hash;
+	int slot = find(cache, key, &hash);
+	if (slot == -1) {
+		const uint64_t generate_start = timing ? now_nanoseconds() : 0;
 		void* value = cache->generate_function(key);
-		KeyValue keyvalue = {
-			.key = key,
-			.value = value,
-			.key_free_function = cache->key_free_function,
-			.value_free_function = cache->value_free_function
-		};
-		insert(cache, &keyvalue);
-		i = lucu_vector_length(cache->cache) - 1;
-	}
-	KeyValue* keyvalue = lucu_vector_get(cache->cache, i);
-	return keyvalue->value;
+		if (stats != NULL) {
+			stats->generate_calls++;
+			if (timing) {
+				stats->generate_nanoseconds += now_nanoseconds() - generate_start;
+			}
+		}
+		slot = insert(cache, key, value, hash);
+	} else {
+		cache->policy->hit(cache, slot);
+	}
+	if (timing) {
+		stats->get_latency[latency_bucket(now_nanoseconds() - start)]++;
+	}
+	return slot_get(cache, slot)->value;
+}
+
+void lucu_cache_get_batch(LucuCache cache, void** keys, void** values, const int length, void (*generate_batch_function)(void**, void**, int, void*), void* params) {
+	assert(length >= 0 && length <= cache->cache_size);
+	if (length == 0) {
+		return;
+	}
+	const size_t n = (size_t)length;
+	const size_t scratch_size = n * BATCH_KEY_SIZE;
+	max_align_t stack[(BATCH_STACK_LENGTH * BATCH_KEY_SIZE + sizeof(max_align_t) - 1) / sizeof(max_align_t)];
+	void* const scratch = length <= BATCH_STACK_LENGTH ? (void*)stack : lucu_allocate(&cache->allocator, scratch_size);
+	size_t* const hashes = scratch;
+	size_t* const miss_hashes = hashes + n;
+	void** const miss_keys = (void**)(miss_hashes + n);
+	int* const slots = (int*)(miss_keys + n);
+	// Which miss each key that wasn't found is.
+	int* const miss_of = slots + n;
+	int* const miss_slots = miss_of + n;
+	find_batch(cache, keys, length, hashes, slots, miss_of);
+
+	int misses = 0;
+	for (int i = 0; i < length; i++) {
+		if (slots[i] != -1) {
+			cache->policy->hit(cache, slots[i]);
+			slot_get(cache, slots[i])->pinned = true;
+			continue;
+		}
+		// The same key can miss more than once, but is only generated once.
+		int m = 0;
+		while (m < misses && !(miss_hashes[m] == hashes[i] && cache->keys_equal_function(miss_keys[m], keys[i], cache->keys_equal_function_params))) {
+			m++;
+		}
+		if (m == misses) {
+			miss_keys[misses] = keys[i];
+			miss_hashes[misses] = hashes[i];
+			misses++;
+		}
+		miss_of[i] = m;
+	}
+
+	if (misses > 0) {
+		// Generated values go in `values` until every miss is inserted.
+		LucuCacheStats* const stats = stats_of(cache);
+		const bool timing = stats != NULL && cache->stats_timing;
+		const uint64_t generate_start = timing ? now_nanoseconds() : 0;
+		if (generate_batch_function != NULL) {
+			generate_batch_function(miss_keys, values, misses, params);
+		} else {
+			for (int m = 0; m < misses; m++) {
+				values[m] = cache->generate_function(miss_keys[m]);
+			}
+		}
+		if (stats != NULL) {
+			stats->generate_calls += (uint64_t)misses;
+			if (timing) {
+				stats->generate_nanoseconds += now_nanoseconds() - generate_start;
+			}
+		}
+		for (int m = 0; m < misses; m++) {
+			miss_slots[m] = insert(cache, miss_keys[m], values[m], miss_hashes[m]);
+			slot_get(cache, miss_slots[m])->pinned = true;
+		}
+	}
+
+	for (int i = 0; i < length; i++) {
+		KeyValue* const kv = slot_get(cache, slots[i] != -1 ? slots[i] : miss_slots[miss_of[i]]);
+		kv->pinned = false;
+		values[i] = kv->value;
+	}
+	if (scratch != stack) {
+		lucu_deallocate(&cache->allocator, scratch);
+	}
+}
+
+void lucu_cache_enable_stats(LucuCache cache, const bool timing) {
+	if (!LUCU_CACHE_STATS) {
+		return;
+	}
+	if (cache->stats == NULL) {
+		cache->stats = lucu_allocate(&cache->allocator, sizeof(LucuCacheStats));
+		memset(cache->stats, 0, sizeof(LucuCacheStats));
+	}
+	cache->stats_timing = timing;
+}
+
+void lucu_cache_disable_stats(LucuCache cache) {
+	lucu_deallocate(&cache->allocator, cache->stats);
+	cache->stats = NULL;
+	cache->stats_timing = false;
+}
+
+void lucu_cache_stats_snapshot(const LucuCache cache, LucuCacheStats* const stats) {
+	if (cache->stats != NULL) {
+		*stats = *cache->stats;
+	} else {
+		memset(stats, 0, sizeof(LucuCacheStats));
+	}
+}
+
+void lucu_cache_stats_reset(LucuCache cache) {
+	if (cache->stats != NULL) {
+		memset(cache->stats, 0, sizeof(LucuCacheStats));
+	}
+}
+
+void lucu_cache_stats_add(LucuCacheStats* const total, const LucuCacheStats* const stats) {
+	total->hits += stats->hits;
+	total->misses += stats->misses;
+	total->evictions += stats->evictions;
+	total->generate_calls += stats->generate_calls;
+	total->generate_nanoseconds += stats->generate_nanoseconds;
+	total->probes += stats->probes;
+	total->max_probes = stats->max_probes > total->max_probes ? stats->max_probes : total->max_probes;
+	for (int i = 0; i < LUCU_CACHE_LATENCY_BUCKETS; i++) {
+		total->get_latency[i] += stats->get_latency[i];
+	}
 }
@@ -0,0 +1,28 @@
+/// @file cache_stats.h
+/// Helpers shared by the `LucuCacheStats` of cache.c and concurrent_cache.c.
+#ifndef LUCU_SRC_CACHE_STATS_H
+#define LUCU_SRC_CACHE_STATS_H
+
+#include "lucu/cache.h"
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t now_nanoseconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Bucket of `LucuCacheStats::get_latency` counting `nanoseconds`.
+ */
+static inline int latency_bucket(uint64_t nanoseconds) {
+	int bucket = 0;
+	while (nanoseconds > 1 && bucket < LUCU_CACHE_LATENCY_BUCKETS - 1) {
+		nanoseconds >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+#endif
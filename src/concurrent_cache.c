@@ -0,0 +1,446 @@
+#include "lucu/concurrent_cache.h"
+#include "lucu/cache.h"
+#include "align.h"
+#include "cache_stats.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/// Values of `LucuConcurrentCacheData::stats_mode`.
+#define STATS_OFF 0
+#define STATS_COUNTING 1
+#define STATS_TIMING 2
+
+/**
+ * A key that some thread is currently generating a value for.
+ *
+ * A `LucuCacheFuture` is a pointer to one of these.
+ */
+struct LucuCacheFutureData {
+	LucuConcurrentCache cache;
+	void* key;
+	size_t hash;
+	/// The generated value, once `done` is `true`.
+	void* value;
+	/// Set with the shard's lock held, but can be read without it.
+	atomic_bool done;
+	/// Number of threads waiting for `value` plus the number of
+	/// `LucuCacheFuture`s that haven't been waited on or released.
+	int waiters;
+	/// Next key being generated for the same shard.
+	struct LucuCacheFutureData* next;
+	/// If the key is in the cache's job queue, waiting for a worker.
+	/// Protected by the cache's `jobs_lock`.
+	bool queued;
+	/// Next key in the cache's job queue.
+	struct LucuCacheFutureData* next_job;
+};
+
+typedef LucuCacheFutureData InFlight;
+
+typedef struct Shard {
+	/// On its own cache line, so that locking one shard doesn't slow down another.
+	alignas(LUCU_CACHE_LINE_SIZE) pthread_mutex_t lock;
+	/// Signalled whenever a value in `in_flight` is done.
+	pthread_cond_t done;
+	LucuCache cache;
+	/// Keys being generated for this shard.
+	InFlight* in_flight;
+	/// Counts of what happens outside of `cache`: generating values and
+	/// the time `lucu_concurrent_cache_get` takes. `cache` counts the rest.
+	LucuCacheStats stats;
+} Shard;
+
+struct LucuConcurrentCacheData {
+	Shard* shards;
+	int shard_count;
+	size_t (*key_hash_function)(void*, void*);
+	bool (*keys_equal_function)(void*, void*, void*);
+	void* keys_equal_function_params;
+	void* (*generate_function)(void*);
+	/// `STATS_OFF`, `STATS_COUNTING` or `STATS_TIMING`. Read without holding a lock.
+	atomic_int stats_mode;
+	/// Threads started by `lucu_concurrent_cache_start_workers`.
+	pthread_t* workers;
+	int worker_count;
+	/// Protects the job queue and `stopping`. Taken after a shard's lock, never before.
+	pthread_mutex_t jobs_lock;
+	/// Signalled when a job is queued or the workers should stop.
+	pthread_cond_t jobs_ready;
+	/// Keys from `lucu_concurrent_cache_get_async` waiting for a worker, oldest first.
+	InFlight* jobs_first;
+	InFlight* jobs_last;
+	/// Set by `lucu_concurrent_cache_destroy` to stop the workers once the queue is empty.
+	bool stopping;
+};
+
+LucuConcurrentCache lucu_concurrent_cache_new(const int shard_count, const LucuCachePolicy policy, const int cache_size, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* keys_equal_function_params, void* (*generate_function)(void*), void (*key_free_function)(void*), void (*value_free_function)(void*)) {
+	assert(shard_count > 0);
+	assert(cache_size >= shard_count);
+	assert(key_hash_function != NULL);
+	LucuConcurrentCache cache = malloc(sizeof(LucuConcurrentCacheData));
+	cache->shards = aligned_alloc(alignof(Shard), sizeof(Shard) * (size_t)shard_count);
+	cache->shard_count = shard_count;
+	cache->key_hash_function = key_hash_function;
+	cache->keys_equal_function = keys_equal_function;
+	cache->keys_equal_function_params = keys_equal_function_params;
+	cache->generate_function = generate_function;
+	atomic_init(&cache->stats_mode, STATS_OFF);
+	cache->workers = NULL;
+	cache->worker_count = 0;
+	pthread_mutex_init(&cache->jobs_lock, NULL);
+	pthread_cond_init(&cache->jobs_ready, NULL);
+	cache->jobs_first = NULL;
+	cache->jobs_last = NULL;
+	cache->stopping = false;
+	const int shard_size = (cache_size + shard_count - 1) / shard_count;
+	for (int i = 0; i < shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		pthread_cond_init(&shard->done, NULL);
+		// Values are generated by `lucu_concurrent_cache_get`, outside of the shard's lock.
+		shard->cache = lucu_cache_new_with_policy(policy, shard_size, key_hash_function, keys_equal_function, keys_equal_function_params, NULL, key_free_function, value_free_function);
+		shard->in_flight = NULL;
+		memset(&shard->stats, 0, sizeof(LucuCacheStats));
+	}
+	return cache;
+}
+
+void lucu_concurrent_cache_destroy(LucuConcurrentCache cache) {
+	pthread_mutex_lock(&cache->jobs_lock);
+	cache->stopping = true;
+	pthread_cond_broadcast(&cache->jobs_ready);
+	pthread_mutex_unlock(&cache->jobs_lock);
+	for (int i = 0; i < cache->worker_count; i++) {
+		pthread_join(cache->workers[i], NULL);
+	}
+	free(cache->workers);
+	pthread_cond_destroy(&cache->jobs_ready);
+	pthread_mutex_destroy(&cache->jobs_lock);
+	for (int i = 0; i < cache->shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		assert(shard->in_flight == NULL);
+		lucu_cache_destroy(shard->cache);
+		pthread_cond_destroy(&shard->done);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	free(cache->shards);
+	free(cache);
+}
+
+/**
+ * Picks the shard for a hash.
+ *
+ * The shards' own indexes use the low bits of the hash, so the
+ * hash is mixed first to keep shard choice independent of them.
+ */
+static Shard* shard_for(LucuConcurrentCache cache, const size_t hash) {
+	const uint64_t mixed = (uint64_t)hash * 0x9E3779B97F4A7C15ull;
+	return &cache->shards[(mixed >> 32) % (uint64_t)cache->shard_count];
+}
+
+static InFlight* in_flight_find(LucuConcurrentCache cache, Shard* shard, const size_t hash, void* key) {
+	for (InFlight* f = shard->in_flight; f != NULL; f = f->next) {
+		if (f->hash == hash && cache->keys_equal_function(f->key, key, cache->keys_equal_function_params)) {
+			return f;
+		}
+	}
+	return NULL;
+}
+
+static void in_flight_remove(Shard* shard, InFlight* in_flight) {
+	InFlight** f = &shard->in_flight;
+	while (*f != in_flight) {
+		f = &(*f)->next;
+	}
+	*f = in_flight->next;
+}
+
+/**
+ * Counts how long a `lucu_concurrent_cache_get` that started at `start` took.
+ *
+ * Called with the shard's lock held.
+ */
+static void record_latency(Shard* shard, const int stats_mode, const uint64_t start) {
+	if (LUCU_CACHE_STATS && stats_mode == STATS_TIMING) {
+		shard->stats.get_latency[latency_bucket(now_nanoseconds() - start)]++;
+	}
+}
+
+static int stats_mode_of(LucuConcurrentCache cache) {
+	return LUCU_CACHE_STATS ? atomic_load_explicit(&cache->stats_mode, memory_order_relaxed) : STATS_OFF;
+}
+
+/**
+ * Starts generating a key, so that other threads wait for it instead of generating it too.
+ *
+ * Called with the shard's lock held.
+ */
+static InFlight* in_flight_add(LucuConcurrentCache cache, Shard* shard, const size_t hash, void* key) {
+	InFlight* in_flight = malloc(sizeof(InFlight));
+	*in_flight = (InFlight){ .cache = cache, .key = key, .hash = hash, .value = NULL, .waiters = 0, .next = shard->in_flight, .queued = false, .next_job = NULL };
+	atomic_init(&in_flight->done, false);
+	shard->in_flight = in_flight;
+	return in_flight;
+}
+
+/**
+ * Generates the value of a key added with `in_flight_add`, stores it and
+ * wakes up any threads waiting for it.
+ *
+ * Called without holding any lock. `in_flight` is freed if nothing is waiting for it.
+ * @param start When the `lucu_concurrent_cache_get` being timed started, or 0 if
+ * there isn't one.
+ * @return The generated value.
+ */
+static void* in_flight_generate(LucuConcurrentCache cache, InFlight* in_flight, const int stats_mode, const uint64_t start) {
+	Shard* shard = shard_for(cache, in_flight->hash);
+	void* const key = in_flight->key;
+	const uint64_t generate_start = stats_mode == STATS_TIMING ? now_nanoseconds() : 0;
+	void* value = cache->generate_function(key);
+	const uint64_t generate_end = stats_mode == STATS_TIMING ? now_nanoseconds() : 0;
+
+	pthread_mutex_lock(&shard->lock);
+	if (stats_mode != STATS_OFF) {
+		shard->stats.generate_calls++;
+		shard->stats.generate_nanoseconds += generate_end - generate_start;
+	}
+	lucu_cache_insert(shard->cache, key, value);
+	in_flight_remove(shard, in_flight);
+	in_flight->value = value;
+	atomic_store_explicit(&in_flight->done, true, memory_order_release);
+	if (in_flight->waiters == 0) {
+		free(in_flight);
+	} else {
+		pthread_cond_broadcast(&shard->done);
+	}
+	if (start != 0) {
+		record_latency(shard, stats_mode, start);
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return value;
+}
+
+/**
+ * Takes a key out of the job queue, so the calling thread can generate it
+ * instead of waiting for a worker to get to it.
+ *
+ * Called with the key's shard's lock held.
+ * @return `true` if the key was still queued and now has to be generated
+ * by the caller.
+ */
+static bool job_take(LucuConcurrentCache cache, InFlight* in_flight) {
+	pthread_mutex_lock(&cache->jobs_lock);
+	const bool queued = in_flight->queued;
+	if (queued) {
+		InFlight* previous = NULL;
+		InFlight** job = &cache->jobs_first;
+		while (*job != in_flight) {
+			previous = *job;
+			job = &(*job)->next_job;
+		}
+		*job = in_flight->next_job;
+		if (cache->jobs_last == in_flight) {
+			cache->jobs_last = previous;
+		}
+		in_flight->queued = false;
+	}
+	pthread_mutex_unlock(&cache->jobs_lock);
+	return queued;
+}
+
+/**
+ * Waits for the value of a key that is being generated.
+ *
+ * Called with the shard's lock held, which is held again when it returns.
+ * The caller **must** already be counted in `waiters`. If no worker has
+ * started on the key yet, the calling thread generates it itself, which
+ * also keeps a `generate_function` that waits on other keys from
+ * deadlocking the workers.
+ */
+static void* in_flight_wait(LucuConcurrentCache cache, Shard* shard, InFlight* in_flight) {
+	if (job_take(cache, in_flight)) {
+		pthread_mutex_unlock(&shard->lock);
+		in_flight_generate(cache, in_flight, stats_mode_of(cache), 0);
+		pthread_mutex_lock(&shard->lock);
+	}
+	while (!atomic_load_explicit(&in_flight->done, memory_order_relaxed)) {
+		pthread_cond_wait(&shard->done, &shard->lock);
+	}
+	void* const value = in_flight->value;
+	in_flight->waiters--;
+	if (in_flight->waiters == 0) {
+		free(in_flight);
+	}
+	return value;
+}
+
+void* lucu_concurrent_cache_get(LucuConcurrentCache cache, void* key) {
+	const int stats_mode = stats_mode_of(cache);
+	const uint64_t start = stats_mode == STATS_TIMING ? now_nanoseconds() : 0;
+	const size_t hash = cache->key_hash_function(key, cache->keys_equal_function_params);
+	Shard* shard = shard_for(cache, hash);
+	void* value;
+
+	pthread_mutex_lock(&shard->lock);
+	if (lucu_cache_lookup(shard->cache, key, &value)) {
+		record_latency(shard, stats_mode, start);
+		pthread_mutex_unlock(&shard->lock);
+		return value;
+	}
+
+	InFlight* in_flight = in_flight_find(cache, shard, hash, key);
+	if (in_flight != NULL) {
+		in_flight->waiters++;
+		value = in_flight_wait(cache, shard, in_flight);
+		record_latency(shard, stats_mode, start);
+		pthread_mutex_unlock(&shard->lock);
+		return value;
+	}
+
+	in_flight = in_flight_add(cache, shard, hash, key);
+	pthread_mutex_unlock(&shard->lock);
+	return in_flight_generate(cache, in_flight, stats_mode, start);
+}
+
+static void* worker_main(void* c) {
+	LucuConcurrentCache cache = c;
+	pthread_mutex_lock(&cache->jobs_lock);
+	while (true) {
+		while (cache->jobs_first == NULL && !cache->stopping) {
+			pthread_cond_wait(&cache->jobs_ready, &cache->jobs_lock);
+		}
+		InFlight* job = cache->jobs_first;
+		if (job == NULL) {
+			break;
+		}
+		cache->jobs_first = job->next_job;
+		if (cache->jobs_first == NULL) {
+			cache->jobs_last = NULL;
+		}
+		job->queued = false;
+		pthread_mutex_unlock(&cache->jobs_lock);
+		in_flight_generate(cache, job, stats_mode_of(cache), 0);
+		pthread_mutex_lock(&cache->jobs_lock);
+	}
+	pthread_mutex_unlock(&cache->jobs_lock);
+	return NULL;
+}
+
+void lucu_concurrent_cache_start_workers(LucuConcurrentCache cache, const int worker_count) {
+	assert(cache->worker_count == 0);
+	assert(worker_count > 0);
+	cache->workers = malloc(sizeof(pthread_t) * (size_t)worker_count);
+	for (int i = 0; i < worker_count; i++) {
+		pthread_create(&cache->workers[i], NULL, worker_main, cache);
+	}
+	cache->worker_count = worker_count;
+}
+
+bool lucu_concurrent_cache_get_async(LucuConcurrentCache cache, void* key, void** value, LucuCacheFuture* future) {
+	const size_t hash = cache->key_hash_function(key, cache->keys_equal_function_params);
+	Shard* shard = shard_for(cache, hash);
+
+	pthread_mutex_lock(&shard->lock);
+	if (lucu_cache_lookup(shard->cache, key, value)) {
+		pthread_mutex_unlock(&shard->lock);
+		return true;
+	}
+
+	InFlight* in_flight = in_flight_find(cache, shard, hash, key);
+	if (in_flight == NULL) {
+		in_flight = in_flight_add(cache, shard, hash, key);
+		if (cache->worker_count == 0) {
+			pthread_mutex_unlock(&shard->lock);
+			*value = in_flight_generate(cache, in_flight, stats_mode_of(cache), 0);
+			return true;
+		}
+		pthread_mutex_lock(&cache->jobs_lock);
+		in_flight->queued = true;
+		if (cache->jobs_last == NULL) {
+			cache->jobs_first = in_flight;
+		} else {
+			cache->jobs_last->next_job = in_flight;
+		}
+		cache->jobs_last = in_flight;
+		pthread_cond_signal(&cache->jobs_ready);
+		pthread_mutex_unlock(&cache->jobs_lock);
+	}
+	in_flight->waiters++;
+	*future = in_flight;
+	pthread_mutex_unlock(&shard->lock);
+	return false;
+}
+
+bool lucu_cache_future_is_done(const LucuCacheFuture future) {
+	return atomic_load_explicit(&future->done, memory_order_acquire);
+}
+
+void* lucu_cache_future_wait(LucuCacheFuture future) {
+	LucuConcurrentCache cache = future->cache;
+	Shard* shard = shard_for(cache, future->hash);
+	pthread_mutex_lock(&shard->lock);
+	void* const value = in_flight_wait(cache, shard, future);
+	pthread_mutex_unlock(&shard->lock);
+	return value;
+}
+
+void lucu_cache_future_release(LucuCacheFuture future) {
+	Shard* shard = shard_for(future->cache, future->hash);
+	pthread_mutex_lock(&shard->lock);
+	future->waiters--;
+	if (future->waiters == 0 && atomic_load_explicit(&future->done, memory_order_relaxed)) {
+		free(future);
+	}
+	pthread_mutex_unlock(&shard->lock);
+}
+
+void lucu_concurrent_cache_enable_stats(LucuConcurrentCache cache, const bool timing) {
+	if (!LUCU_CACHE_STATS) {
+		return;
+	}
+	for (int i = 0; i < cache->shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		lucu_cache_enable_stats(shard->cache, false);
+		pthread_mutex_unlock(&shard->lock);
+	}
+	atomic_store_explicit(&cache->stats_mode, timing ? STATS_TIMING : STATS_COUNTING, memory_order_relaxed);
+}
+
+void lucu_concurrent_cache_disable_stats(LucuConcurrentCache cache) {
+	atomic_store_explicit(&cache->stats_mode, STATS_OFF, memory_order_relaxed);
+	for (int i = 0; i < cache->shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		lucu_cache_disable_stats(shard->cache);
+		memset(&shard->stats, 0, sizeof(LucuCacheStats));
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+void lucu_concurrent_cache_stats_snapshot(LucuConcurrentCache cache, LucuCacheStats* const stats) {
+	memset(stats, 0, sizeof(LucuCacheStats));
+	for (int i = 0; i < cache->shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		LucuCacheStats shard_stats;
+		pthread_mutex_lock(&shard->lock);
+		lucu_cache_stats_snapshot(shard->cache, &shard_stats);
+		lucu_cache_stats_add(&shard_stats, &shard->stats);
+		pthread_mutex_unlock(&shard->lock);
+		lucu_cache_stats_add(stats, &shard_stats);
+	}
+}
+
+void lucu_concurrent_cache_stats_reset(LucuConcurrentCache cache) {
+	for (int i = 0; i < cache->shard_count; i++) {
+		Shard* shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		lucu_cache_stats_reset(shard->cache);
+		memset(&shard->stats, 0, sizeof(LucuCacheStats));
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
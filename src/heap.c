@@ -0,0 +1,203 @@
+#include "lucu/heap.h"
+#include "align.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct LucuHeapData {
+	/// Holds the elements, kept contiguous. Has no free function of its own,
+	/// so that elements can be moved out of it without being freed.
+	LucuVector vector;
+	/// The first element of `vector`.
+	void* v;
+	size_t bytewidth;
+	void (*free_function)(void*);
+	bool (*compare_function)(void*, void*, void*);
+	void* params;
+	void (*index_function)(void*, int, void*);
+	/// Room for the element being moved. Follows the heap in the same allocation.
+	void* tmp;
+	LucuAllocator allocator;
+};
+
+static LucuHeap heap_new(LucuVector vector, const size_t bytewidth, void (* const free_function)(void*), bool (* const compare_function)(void*, void*, void*), void* const params, const LucuAllocator* const allocator) {
+	assert(compare_function != NULL);
+	const size_t offset = align_up(sizeof(LucuHeapData));
+	LucuHeap heap = lucu_allocate(allocator, offset + bytewidth);
+	heap->vector = vector;
+	heap->v = lucu_vector_make_contiguous(vector);
+	heap->bytewidth = bytewidth;
+	heap->free_function = free_function;
+	heap->compare_function = compare_function;
+	heap->params = params;
+	heap->index_function = NULL;
+	heap->tmp = (void*)((uintptr_t)heap + offset);
+	heap->allocator = allocator != NULL ? *allocator : (LucuAllocator){ .allocate = NULL };
+	return heap;
+}
+
+LucuHeap lucu_heap_new(const size_t bytewidth, void (* const free_function)(void*), bool (* const compare_function)(void*, void*, void*), void* const params) {
+	return lucu_heap_new_with_allocator(bytewidth, free_function, compare_function, params, NULL);
+}
+
+LucuHeap lucu_heap_new_with_allocator(const size_t bytewidth, void (* const free_function)(void*), bool (* const compare_function)(void*, void*, void*), void* const params, const LucuAllocator* const allocator) {
+	LucuVector vector = lucu_vector_new_with_allocator(0, bytewidth, NULL, allocator);
+	return heap_new(vector, bytewidth, free_function, compare_function, params, allocator);
+}
+
+static inline void* heap_at(const LucuHeap heap, const int index) {
+	return (void*)((uintptr_t)heap->v + (size_t)index * heap->bytewidth);
+}
+
+/**
+ * Copies `element` to `index` and reports its new index.
+ */
+static inline void heap_place(LucuHeap heap, const int index, const void* const element) {
+	void* const slot = heap_at(heap, index);
+	memcpy(slot, element, heap->bytewidth);
+	if (heap->index_function != NULL) {
+		heap->index_function(slot, index, heap->params);
+	}
+}
+
+/**
+ * Moves `element` from the empty slot `index` towards the front,
+ * shifting parents down into the hole it leaves behind.
+ */
+static void sift_up(LucuHeap heap, int index, const void* const element) {
+	while (index > 0) {
+		const int parent = (index - 1) / 2;
+		if (!heap->compare_function((void*)element, heap_at(heap, parent), heap->params)) {
+			break;
+		}
+		heap_place(heap, index, heap_at(heap, parent));
+		index = parent;
+	}
+	heap_place(heap, index, element);
+}
+
+/**
+ * Moves `element` from the empty slot `index` towards the back,
+ * shifting children up into the hole it leaves behind.
+ */
+static void sift_down(LucuHeap heap, int index, const void* const element, const int length) {
+	for (int child = 2 * index + 1; child < length; child = 2 * index + 1) {
+		if (child + 1 < length && heap->compare_function(heap_at(heap, child + 1), heap_at(heap, child), heap->params)) {
+			child++;
+		}
+		if (!heap->compare_function(heap_at(heap, child), (void*)element, heap->params)) {
+			break;
+		}
+		heap_place(heap, index, heap_at(heap, child));
+		index = child;
+	}
+	heap_place(heap, index, element);
+}
+
+LucuHeap lucu_heap_from_vector(LucuVector vector, bool (* const compare_function)(void*, void*, void*), void* const params) {
+	// The heap frees elements itself, see `LucuHeapData`.
+	void (* const free_function)(void*) = vector->free_function;
+	vector->free_function = NULL;
+	LucuHeap heap = heap_new(vector, vector->bytewidth, free_function, compare_function, params, &vector->allocator);
+	const int length = lucu_vector_length(vector);
+	for (int i = length / 2 - 1; i >= 0; i--) {
+		memcpy(heap->tmp, heap_at(heap, i), heap->bytewidth);
+		sift_down(heap, i, heap->tmp, length);
+	}
+	return heap;
+}
+
+void lucu_heap_destroy(LucuHeap heap) {
+	if (heap->free_function != NULL) {
+		const int length = lucu_vector_length(heap->vector);
+		for (int i = 0; i < length; i++) {
+			heap->free_function(heap_at(heap, i));
+		}
+	}
+	lucu_vector_destroy(heap->vector);
+	const LucuAllocator allocator = heap->allocator;
+	lucu_deallocate(&allocator, heap);
+}
+
+void lucu_heap_set_index_function(LucuHeap heap, void (* const index_function)(void*, int, void*)) {
+	heap->index_function = index_function;
+	if (index_function == NULL) {
+		return;
+	}
+	const int length = lucu_vector_length(heap->vector);
+	for (int i = 0; i < length; i++) {
+		index_function(heap_at(heap, i), i, heap->params);
+	}
+}
+
+int lucu_heap_length(const LucuHeap heap) {
+	return lucu_vector_length(heap->vector);
+}
+
+bool lucu_heap_is_empty(const LucuHeap heap) {
+	return lucu_vector_is_empty(heap->vector);
+}
+
+void lucu_heap_push(LucuHeap heap, const void* const data) {
+	const int length = lucu_vector_length(heap->vector);
+	lucu_vector_push_back(heap->vector, data);
+	// Growing the vector can move or wrap its elements.
+	heap->v = lucu_vector_make_contiguous(heap->vector);
+	sift_up(heap, length, data);
+}
+
+void* lucu_heap_peek(const LucuHeap heap) {
+	return lucu_vector_is_empty(heap->vector) ? NULL : heap->v;
+}
+
+bool lucu_heap_pop_into(LucuHeap heap, void* const out) {
+	if (lucu_vector_is_empty(heap->vector)) {
+		return false;
+	}
+	if (out != NULL) {
+		memcpy(out, heap->v, heap->bytewidth);
+	} else if (heap->free_function != NULL) {
+		heap->free_function(heap->v);
+	}
+	const int length = lucu_vector_length(heap->vector) - 1;
+	if (length > 0) {
+		// The last element almost always belongs near the bottom, so walk the
+		// hole down to a leaf without comparing against it, then sift it up
+		// from there. That takes about half the comparisons of `sift_down`.
+		memcpy(heap->tmp, heap_at(heap, length), heap->bytewidth);
+		int index = 0;
+		for (int child = 1; child < length; child = 2 * index + 1) {
+			if (child + 1 < length && heap->compare_function(heap_at(heap, child + 1), heap_at(heap, child), heap->params)) {
+				child++;
+			}
+			heap_place(heap, index, heap_at(heap, child));
+			index = child;
+		}
+		sift_up(heap, index, heap->tmp);
+	}
+	lucu_vector_pop_back_into(heap->vector, NULL);
+	return true;
+}
+
+void* lucu_heap_get(const LucuHeap heap, const int index) {
+	assert(index >= 0 && index < lucu_vector_length(heap->vector));
+	return heap_at(heap, index);
+}
+
+void lucu_heap_decrease_key(LucuHeap heap, const int index) {
+	assert(index >= 0 && index < lucu_vector_length(heap->vector));
+	memcpy(heap->tmp, heap_at(heap, index), heap->bytewidth);
+	sift_up(heap, index, heap->tmp);
+}
+
+void lucu_heap_update(LucuHeap heap, const int index) {
+	assert(index >= 0 && index < lucu_vector_length(heap->vector));
+	memcpy(heap->tmp, heap_at(heap, index), heap->bytewidth);
+	if (index > 0 && heap->compare_function(heap->tmp, heap_at(heap, (index - 1) / 2), heap->params)) {
+		sift_up(heap, index, heap->tmp);
+	} else {
+		sift_down(heap, index, heap->tmp, lucu_vector_length(heap->vector));
+	}
+}
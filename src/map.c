@@ -0,0 +1,443 @@
+#include "lucu/map.h"
+#include "align.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Control byte of a slot that has never held an entry. Ends a probe sequence.
+#define CTRL_EMPTY ((unsigned char)0x80)
+/// Control byte of a slot whose entry was removed. Probe sequences continue past it.
+#define CTRL_DELETED ((unsigned char)0xFE)
+
+#ifdef __SSE2__
+/// Number of control bytes compared at once.
+#define GROUP_WIDTH 16
+#else
+#define GROUP_WIDTH 8
+#endif
+
+/**
+ * Smallest number of slots a `LucuMap` allocates.
+ *
+ * **Must** be a power of two of at least `GROUP_WIDTH`.
+ */
+#define LUCU_MAP_MIN_SLOTS 16
+
+/**
+ * Slots are probed a group at a time. Each slot has a control byte holding
+ * 7 bits of the hash of its entry, or `CTRL_EMPTY` or `CTRL_DELETED`,
+ * which have the high bit set.
+ */
+struct LucuMapData {
+	/// `slots + GROUP_WIDTH` control bytes. The last `GROUP_WIDTH` mirror the
+	/// first ones, so a group can be loaded from any slot without wrapping.
+	unsigned char* ctrl;
+	/// Entries, each a key followed by a value.
+	void* entries;
+	/// Number of slots. Always a power of two, or 0 before anything is inserted.
+	int slots;
+	int length;
+	/// Number of entries that can be inserted into empty slots before growing.
+	int growth_left;
+	size_t key_bytewidth;
+	size_t value_bytewidth;
+	/// Offset of the value from the start of an entry.
+	size_t value_offset;
+	/// Size of an entry, a multiple of the alignment of both key and value.
+	size_t entry_size;
+	size_t (*key_hash_function)(void*, void*);
+	bool (*keys_equal_function)(void*, void*, void*);
+	void* params;
+	void (*key_free_function)(void*);
+	void (*value_free_function)(void*);
+	LucuAllocator allocator;
+};
+
+/**
+ * Most alignment an object of `size` bytes can need.
+ *
+ * An object's alignment always divides its size.
+ */
+static size_t alignment_for(const size_t size) {
+	size_t align = 1;
+	while (align < alignof(max_align_t) && size % (align * 2) == 0) {
+		align *= 2;
+	}
+	return align;
+}
+
+/**
+ * Spreads the bits of a user provided hash, since hashes like the
+ * identity of an integer would otherwise cluster.
+ */
+static uint64_t mix(const size_t hash) {
+	uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ull;
+	return h ^ (h >> 32);
+}
+
+static unsigned char h2(const uint64_t hash) {
+	return (unsigned char)(hash & 0x7F);
+}
+
+static size_t h1(const uint64_t hash) {
+	return (size_t)(hash >> 7);
+}
+
+/**
+ * Index of the lowest set bit of a non-zero mask.
+ */
+static int lowest_bit(const uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(mask);
+#else
+	int i = 0;
+	while (!(mask & (1u << i))) {
+		i++;
+	}
+	return i;
+#endif
+}
+
+// Each group function returns a mask with bit `i` set if control byte `i` matches.
+#ifdef __SSE2__
+typedef __m128i Group;
+
+static Group group_load(const unsigned char* ctrl) {
+	return _mm_loadu_si128((const __m128i*)(const void*)ctrl);
+}
+
+static uint32_t group_match(const Group group, const unsigned char h) {
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h)));
+}
+
+static uint32_t group_match_empty(const Group group) {
+	return group_match(group, CTRL_EMPTY);
+}
+
+static uint32_t group_match_empty_or_deleted(const Group group) {
+	return (uint32_t)_mm_movemask_epi8(group);
+}
+#else
+typedef uint64_t Group;
+
+#define LSBS 0x0101010101010101ull
+#define MSBS 0x8080808080808080ull
+
+static Group group_load(const unsigned char* ctrl) {
+	Group group = 0;
+	for (int i = 0; i < GROUP_WIDTH; i++) {
+		group |= (Group)ctrl[i] << (8 * i);
+	}
+	return group;
+}
+
+/**
+ * Gathers the high bit of each byte of `bytes` into the low 8 bits.
+ */
+static uint32_t group_mask(const uint64_t bytes) {
+	return (uint32_t)((((bytes & MSBS) >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+static uint32_t group_match(const Group group, const unsigned char h) {
+	// Can report a byte after a true match as matching too. That byte always
+	// belongs to a full slot, and every match is checked by comparing keys.
+	const uint64_t x = group ^ (LSBS * h);
+	return group_mask((x - LSBS) & ~x);
+}
+
+static uint32_t group_match_empty(const Group group) {
+	// Only `CTRL_EMPTY` has the high bit set and bit 1 clear.
+	return group_mask(group & ~(group << 6));
+}
+
+static uint32_t group_match_empty_or_deleted(const Group group) {
+	return group_mask(group);
+}
+#endif
+
+static void* entry_key(const LucuMap map, const size_t slot) {
+	return (void*)((uintptr_t)map->entries + slot * map->entry_size);
+}
+
+static void* entry_value(const LucuMap map, const size_t slot) {
+	return (void*)((uintptr_t)map->entries + slot * map->entry_size + map->value_offset);
+}
+
+static bool is_full(const unsigned char ctrl) {
+	return ctrl < 0x80;
+}
+
+static void set_ctrl(LucuMap map, const size_t slot, const unsigned char ctrl) {
+	map->ctrl[slot] = ctrl;
+	if (slot < GROUP_WIDTH) {
+		map->ctrl[(size_t)map->slots + slot] = ctrl;
+	}
+}
+
+/**
+ * Most entries `slots` slots hold before the map grows.
+ *
+ * Keeps the load factor at or below 7/8.
+ */
+static int max_load(const int slots) {
+	return slots - slots / 8;
+}
+
+/**
+ * Finds the slot holding `key`, or returns -1 if there isn't one.
+ */
+static ptrdiff_t find(const LucuMap map, const void* key, const uint64_t hash) {
+	if (map->slots == 0) {
+		return -1;
+	}
+	const size_t mask = (size_t)map->slots - 1;
+	size_t position = h1(hash) & mask;
+	size_t step = 0;
+	while (true) {
+		const Group group = group_load(&map->ctrl[position]);
+		for (uint32_t m = group_match(group, h2(hash)); m != 0; m &= m - 1) {
+			const size_t slot = (position + (size_t)lowest_bit(m)) & mask;
+			if (map->keys_equal_function(entry_key(map, slot), (void*)key, map->params)) {
+				return (ptrdiff_t)slot;
+			}
+		}
+		if (group_match_empty(group) != 0) {
+			return -1;
+		}
+		// Triangular probing visits every group when the number of slots is a power of two.
+		step += GROUP_WIDTH;
+		position = (position + step) & mask;
+	}
+}
+
+/**
+ * Finds the first empty or deleted slot on the probe sequence of `hash`.
+ */
+static size_t find_free(const LucuMap map, const uint64_t hash) {
+	const size_t mask = (size_t)map->slots - 1;
+	size_t position = h1(hash) & mask;
+	size_t step = 0;
+	while (true) {
+		const uint32_t m = group_match_empty_or_deleted(group_load(&map->ctrl[position]));
+		if (m != 0) {
+			return (position + (size_t)lowest_bit(m)) & mask;
+		}
+		step += GROUP_WIDTH;
+		position = (position + step) & mask;
+	}
+}
+
+/**
+ * Moves every entry into a new table of `slots` slots, dropping deleted slots.
+ */
+static void resize(LucuMap map, const int slots) {
+	assert(max_load(slots) >= map->length);
+	unsigned char* const old_ctrl = map->ctrl;
+	void* const old_entries = map->entries;
+	const int old_slots = map->slots;
+
+	// Entries come first, since they need the stricter alignment.
+	const size_t entries_size = map->entry_size * (size_t)slots;
+	map->entries = lucu_allocate(&map->allocator, entries_size + (size_t)slots + GROUP_WIDTH);
+	map->ctrl = (unsigned char*)map->entries + entries_size;
+	memset(map->ctrl, CTRL_EMPTY, (size_t)slots + GROUP_WIDTH);
+	map->slots = slots;
+	map->growth_left = max_load(slots) - map->length;
+
+	for (int i = 0; i < old_slots; i++) {
+		if (!is_full(old_ctrl[i])) {
+			continue;
+		}
+		const void* const entry = (void*)((uintptr_t)old_entries + (size_t)i * map->entry_size);
+		const uint64_t hash = mix(map->key_hash_function((void*)entry, map->params));
+		const size_t slot = find_free(map, hash);
+		set_ctrl(map, slot, h2(hash));
+		memcpy(entry_key(map, slot), entry, map->entry_size);
+	}
+	lucu_deallocate(&map->allocator, old_entries);
+}
+
+/**
+ * Smallest number of slots that holds `length` entries.
+ */
+static int slots_for(const int length) {
+	int slots = LUCU_MAP_MIN_SLOTS;
+	while (max_load(slots) < length) {
+		slots *= 2;
+	}
+	return slots;
+}
+
+LucuMap lucu_map_new(const size_t key_bytewidth, const size_t value_bytewidth, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* params, void (*key_free_function)(void*), void (*value_free_function)(void*)) {
+	return lucu_map_new_with_allocator(key_bytewidth, value_bytewidth, key_hash_function, keys_equal_function, params, key_free_function, value_free_function, NULL);
+}
+
+LucuMap lucu_map_new_with_allocator(const size_t key_bytewidth, const size_t value_bytewidth, size_t (*key_hash_function)(void*, void*), bool (*keys_equal_function)(void*, void*, void*), void* params, void (*key_free_function)(void*), void (*value_free_function)(void*), const LucuAllocator* allocator) {
+	assert(key_bytewidth > 0);
+	assert(key_hash_function != NULL && keys_equal_function != NULL);
+	LucuMap map = lucu_allocate(allocator, sizeof(LucuMapData));
+	map->allocator = allocator != NULL ? *allocator : (LucuAllocator){ .allocate = NULL };
+	const size_t key_align = alignment_for(key_bytewidth);
+	// A set stores no values, so they mustn't pad out its entries.
+	const size_t value_align = value_bytewidth == 0 ? 1 : alignment_for(value_bytewidth);
+	map->key_bytewidth = key_bytewidth;
+	map->value_bytewidth = value_bytewidth;
+	map->value_offset = round_up(key_bytewidth, value_align);
+	map->entry_size = round_up(map->value_offset + value_bytewidth, key_align > value_align ? key_align : value_align);
+	map->key_hash_function = key_hash_function;
+	map->keys_equal_function = keys_equal_function;
+	map->params = params;
+	map->key_free_function = key_free_function;
+	map->value_free_function = value_free_function;
+	// Nothing is allocated for entries until the first insert.
+	map->ctrl = NULL;
+	map->entries = NULL;
+	map->slots = 0;
+	map->length = 0;
+	map->growth_left = 0;
+	return map;
+}
+
+static void free_entry(const LucuMap map, const size_t slot) {
+	if (map->key_free_function != NULL) {
+		map->key_free_function(entry_key(map, slot));
+	}
+	if (map->value_free_function != NULL) {
+		map->value_free_function(entry_value(map, slot));
+	}
+}
+
+/**
+ * Frees the keys and values of every entry, leaving the slots as they are.
+ */
+static void free_entries(const LucuMap map) {
+	if (map->key_free_function == NULL && map->value_free_function == NULL) {
+		return;
+	}
+	for (int i = 0; i < map->slots; i++) {
+		if (is_full(map->ctrl[i])) {
+			free_entry(map, (size_t)i);
+		}
+	}
+}
+
+void lucu_map_destroy(LucuMap map) {
+	free_entries(map);
+	lucu_deallocate(&map->allocator, map->entries);
+	const LucuAllocator allocator = map->allocator;
+	lucu_deallocate(&allocator, map);
+}
+
+int lucu_map_length(const LucuMap map) {
+	return map->length;
+}
+
+int lucu_map_capacity(const LucuMap map) {
+	return map->slots == 0 ? 0 : max_load(map->slots);
+}
+
+void lucu_map_reserve(LucuMap map, const int length) {
+	if (length > lucu_map_capacity(map)) {
+		resize(map, slots_for(length));
+	}
+}
+
+bool lucu_map_insert(LucuMap map, const void* key, const void* value) {
+	const uint64_t hash = mix(map->key_hash_function((void*)key, map->params));
+	const ptrdiff_t found = find(map, key, hash);
+	if (found >= 0) {
+		free_entry(map, (size_t)found);
+		memcpy(entry_key(map, (size_t)found), key, map->key_bytewidth);
+		if (map->value_bytewidth > 0) {
+			memcpy(entry_value(map, (size_t)found), value, map->value_bytewidth);
+		}
+		return false;
+	}
+
+	if (map->growth_left == 0) {
+		// If at least half the used slots are deleted, rehashing in place frees enough room.
+		const int slots = map->slots == 0 ? LUCU_MAP_MIN_SLOTS : map->length * 2 <= max_load(map->slots) ? map->slots : map->slots * 2;
+		resize(map, slots);
+	}
+	const size_t slot = find_free(map, hash);
+	if (map->ctrl[slot] == CTRL_EMPTY) {
+		map->growth_left--;
+	}
+	set_ctrl(map, slot, h2(hash));
+	memcpy(entry_key(map, slot), key, map->key_bytewidth);
+	if (map->value_bytewidth > 0) {
+		memcpy(entry_value(map, slot), value, map->value_bytewidth);
+	}
+	map->length++;
+	return true;
+}
+
+void* lucu_map_get(const LucuMap map, const void* key) {
+	const ptrdiff_t found = find(map, key, mix(map->key_hash_function((void*)key, map->params)));
+	return found >= 0 ? entry_value(map, (size_t)found) : NULL;
+}
+
+bool lucu_map_remove(LucuMap map, const void* key) {
+	return lucu_map_remove_into(map, key, NULL, NULL);
+}
+
+bool lucu_map_remove_into(LucuMap map, const void* key, void* key_out, void* value_out) {
+	const ptrdiff_t found = find(map, key, mix(map->key_hash_function((void*)key, map->params)));
+	if (found < 0) {
+		return false;
+	}
+	const size_t slot = (size_t)found;
+	if (key_out != NULL) {
+		memcpy(key_out, entry_key(map, slot), map->key_bytewidth);
+	} else if (map->key_free_function != NULL) {
+		map->key_free_function(entry_key(map, slot));
+	}
+	if (value_out != NULL) {
+		memcpy(value_out, entry_value(map, slot), map->value_bytewidth);
+	} else if (map->value_free_function != NULL) {
+		map->value_free_function(entry_value(map, slot));
+	}
+	set_ctrl(map, slot, CTRL_DELETED);
+	map->length--;
+	return true;
+}
+
+void lucu_map_clear(LucuMap map) {
+	if (map->slots == 0) {
+		return;
+	}
+	free_entries(map);
+	memset(map->ctrl, CTRL_EMPTY, (size_t)map->slots + GROUP_WIDTH);
+	map->length = 0;
+	map->growth_left = max_load(map->slots);
+}
+
+bool lucu_map_next(const LucuMap map, int* position, void** key, void** value) {
+	for (int i = *position; i < map->slots; i++) {
+		if (is_full(map->ctrl[i])) {
+			if (key != NULL) {
+				*key = entry_key(map, (size_t)i);
+			}
+			if (value != NULL) {
+				*value = entry_value(map, (size_t)i);
+			}
+			*position = i + 1;
+			return true;
+		}
+	}
+	*position = map->slots;
+	return false;
+}
+
+void lucu_map_iterate(LucuMap map, bool (* const func)(void*, void*, void*), void* const params) {
+	for (int i = 0; i < map->slots; i++) {
+		if (is_full(map->ctrl[i]) && func(entry_key(map, (size_t)i), entry_value(map, (size_t)i), params)) {
+			return;
+		}
+	}
+}
@@ -2,29 +2,40 @@
 #include <string.h>
 #include <assert.h>
 
-struct LucuOptionData {
-	void* data;
-	size_t data_size;
-};
-
 LucuOption lucu_option_new_none() {
-	LucuOption option = malloc(sizeof(LucuOptionData));
+	return lucu_option_new_none_with_allocator(NULL);
+}
+
+LucuOption lucu_option_new_none_with_allocator(const LucuAllocator* allocator) {
+	LucuOption option = lucu_allocate(allocator, sizeof(LucuOptionData));
+	lucu_option_init_none(option);
+	if (allocator != NULL) {
+		option->allocator = *allocator;
+	}
+	return option;
+}
+
+LucuOption lucu_option_init_none(LucuOptionData* option) {
 	option->data = NULL;
 	option->data_size = 0;
+	option->allocator = (LucuAllocator){ .allocate = NULL };
 	return option;
 }
 
 LucuOption lucu_option_new_some(void* data, size_t data_size) {
-	LucuOption option = malloc(sizeof(LucuOptionData));
-	option->data = malloc(data_size);
-	memcpy(option->data, data, data_size);
-	option->data_size = data_size;
+	return lucu_option_new_some_with_allocator(data, data_size, NULL);
+}
+
+LucuOption lucu_option_new_some_with_allocator(void* data, size_t data_size, const LucuAllocator* allocator) {
+	LucuOption option = lucu_option_new_none_with_allocator(allocator);
+	lucu_option_set(option, data, data_size);
 	return option;
 }
 
 void lucu_option_destroy(LucuOption option) {
 	assert(!lucu_option_is_some(option));
-	free(option);
+	const LucuAllocator allocator = option->allocator;
+	lucu_deallocate(&allocator, option);
 }
 
 bool lucu_option_is_some(const LucuOption option) {
@@ -36,16 +47,37 @@ void* lucu_option_get(const LucuOption option) {
 	return option->data;
 }
 
+/**
+ * If the data of a `LucuOption` is stored in the option itself.
+ */
+static bool lucu_option_is_inline(const LucuOption option) {
+	return option->data == option->inline_data.bytes;
+}
+
 void* lucu_option_take(LucuOption option) {
 	assert(lucu_option_is_some(option));
 	void* data = option->data;
+	if (lucu_option_is_inline(option)) {
+		// The caller frees the data, so it can't stay in the option.
+		data = lucu_allocate(&option->allocator, option->data_size);
+		memcpy(data, option->inline_data.bytes, option->data_size);
+	}
 	option->data = NULL;
 	return data;
 }
 
+void lucu_option_take_into(LucuOption option, void* out) {
+	assert(lucu_option_is_some(option));
+	memcpy(out, option->data, option->data_size);
+	if (!lucu_option_is_inline(option)) {
+		lucu_deallocate(&option->allocator, option->data);
+	}
+	option->data = NULL;
+}
+
 void lucu_option_set(LucuOption option, void* data, size_t data_size) {
 	assert(!lucu_option_is_some(option));
-	option->data = malloc(data_size);
+	option->data = data_size <= LUCU_OPTION_INLINE_SIZE ? option->inline_data.bytes : lucu_allocate(&option->allocator, data_size);
 	memcpy(option->data, data, data_size);
 	option->data_size = data_size;
 }
@@ -0,0 +1,177 @@
+#include "lucu/pool.h"
+#include "align.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Header of an allocation made through `lucu_pool_allocator` that was
+ * too big for an element.
+ */
+typedef struct PoolLarge {
+	struct PoolLarge* next;
+	struct PoolLarge* prev;
+} PoolLarge;
+
+struct LucuPoolData {
+	size_t element_size;
+	/// Size of an element rounded up so that every element is aligned.
+	size_t slot_size;
+	int elements_per_block;
+	/// Freed elements. Each holds a pointer to the next one.
+	void* free_list;
+	/// Allocated blocks. Each starts with a pointer to the next one.
+	void* blocks;
+	/// Allocations too big for an element, most recent first.
+	PoolLarge* large;
+};
+
+LucuPool lucu_pool_new(const size_t element_size, const int elements_per_block) {
+	assert(elements_per_block > 0);
+	LucuPool pool = malloc(sizeof(LucuPoolData));
+	pool->element_size = element_size;
+	pool->slot_size = align_up(element_size > sizeof(void*) ? element_size : sizeof(void*));
+	pool->elements_per_block = elements_per_block;
+	pool->free_list = NULL;
+	pool->blocks = NULL;
+	pool->large = NULL;
+	return pool;
+}
+
+void lucu_pool_destroy(LucuPool pool) {
+	void* block = pool->blocks;
+	while (block != NULL) {
+		void* next;
+		memcpy(&next, block, sizeof(void*));
+		free(block);
+		block = next;
+	}
+	PoolLarge* large = pool->large;
+	while (large != NULL) {
+		PoolLarge* next = large->next;
+		free(large);
+		large = next;
+	}
+	free(pool);
+}
+
+/**
+ * Allocates a new block and puts all of its elements in the free list.
+ */
+static void pool_grow(LucuPool pool) {
+	const size_t header = align_up(sizeof(void*));
+	void* block = malloc(header + pool->slot_size * (size_t)pool->elements_per_block);
+	memcpy(block, &pool->blocks, sizeof(void*));
+	pool->blocks = block;
+	// Link the elements back to front, so they are handed out in address order.
+	for (int i = pool->elements_per_block - 1; i >= 0; i--) {
+		void* element = (void*)((uintptr_t)block + header + (size_t)i * pool->slot_size);
+		memcpy(element, &pool->free_list, sizeof(void*));
+		pool->free_list = element;
+	}
+}
+
+void* lucu_pool_alloc(LucuPool pool) {
+	if (pool->free_list == NULL) {
+		pool_grow(pool);
+	}
+	void* element = pool->free_list;
+	memcpy(&pool->free_list, element, sizeof(void*));
+	return element;
+}
+
+void lucu_pool_free(LucuPool pool, void* element) {
+	memcpy(element, &pool->free_list, sizeof(void*));
+	pool->free_list = element;
+}
+
+static void* large_data(PoolLarge* large) {
+	return (void*)((uintptr_t)large + align_up(sizeof(PoolLarge)));
+}
+
+static void large_link(LucuPool pool, PoolLarge* large) {
+	large->prev = NULL;
+	large->next = pool->large;
+	if (pool->large != NULL) {
+		pool->large->prev = large;
+	}
+	pool->large = large;
+}
+
+static void large_unlink(LucuPool pool, PoolLarge* large) {
+	if (large->prev == NULL) {
+		pool->large = large->next;
+	} else {
+		large->prev->next = large->next;
+	}
+	if (large->next != NULL) {
+		large->next->prev = large->prev;
+	}
+}
+
+/**
+ * Finds the `PoolLarge` that `ptr` is the data of.
+ *
+ * @return The `PoolLarge`, or `NULL` if `ptr` is an element of the pool.
+ */
+static PoolLarge* large_find(LucuPool pool, void* ptr) {
+	for (PoolLarge* large = pool->large; large != NULL; large = large->next) {
+		if (large_data(large) == ptr) {
+			return large;
+		}
+	}
+	return NULL;
+}
+
+static void* pool_allocate(size_t size, void* p) {
+	LucuPool pool = p;
+	if (size <= pool->element_size) {
+		return lucu_pool_alloc(pool);
+	}
+	PoolLarge* large = malloc(align_up(sizeof(PoolLarge)) + size);
+	large_link(pool, large);
+	return large_data(large);
+}
+
+static void* pool_reallocate(void* ptr, size_t old_size, size_t new_size, void* p) {
+	LucuPool pool = p;
+	if (ptr == NULL) {
+		return pool_allocate(new_size, pool);
+	}
+	PoolLarge* large = large_find(pool, ptr);
+	if (large != NULL) {
+		large_unlink(pool, large);
+		large = realloc(large, align_up(sizeof(PoolLarge)) + new_size);
+		large_link(pool, large);
+		return large_data(large);
+	}
+	if (new_size <= pool->element_size) {
+		return ptr;
+	}
+	void* moved = pool_allocate(new_size, pool);
+	memcpy(moved, ptr, old_size < pool->element_size ? old_size : pool->element_size);
+	lucu_pool_free(pool, ptr);
+	return moved;
+}
+
+static void pool_deallocate(void* ptr, void* p) {
+	LucuPool pool = p;
+	PoolLarge* large = large_find(pool, ptr);
+	if (large != NULL) {
+		large_unlink(pool, large);
+		free(large);
+	} else {
+		lucu_pool_free(pool, ptr);
+	}
+}
+
+LucuAllocator lucu_pool_allocator(LucuPool pool) {
+	return (LucuAllocator){
+		.allocate = pool_allocate,
+		.reallocate = pool_reallocate,
+		.deallocate = pool_deallocate,
+		.params = pool,
+	};
+}
@@ -0,0 +1,260 @@
+#include "lucu/queue.h"
+#include "align.h"
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct LucuSpscQueueData {
+	/// Position of the next element to dequeue. Only written by the consumer.
+	alignas(LUCU_CACHE_LINE_SIZE) atomic_size_t head;
+	/// The consumer's last read of `tail`, so it only reads `tail` when the queue looks empty.
+	size_t cached_tail;
+	/// Position of the next element to enqueue. Only written by the producer.
+	alignas(LUCU_CACHE_LINE_SIZE) atomic_size_t tail;
+	/// The producer's last read of `head`, so it only reads `head` when the queue looks full.
+	size_t cached_head;
+	alignas(LUCU_CACHE_LINE_SIZE) void* v;
+	size_t bytewidth;
+	/// `capacity - 1`, to wrap positions to indices.
+	size_t mask;
+	int capacity;
+};
+
+struct LucuMpmcQueueData {
+	/// Position of the next element to dequeue.
+	alignas(LUCU_CACHE_LINE_SIZE) atomic_size_t head;
+	/// Position of the next element to enqueue.
+	alignas(LUCU_CACHE_LINE_SIZE) atomic_size_t tail;
+	/**
+	 * Each slot is an `atomic_size_t` sequence number followed by the element.
+	 *
+	 * The slot for position `p` is ready to be written when its sequence is `p`
+	 * and ready to be read when its sequence is `p + 1`. Reading it sets the
+	 * sequence to `p + capacity`, the position that will next use it.
+	 */
+	alignas(LUCU_CACHE_LINE_SIZE) void* slots;
+	size_t slot_size;
+	size_t bytewidth;
+	size_t mask;
+	int capacity;
+};
+
+static size_t capacity_size(const int capacity) {
+	assert(capacity > 0);
+	return (size_t)next_power_of_two(capacity);
+}
+
+LucuSpscQueue lucu_spsc_queue_new(const int capacity, const size_t bytewidth) {
+	const size_t size = capacity_size(capacity);
+	LucuSpscQueue queue = aligned_alloc(alignof(LucuSpscQueueData), sizeof(LucuSpscQueueData));
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	queue->cached_head = 0;
+	queue->cached_tail = 0;
+	queue->v = malloc(size * bytewidth > 0 ? size * bytewidth : 1);
+	queue->bytewidth = bytewidth;
+	queue->mask = size - 1;
+	queue->capacity = (int)size;
+	return queue;
+}
+
+void lucu_spsc_queue_destroy(LucuSpscQueue queue) {
+	free(queue->v);
+	free(queue);
+}
+
+int lucu_spsc_queue_capacity(const LucuSpscQueue queue) {
+	return queue->capacity;
+}
+
+int lucu_spsc_queue_length(const LucuSpscQueue queue) {
+	const size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	const size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	const size_t length = tail - head;
+	// `head` can overtake the `tail` read before it.
+	return length > (size_t)queue->capacity ? 0 : (int)length;
+}
+
+/**
+ * Copies `length` elements between `arr` and the queue's circular array
+ * starting at `position`, in at most two pieces.
+ */
+static void spsc_copy(LucuSpscQueue queue, const size_t position, void* arr, const size_t length, const bool into_queue) {
+	const size_t start = position & queue->mask;
+	const size_t first = length < (size_t)queue->capacity - start ? length : (size_t)queue->capacity - start;
+	void* const slot = (void*)((uintptr_t)queue->v + start * queue->bytewidth);
+	void* const rest = (void*)((uintptr_t)arr + first * queue->bytewidth);
+	if (into_queue) {
+		memcpy(slot, arr, first * queue->bytewidth);
+		memcpy(queue->v, rest, (length - first) * queue->bytewidth);
+	} else {
+		memcpy(arr, slot, first * queue->bytewidth);
+		memcpy(rest, queue->v, (length - first) * queue->bytewidth);
+	}
+}
+
+int lucu_spsc_queue_enqueue_batch(LucuSpscQueue queue, const void* arr, const int length) {
+	assert(length >= 0);
+	const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	size_t free_slots = (size_t)queue->capacity - (tail - queue->cached_head);
+	if (free_slots < (size_t)length) {
+		queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+		free_slots = (size_t)queue->capacity - (tail - queue->cached_head);
+	}
+	const size_t n = free_slots < (size_t)length ? free_slots : (size_t)length;
+	if (n == 0) {
+		return 0;
+	}
+	spsc_copy(queue, tail, (void*)arr, n, true);
+	atomic_store_explicit(&queue->tail, tail + n, memory_order_release);
+	return (int)n;
+}
+
+bool lucu_spsc_queue_enqueue(LucuSpscQueue queue, const void* data) {
+	return lucu_spsc_queue_enqueue_batch(queue, data, 1) == 1;
+}
+
+int lucu_spsc_queue_dequeue_batch(LucuSpscQueue queue, void* out, const int length) {
+	assert(length >= 0);
+	const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	size_t available = queue->cached_tail - head;
+	if (available < (size_t)length) {
+		queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+		available = queue->cached_tail - head;
+	}
+	const size_t n = available < (size_t)length ? available : (size_t)length;
+	if (n == 0) {
+		return 0;
+	}
+	if (out != NULL) {
+		spsc_copy(queue, head, out, n, false);
+	}
+	atomic_store_explicit(&queue->head, head + n, memory_order_release);
+	return (int)n;
+}
+
+bool lucu_spsc_queue_dequeue(LucuSpscQueue queue, void* out) {
+	return lucu_spsc_queue_dequeue_batch(queue, out, 1) == 1;
+}
+
+static atomic_size_t* mpmc_sequence(const LucuMpmcQueue queue, const size_t position) {
+	return (atomic_size_t*)((uintptr_t)queue->slots + (position & queue->mask) * queue->slot_size);
+}
+
+static void* mpmc_element(const LucuMpmcQueue queue, const size_t position) {
+	return (void*)((uintptr_t)mpmc_sequence(queue, position) + sizeof(atomic_size_t));
+}
+
+LucuMpmcQueue lucu_mpmc_queue_new(const int capacity, const size_t bytewidth) {
+	const size_t size = capacity_size(capacity);
+	LucuMpmcQueue queue = aligned_alloc(alignof(LucuMpmcQueueData), sizeof(LucuMpmcQueueData));
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	// Elements are only ever copied with `memcpy`, so they need no alignment.
+	const size_t sequence_align = alignof(atomic_size_t);
+	queue->slot_size = (sizeof(atomic_size_t) + bytewidth + sequence_align - 1) / sequence_align * sequence_align;
+	queue->slots = malloc(size * queue->slot_size);
+	queue->bytewidth = bytewidth;
+	queue->mask = size - 1;
+	queue->capacity = (int)size;
+	for (size_t i = 0; i < size; i++) {
+		atomic_init(mpmc_sequence(queue, i), i);
+	}
+	return queue;
+}
+
+void lucu_mpmc_queue_destroy(LucuMpmcQueue queue) {
+	free(queue->slots);
+	free(queue);
+}
+
+int lucu_mpmc_queue_capacity(const LucuMpmcQueue queue) {
+	return queue->capacity;
+}
+
+int lucu_mpmc_queue_length(const LucuMpmcQueue queue) {
+	const size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+	const size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+	const size_t length = tail - head;
+	if (length > (size_t)queue->capacity) {
+		// Either `head` overtook the `tail` read before it, or too many
+		// elements were enqueued between the two reads.
+		return (ptrdiff_t)length < 0 ? 0 : queue->capacity;
+	}
+	return (int)length;
+}
+
+/**
+ * Claims up to `length` consecutive positions for enqueueing (`ready` is 0)
+ * or dequeueing (`ready` is 1) by advancing `index`.
+ *
+ * The position `p` can be claimed when its slot's sequence is `p + ready`.
+ * Slots are only written by whoever claimed their position, so while
+ * `index` is still `position` no other thread can change the sequences
+ * counted here, and one compare and swap claims them all.
+ * @return The number of positions claimed, starting at `*position`.
+ */
+static size_t mpmc_claim(const LucuMpmcQueue queue, atomic_size_t* const index, const size_t ready, const size_t length, size_t* const position) {
+	size_t p = atomic_load_explicit(index, memory_order_relaxed);
+	for (;;) {
+		size_t n = 0;
+		while (n < length && atomic_load_explicit(mpmc_sequence(queue, p + n), memory_order_acquire) == p + n + ready) {
+			n++;
+		}
+		if (n == 0) {
+			const size_t sequence = atomic_load_explicit(mpmc_sequence(queue, p), memory_order_acquire);
+			if ((ptrdiff_t)(sequence - (p + ready)) < 0) {
+				// The slot hasn't been released by the last lap yet: full or empty.
+				return 0;
+			}
+			// Another thread claimed `p` already.
+			p = atomic_load_explicit(index, memory_order_relaxed);
+			continue;
+		}
+		if (atomic_compare_exchange_weak_explicit(index, &p, p + n, memory_order_relaxed, memory_order_relaxed)) {
+			*position = p;
+			return n;
+		}
+	}
+}
+
+int lucu_mpmc_queue_enqueue_batch(LucuMpmcQueue queue, const void* arr, const int length) {
+	assert(length >= 0);
+	if (length == 0) {
+		return 0;
+	}
+	size_t position;
+	const size_t n = mpmc_claim(queue, &queue->tail, 0, (size_t)length, &position);
+	for (size_t i = 0; i < n; i++) {
+		memcpy(mpmc_element(queue, position + i), (void*)((uintptr_t)arr + i * queue->bytewidth), queue->bytewidth);
+		atomic_store_explicit(mpmc_sequence(queue, position + i), position + i + 1, memory_order_release);
+	}
+	return (int)n;
+}
+
+bool lucu_mpmc_queue_enqueue(LucuMpmcQueue queue, const void* data) {
+	return lucu_mpmc_queue_enqueue_batch(queue, data, 1) == 1;
+}
+
+int lucu_mpmc_queue_dequeue_batch(LucuMpmcQueue queue, void* out, const int length) {
+	assert(length >= 0);
+	if (length == 0) {
+		return 0;
+	}
+	size_t position;
+	const size_t n = mpmc_claim(queue, &queue->head, 1, (size_t)length, &position);
+	for (size_t i = 0; i < n; i++) {
+		if (out != NULL) {
+			memcpy((void*)((uintptr_t)out + i * queue->bytewidth), mpmc_element(queue, position + i), queue->bytewidth);
+		}
+		atomic_store_explicit(mpmc_sequence(queue, position + i), position + i + queue->mask + 1, memory_order_release);
+	}
+	return (int)n;
+}
+
+bool lucu_mpmc_queue_dequeue(LucuMpmcQueue queue, void* out) {
+	return lucu_mpmc_queue_dequeue_batch(queue, out, 1) == 1;
+}
@@ -1,9 +1,14 @@
-#include "lucu/lucu.h"
 #include "lucu/vector.h"
+#include "align.h"
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <unistd.h>
 
 /**
  * Initial size of the vector.
@@ -13,68 +18,137 @@
  */
 #define LUCU_VECTOR_INIT_SIZE 16
 /**
- * Size increase multiplier.
+ * Default size increase multiplier.
  *
  * When increasing the size of a vector, the size is multiplied by this
- * constant. **Must** be greater than 1.
+ * constant unless changed with `lucu_vector_set_growth_factor`.
+ * **Must** be greater than 1.
  */
 #define LUCU_VECTOR_SIZE_INCREASE 1.5
+/**
+ * Fewest elements `lucu_vector_sort_parallel` gives each thread.
+ *
+ * Below this, starting a thread costs more than sorting the elements.
+ */
+#define LUCU_VECTOR_PARALLEL_SORT_MIN 4096
+/**
+ * Largest element storage, in bytes, kept in the same allocation as the vector.
+ *
+ * Saves small vectors an allocation. Once such a vector grows, that storage
+ * stays allocated but unused until the vector is destroyed, so larger
+ * vectors get their elements allocated separately.
+ */
+#define LUCU_VECTOR_INLINE_BYTES 256
 
-static inline int mod(const int a, const int b) {
-	return ((a % b) + b) % b;
-}
-
-struct LucuVectorData {
-	/// Array where elements are stored
-	void* v;
-	/// The number of bytes that an element takes up
-	size_t bytewidth;
-	/// Number of elements that can be stored in the currently allocated space.
-	/// **Not** the number of elements in the array.
-	/// **Not** the number of bytes allocated.
-	int size;
-	/// The index of the first element of the circular array.
-	int head;
-	/// The index of the last element of the circular array plus 1 mod `size`.
-	int tail;
-	/// Function used to free elements of the `LucuVector`.
-	/// See `lucu_vector_new` for more information
-	void (*free_function)(void*);
-};
+/// Set by `lucu_vector_set_hooks`.
+static _Atomic(const LucuVectorHooks*) vector_hooks = NULL;
 
 static void lucu_vector_increase_size(LucuVector vector);
+static void lucu_vector_reserve_more(LucuVector vector, const int additional);
 static int lucu_vector_local_index_to_global_index(const LucuVector vector, const int index);
 
+/**
+ * The installed `LucuVectorHooks`, or `NULL` if there are none.
+ *
+ * Always `NULL` without `LUCU_VECTOR_HOOKS`, so the compiler drops
+ * every `if` that checks it.
+ */
+static inline const LucuVectorHooks* hooks_of(void) {
+	return LUCU_VECTOR_HOOKS ? atomic_load_explicit(&vector_hooks, memory_order_acquire) : NULL;
+}
+
+void lucu_vector_set_hooks(const LucuVectorHooks* const hooks) {
+	if (LUCU_VECTOR_HOOKS) {
+		atomic_store_explicit(&vector_hooks, hooks, memory_order_release);
+	}
+}
+
 LucuVector lucu_vector_new(const size_t bytewidth, void (* const free_function)(void*)) {
 	return lucu_vector_new_with_size(LUCU_VECTOR_INIT_SIZE, bytewidth, free_function);
 }
 
 LucuVector lucu_vector_new_with_size(const int length, const size_t bytewidth, void (* const free_function)(void*)) {
-	const int len = length == 0 ? LUCU_VECTOR_INIT_SIZE : length;
+	return lucu_vector_new_with_allocator(length, bytewidth, free_function, NULL);
+}
+
+LucuVector lucu_vector_new_with_allocator(const int length, const size_t bytewidth, void (* const free_function)(void*), const LucuAllocator* const allocator) {
+	// One slot is always left empty to tell a full vector from an empty one.
+	const int len = length == 0 ? LUCU_VECTOR_INIT_SIZE : length + 1;
+
+	const size_t bytes = bytewidth * (size_t)len;
+	LucuVector vector;
+	if (bytes <= LUCU_VECTOR_INLINE_BYTES) {
+		// The elements follow the vector in the same allocation.
+		const size_t offset = align_up(sizeof(LucuVectorData));
+		vector = lucu_allocate(allocator, offset + bytes);
+		lucu_vector_init(vector, (void*)((uintptr_t)vector + offset), len, bytewidth, free_function);
+		vector->inline_size = len;
+	} else {
+		vector = lucu_allocate(allocator, sizeof(LucuVectorData));
+		lucu_vector_init(vector, lucu_allocate(allocator, bytes), len, bytewidth, free_function);
+		vector->owns_v = true;
+	}
+	if (allocator != NULL) {
+		vector->allocator = *allocator;
+	}
+	const LucuVectorHooks* const hooks = hooks_of();
+	if (hooks != NULL && hooks->on_alloc != NULL) {
+		hooks->on_alloc(vector, bytes, hooks->params);
+	}
+	return vector;
+}
 
-	LucuVector vector = malloc(sizeof(LucuVectorData));
+LucuVector lucu_vector_init(LucuVectorData* vector, void* buffer, const int buffer_length, const size_t bytewidth, void (* const free_function)(void*)) {
+	assert(buffer_length > 0);
 	vector->bytewidth = bytewidth;
-	vector->size = len;
-	vector->v = malloc(bytewidth * (size_t)len);
+	vector->size = buffer_length;
+	vector->v = buffer;
 	vector->head = 0;
 	vector->tail = 0;
+	vector->power_of_two = false;
+	vector->growth_factor = LUCU_VECTOR_SIZE_INCREASE;
 	vector->free_function = free_function;
+	vector->owns_v = false;
+	vector->inline_size = 0;
+	vector->allocator = (LucuAllocator){ .allocate = NULL };
 	return vector;
 }
 
-static bool lucu_vector_destroy_func(void* const data, void* params) {
-	void (*free_function)(void*) = (void (*)(void*))((LucuGenericFunction*)params)->f;
-	free_function(data);
-	return false;
+LucuVector lucu_vector_new_power_of_two(const int length, const size_t bytewidth, void (* const free_function)(void*)) {
+	const int len = length == 0 ? LUCU_VECTOR_INIT_SIZE : next_power_of_two(length + 1);
+
+	LucuVector vector = lucu_vector_new_with_size(len - 1, bytewidth, free_function);
+	vector->power_of_two = true;
+	return vector;
 }
 
-void lucu_vector_destroy(LucuVector vector) {
+void lucu_vector_deinit(LucuVector vector) {
 	if (vector->free_function != NULL) {
-		LucuGenericFunction ff = { (void (*)(void))vector->free_function };
-		lucu_vector_iterate(vector, lucu_vector_destroy_func, (void*)&ff);
+		LucuVectorSpan spans[2];
+		const int count = lucu_vector_spans(vector, spans);
+		for (int s = 0; s < count; s++) {
+			for (int i = 0; i < spans[s].length; i++) {
+				vector->free_function((void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth));
+			}
+		}
+	}
+	const LucuVectorHooks* const hooks = hooks_of();
+	if (hooks != NULL && hooks->on_free != NULL && vector->owns_v) {
+		hooks->on_free(vector, lucu_vector_allocated_bytes(vector), hooks->params);
+	}
+	if (vector->owns_v) {
+		lucu_deallocate(&vector->allocator, vector->v);
 	}
-	free(vector->v);
-	free(vector);
+}
+
+void lucu_vector_destroy(LucuVector vector) {
+	lucu_vector_deinit(vector);
+	const LucuVectorHooks* const hooks = hooks_of();
+	if (hooks != NULL && hooks->on_free != NULL && vector->inline_size > 0) {
+		hooks->on_free(vector, (size_t)vector->inline_size * vector->bytewidth, hooks->params);
+	}
+	const LucuAllocator allocator = vector->allocator;
+	lucu_deallocate(&allocator, vector);
 }
 
 LucuVector lucu_vector_from_array(const void* const arr, const int length, const size_t bytewidth, void (* const free_function)(void*)) {
@@ -112,56 +186,143 @@ void* lucu_vector_to_array(const LucuVector vector, size_t* size) {
 	return arr;
 }
 
-static bool lucu_vector_print_func(void* const data, void* params) {
-	void** pars = (void**)params;
-	void (*print_function)(void*, void*) = (void (*)(void*, void*))((LucuGenericFunction*)pars[0])->f;
-	void* par = pars[1];
-	print_function(data, par);
-	printf(",");
-	return false;
-}
-
 void lucu_vector_print(LucuVector vector, void (* const print_function)(void*, void*), void* params) {
 	printf("[");
 
-	LucuGenericFunction pf = { (void (*)(void))print_function };
-	void* pars[] = {(void*)&pf, params};
-	lucu_vector_iterate(vector, lucu_vector_print_func, (void*)pars);
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			print_function((void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth), params);
+			printf(",");
+		}
+	}
 
 	printf("]");
 }
 
-bool lucu_vector_is_empty(const LucuVector vector) {
-	return vector->head == vector->tail;
+/**
+ * Moves the elements into an allocation of `new_size` elements.
+ *
+ * The ring is unwrapped so `head` ends up at 0. That takes at most two
+ * block copies, or none at all when `head` is already 0 and `realloc`
+ * can resize the allocation in place. Elements stored in memory the
+ * vector doesn't own are always copied to a new allocation.
+ */
+static void lucu_vector_resize(LucuVector vector, const int size) {
+	const int new_size = vector->power_of_two ? next_power_of_two(size) : size;
+	const int length = lucu_vector_length(vector);
+	assert(new_size > length);
+	const LucuVectorHooks* const hooks = hooks_of();
+	const int old_size = vector->size;
+	const uintptr_t old_v = (uintptr_t)vector->v;
+	if (hooks != NULL && hooks->on_free != NULL && vector->owns_v) {
+		hooks->on_free(vector, lucu_vector_allocated_bytes(vector), hooks->params);
+	}
+	if (vector->head == 0 && vector->owns_v) {
+		vector->v = lucu_reallocate(&vector->allocator, vector->v, vector->bytewidth * (size_t)vector->size, vector->bytewidth * (size_t)new_size);
+	} else {
+		void* new_q = lucu_allocate(&vector->allocator, vector->bytewidth * (size_t)new_size);
+		const int first = vector->tail >= vector->head ? length : vector->size - vector->head;
+		memcpy(new_q, (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth), (size_t)first * vector->bytewidth);
+		if (length > first) {
+			memcpy((void*)((uintptr_t)new_q + (size_t)first * vector->bytewidth), vector->v, (size_t)(length - first) * vector->bytewidth);
+		}
+		if (vector->owns_v) {
+			lucu_deallocate(&vector->allocator, vector->v);
+		}
+		vector->v = new_q;
+		vector->owns_v = true;
+	}
+	vector->size = new_size;
+	vector->head = 0;
+	vector->tail = length;
+	if (hooks != NULL) {
+		if (hooks->on_alloc != NULL) {
+			hooks->on_alloc(vector, lucu_vector_allocated_bytes(vector), hooks->params);
+		}
+		void (* const on_resize)(const LucuVector, int, int, size_t, void*) = new_size > old_size ? hooks->on_grow : hooks->on_shrink;
+		if (on_resize != NULL) {
+			const size_t bytes_copied = (uintptr_t)vector->v == old_v ? 0 : (size_t)length * vector->bytewidth;
+			on_resize(vector, old_size - 1, new_size - 1, bytes_copied, hooks->params);
+		}
+	}
+}
+
+static void lucu_vector_increase_size(LucuVector vector) {
+	const int new_size = (int)(vector->size * vector->growth_factor);
+	lucu_vector_resize(vector, new_size > vector->size ? new_size : vector->size + 1);
 }
 
-int lucu_vector_length(const LucuVector vector) {
-	return (vector->tail < vector->head ? vector->tail + vector->size : vector->tail) - vector->head;
+/**
+ * Makes sure `additional` more elements fit without reallocating.
+ *
+ * Grows by at least the vector's growth factor so that repeated
+ * bulk pushes still take amortized *O(1)* time per element.
+ */
+static void lucu_vector_reserve_more(LucuVector vector, const int additional) {
+	// One slot is always left empty to tell a full vector from an empty one.
+	const int needed = lucu_vector_length(vector) + additional + 1;
+	if (needed <= vector->size) {
+		return;
+	}
+	const int grown = (int)(vector->size * vector->growth_factor);
+	lucu_vector_resize(vector, grown > needed ? grown : needed);
 }
 
-static void lucu_vector_increase_size(LucuVector vector) {
-	const int old_size = vector->size;
-	vector->size = (int)(old_size * LUCU_VECTOR_SIZE_INCREASE);
-	void* new_q = malloc(vector->bytewidth * (size_t)vector->size);
-	int i = vector->head;
-	int j = 0;
-	while (i != vector->tail) {
-		memcpy((void*)((uintptr_t)new_q + (size_t)j * vector->bytewidth), (void*)((uintptr_t)vector->v + (size_t)i * vector->bytewidth), vector->bytewidth);
-		i = mod(i + 1, old_size);
-		j++;
-	}
-	free(vector->v);
-	vector->v = new_q;
-	vector->head = 0;
-	vector->tail = j;
+int lucu_vector_capacity(const LucuVector vector) {
+	return vector->size - 1;
+}
+
+size_t lucu_vector_bytewidth(const LucuVector vector) {
+	return vector->bytewidth;
+}
+
+size_t lucu_vector_allocated_bytes(const LucuVector vector) {
+	return (size_t)vector->size * vector->bytewidth;
+}
+
+void lucu_vector_reserve(LucuVector vector, const int length) {
+	if (length + 1 > vector->size) {
+		lucu_vector_resize(vector, length + 1);
+	}
+}
+
+void lucu_vector_shrink_to_fit(LucuVector vector) {
+	if (!vector->owns_v) {
+		// Moving the elements out of memory the vector can't free would only use more.
+		return;
+	}
+	const int length = lucu_vector_length(vector);
+	const int size = vector->power_of_two ? next_power_of_two(length + 1) : length + 1;
+	if (size < vector->size) {
+		lucu_vector_resize(vector, size);
+	}
+}
+
+void lucu_vector_set_growth_factor(LucuVector vector, const double growth_factor) {
+	assert(growth_factor > 1);
+	vector->growth_factor = growth_factor;
+}
+
+/**
+ * Copies `length` elements from `arr` into the ring starting at the
+ * global index `start`, wrapping around the end of the allocation.
+ */
+static void lucu_vector_copy_in(LucuVector vector, const int start, const void* const arr, const int length) {
+	const int first = length < vector->size - start ? length : vector->size - start;
+	memcpy((void*)((uintptr_t)vector->v + (size_t)start * vector->bytewidth), arr, (size_t)first * vector->bytewidth);
+	if (length > first) {
+		memcpy(vector->v, (const void*)((uintptr_t)arr + (size_t)first * vector->bytewidth), (size_t)(length - first) * vector->bytewidth);
+	}
 }
 
 void lucu_vector_push_back(LucuVector vector, const void* const data) {
-	if (vector->head == mod(vector->tail + 1, vector->size)) {
+	if (vector->head == lucu_vector_wrap_index(vector, vector->tail + 1)) {
 		lucu_vector_increase_size(vector);
 	}
 	memcpy((void*)((uintptr_t)vector->v + (size_t)vector->tail * vector->bytewidth), data, vector->bytewidth);
-	vector->tail = mod(vector->tail + 1, vector->size);
+	vector->tail = lucu_vector_wrap_index(vector, vector->tail + 1);
 }
 
 void lucu_vector_push(LucuVector vector, const void* const data) {
@@ -172,24 +333,72 @@ void lucu_vector_enqueue(LucuVector vector, const void* const data) {
 	lucu_vector_push_back(vector, data);
 }
 
+void lucu_vector_append(LucuVector vector, const void* const arr, const int length) {
+	assert(length >= 0);
+	if (length == 0) {
+		return;
+	}
+	lucu_vector_reserve_more(vector, length);
+	lucu_vector_copy_in(vector, vector->tail, arr, length);
+	vector->tail = lucu_vector_wrap_index(vector, vector->tail + length);
+}
+
+void lucu_vector_prepend(LucuVector vector, const void* const arr, const int length) {
+	assert(length >= 0);
+	if (length == 0) {
+		return;
+	}
+	lucu_vector_reserve_more(vector, length);
+	vector->head = lucu_vector_wrap_index(vector, vector->head - length);
+	lucu_vector_copy_in(vector, vector->head, arr, length);
+}
+
+void lucu_vector_extend(LucuVector vector, const LucuVector other) {
+	assert(vector->bytewidth == other->bytewidth);
+	const int length = lucu_vector_length(other);
+	if (length == 0) {
+		return;
+	}
+	// Reserve first, since `other` may be `vector` itself.
+	lucu_vector_reserve_more(vector, length);
+	const int first = other->tail >= other->head ? length : other->size - other->head;
+	const void* const start = (const void*)((uintptr_t)other->v + (size_t)other->head * other->bytewidth);
+	lucu_vector_copy_in(vector, vector->tail, start, first);
+	if (length > first) {
+		lucu_vector_copy_in(vector, lucu_vector_wrap_index(vector, vector->tail + first), other->v, length - first);
+	}
+	vector->tail = lucu_vector_wrap_index(vector, vector->tail + length);
+}
+
 void lucu_vector_push_front(LucuVector vector, const void* const data) {
-	if (mod(vector->head - 1, vector->size) == vector->tail) {
+	if (lucu_vector_wrap_index(vector, vector->head - 1) == vector->tail) {
 		lucu_vector_increase_size(vector);
 	}
-	vector->head = mod(vector->head - 1, vector->size);
+	vector->head = lucu_vector_wrap_index(vector, vector->head - 1);
 	memcpy((void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth), data, vector->bytewidth);
 }
 
+bool lucu_vector_pop_front_into(LucuVector vector, void* const out) {
+	if (lucu_vector_is_empty(vector)) {
+		return false;
+	}
+	void* const front = (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth);
+	if (out != NULL) {
+		memcpy(out, front, vector->bytewidth);
+	}
+	if (vector->free_function != NULL) {
+		vector->free_function(front);
+	}
+	vector->head = lucu_vector_wrap_index(vector, vector->head + 1);
+	return true;
+}
+
 void* lucu_vector_pop_front(LucuVector vector) {
 	if (lucu_vector_is_empty(vector)) {
 		return NULL;
 	}
 	void* data = malloc(vector->bytewidth);
-	memcpy(data, (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth), vector->bytewidth);
-	if (vector->free_function != NULL) {
-		vector->free_function((void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth));
-	}
-	vector->head = mod(vector->head + 1, vector->size);
+	lucu_vector_pop_front_into(vector, data);
 	return data;
 }
 
@@ -197,16 +406,31 @@ void* lucu_vector_dequeue(LucuVector vector) {
 	return lucu_vector_pop_front(vector);
 }
 
+bool lucu_vector_dequeue_into(LucuVector vector, void* const out) {
+	return lucu_vector_pop_front_into(vector, out);
+}
+
+bool lucu_vector_pop_back_into(LucuVector vector, void* const out) {
+	if (lucu_vector_is_empty(vector)) {
+		return false;
+	}
+	vector->tail = lucu_vector_wrap_index(vector, vector->tail - 1);
+	void* const back = (void*)((uintptr_t)vector->v + (size_t)vector->tail * vector->bytewidth);
+	if (out != NULL) {
+		memcpy(out, back, vector->bytewidth);
+	}
+	if (vector->free_function != NULL) {
+		vector->free_function(back);
+	}
+	return true;
+}
+
 void* lucu_vector_pop_back(LucuVector vector) {
 	if (lucu_vector_is_empty(vector)) {
 		return NULL;
 	}
 	void* data = malloc(vector->bytewidth);
-	vector->tail = mod(vector->tail - 1, vector->size);
-	memcpy(data, (void*)((uintptr_t)vector->v + (size_t)vector->tail * vector->bytewidth), vector->bytewidth);
-	if (vector->free_function != NULL) {
-		vector->free_function((void*)((uintptr_t)vector->v + (size_t)vector->tail * vector->bytewidth));
-	}
+	lucu_vector_pop_back_into(vector, data);
 	return data;
 }
 
@@ -214,205 +438,627 @@ void* lucu_vector_pop(LucuVector vector) {
 	return lucu_vector_pop_back(vector);
 }
 
-void lucu_vector_swap(LucuVector vector, const int index_1, const int index_2) {
-	void* tmp = malloc(vector->bytewidth);
-	memcpy(tmp, lucu_vector_get(vector, index_1), vector->bytewidth);
-	memcpy(lucu_vector_get(vector, index_1), lucu_vector_get(vector, index_2), vector->bytewidth);
-	memcpy(lucu_vector_get(vector, index_2), tmp, vector->bytewidth);
-	free(tmp);
+bool lucu_vector_pop_into(LucuVector vector, void* const out) {
+	return lucu_vector_pop_back_into(vector, out);
 }
 
-static bool lucu_vector_index_func(void* const data, void* params) {
-	void** pars = (void**)params;
-	void* d = pars[0];
-	bool (*equal)(void*, void*, void*) = (bool (*)(void*, void*, void*))((LucuGenericFunction*)pars[1])->f;
-	int* index = pars[2];
-	void* par = pars[3];
-	if (equal(data, d, par)) {
-		return true;
+void lucu_vector_swap(LucuVector vector, const int index_1, const int index_2) {
+	unsigned char* const a = lucu_vector_get(vector, index_1);
+	unsigned char* const b = lucu_vector_get(vector, index_2);
+	// Swap through a small buffer on the stack, a chunk at a time.
+	unsigned char tmp[64];
+	for (size_t offset = 0; offset < vector->bytewidth; offset += sizeof(tmp)) {
+		const size_t n = vector->bytewidth - offset < sizeof(tmp) ? vector->bytewidth - offset : sizeof(tmp);
+		memcpy(tmp, a + offset, n);
+		memcpy(a + offset, b + offset, n);
+		memcpy(b + offset, tmp, n);
 	}
-	*index += 1;
-	return false;
 }
 
 int lucu_vector_index(LucuVector vector, void* const data, bool (* const equal)(void*, void*, void*), void* const params) {
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
 	int index = 0;
-	LucuGenericFunction eq = { (void (*)(void))equal };
-	void* pars[] = {data, (void*)&eq, (void*)&index, params};
-	lucu_vector_iterate(vector, lucu_vector_index_func, pars);
-	if (index == lucu_vector_length(vector)) {
-		return -1;
-	} else {
-		return index;
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++, index++) {
+			if (equal((void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth), data, params)) {
+				return index;
+			}
+		}
 	}
+	return -1;
 }
 
 static int lucu_vector_local_index_to_global_index(const LucuVector vector, const int index) {
-	return mod(vector->head + index, vector->size);
+	return lucu_vector_wrap_index(vector, vector->head + index);
 }
 
-void* lucu_vector_get(const LucuVector vector, const int index) {
-	return (void*)((uintptr_t)vector->v + (size_t)lucu_vector_local_index_to_global_index(vector, index) * vector->bytewidth);
+/**
+ * Moves `length` elements from the global index `src` to the global index `dst`.
+ *
+ * Splits the move wherever either range wraps around the end of the
+ * allocation, so it takes at most three `memmove`s. `toward_tail` says which
+ * way the elements move, so that overlapping ranges are copied in an order
+ * that never overwrites elements that haven't been moved yet.
+ */
+static void lucu_vector_move(LucuVector vector, int dst, int src, int length, const bool toward_tail) {
+	const size_t w = vector->bytewidth;
+	if (toward_tail) {
+		// Work backwards from the ends of the ranges.
+		dst = lucu_vector_wrap_index(vector, dst + length);
+		src = lucu_vector_wrap_index(vector, src + length);
+		while (length > 0) {
+			const int dst_run = dst == 0 ? vector->size : dst;
+			const int src_run = src == 0 ? vector->size : src;
+			int n = length < dst_run ? length : dst_run;
+			n = n < src_run ? n : src_run;
+			dst = dst_run - n;
+			src = src_run - n;
+			memmove((void*)((uintptr_t)vector->v + (size_t)dst * w), (void*)((uintptr_t)vector->v + (size_t)src * w), (size_t)n * w);
+			length -= n;
+		}
+	} else {
+		while (length > 0) {
+			int n = length < vector->size - dst ? length : vector->size - dst;
+			n = n < vector->size - src ? n : vector->size - src;
+			memmove((void*)((uintptr_t)vector->v + (size_t)dst * w), (void*)((uintptr_t)vector->v + (size_t)src * w), (size_t)n * w);
+			dst = lucu_vector_wrap_index(vector, dst + n);
+			src = lucu_vector_wrap_index(vector, src + n);
+			length -= n;
+		}
+	}
+}
+
+void lucu_vector_remove_range(LucuVector vector, const int index, const int length) {
+	const int vector_length = lucu_vector_length(vector);
+	assert(index >= 0 && length >= 0 && index + length <= vector_length);
+	if (vector->free_function != NULL) {
+		for (int i = 0; i < length; i++) {
+			vector->free_function(lucu_vector_get(vector, index + i));
+		}
+	}
+	// Close the gap by moving whichever side of it has fewer elements.
+	const int after = vector_length - index - length;
+	if (index < after) {
+		lucu_vector_move(vector, lucu_vector_wrap_index(vector, vector->head + length), vector->head, index, true);
+		vector->head = lucu_vector_wrap_index(vector, vector->head + length);
+	} else {
+		const int gap = lucu_vector_local_index_to_global_index(vector, index);
+		lucu_vector_move(vector, gap, lucu_vector_wrap_index(vector, gap + length), after, false);
+		vector->tail = lucu_vector_wrap_index(vector, vector->tail - length);
+	}
 }
 
 void lucu_vector_remove(LucuVector vector, const int index) {
 	assert(index < lucu_vector_length(vector) && index >= 0);
-	int i = lucu_vector_local_index_to_global_index(vector, index);
-	if (vector->free_function != NULL) {
-		vector->free_function((void*)((uintptr_t)vector->v + (size_t)i * vector->bytewidth));
+	lucu_vector_remove_range(vector, index, 1);
+}
+
+void lucu_vector_insert_range(LucuVector vector, const void* const arr, const int length, const int index) {
+	const int vector_length = lucu_vector_length(vector);
+	assert(index >= 0 && index <= vector_length && length >= 0);
+	if (length == 0) {
+		return;
 	}
-	while (i != vector->tail) {
-		memcpy((void*)((uintptr_t)vector->v + (size_t)i * vector->bytewidth), (void*)((uintptr_t)vector->v + (size_t)mod(i + 1, vector->size) * vector->bytewidth), vector->bytewidth);
-		i = mod(i + 1, vector->size);
+	lucu_vector_reserve_more(vector, length);
+	// Open a gap by moving whichever side of it has fewer elements.
+	const int after = vector_length - index;
+	if (index < after) {
+		const int head = lucu_vector_wrap_index(vector, vector->head - length);
+		lucu_vector_move(vector, head, vector->head, index, false);
+		vector->head = head;
+	} else {
+		const int gap = lucu_vector_local_index_to_global_index(vector, index);
+		lucu_vector_move(vector, lucu_vector_wrap_index(vector, gap + length), gap, after, true);
+		vector->tail = lucu_vector_wrap_index(vector, vector->tail + length);
 	}
-	vector->tail = mod(vector->tail - 1, vector->size);
+	lucu_vector_copy_in(vector, lucu_vector_local_index_to_global_index(vector, index), arr, length);
 }
 
 void lucu_vector_insert(LucuVector vector, const void* const data, const int index) {
 	assert(index >= 0);
-	if (index >= lucu_vector_length(vector)) {
-		lucu_vector_push_back(vector, data);
-		return;
+	const int length = lucu_vector_length(vector);
+	lucu_vector_insert_range(vector, data, 1, index < length ? index : length);
+}
+
+int lucu_vector_spans(const LucuVector vector, LucuVectorSpan spans[2]) {
+	if (lucu_vector_is_empty(vector)) {
+		return 0;
 	}
-	if (vector->head == mod(vector->tail + 1, vector->size)) {
-		lucu_vector_increase_size(vector);
+	spans[0].data = (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth);
+	if (vector->tail > vector->head) {
+		spans[0].length = vector->tail - vector->head;
+		return 1;
 	}
-	int in = lucu_vector_local_index_to_global_index(vector, index);
-	for (int i = vector->tail; i != in; i = mod(i - 1, vector->size)) {
-		memcpy((void*)((uintptr_t)vector->v + (size_t)i * vector->bytewidth), (void*)((uintptr_t)vector->v + (size_t)mod(i - 1, vector->size) * vector->bytewidth), vector->bytewidth);
+	spans[0].length = vector->size - vector->head;
+	if (vector->tail == 0) {
+		return 1;
 	}
-	vector->tail = mod(vector->tail + 1, vector->size);
-	memcpy((void*)((uintptr_t)vector->v + (size_t)in * vector->bytewidth), data, vector->bytewidth);
+	spans[1].data = vector->v;
+	spans[1].length = vector->tail;
+	return 2;
 }
 
-void lucu_vector_iterate(LucuVector vector, bool (* const func)(void*, void*), void* const params) {
-	int i = vector->head;
-	while (i != vector->tail) {
-		if (func((void*)((uintptr_t)vector->v + (size_t)i * vector->bytewidth), params))
-			break;
-		i = mod(i + 1, vector->size);
+/**
+ * Rotates a wrapped ring so that `head` is 0.
+ *
+ * Sets the shorter of the two spans aside, slides the longer one
+ * into place and puts the shorter one back next to it.
+ * @param tmp Scratch memory with room for the shorter span.
+ * Can be `NULL` to allocate it.
+ */
+static void lucu_vector_unwrap(LucuVector vector, void* const tmp) {
+	if (vector->tail >= vector->head || vector->tail == 0) {
+		return;
 	}
-}
-
-static bool lucu_vector_filter_func(void* const data, void* const params) {
-	void** pars = (void**)params;
-	LucuVector vector = (LucuVector)pars[0];
-	bool (*filter_func)(void*, void*) = (bool (*)(void*, void*))((LucuGenericFunction*)pars[1])->f;
-	void* par = pars[2];
-	if (filter_func(data, par)) {
-		lucu_vector_push_back(vector, data);
+	const int front = vector->size - vector->head;
+	const int back = vector->tail;
+	const size_t w = vector->bytewidth;
+	void* const buffer = tmp != NULL ? tmp : lucu_allocate(&vector->allocator, (size_t)(back <= front ? back : front) * w);
+	if (back <= front) {
+		memcpy(buffer, vector->v, (size_t)back * w);
+		memmove(vector->v, (void*)((uintptr_t)vector->v + (size_t)vector->head * w), (size_t)front * w);
+		memcpy((void*)((uintptr_t)vector->v + (size_t)front * w), buffer, (size_t)back * w);
+	} else {
+		memcpy(buffer, (void*)((uintptr_t)vector->v + (size_t)vector->head * w), (size_t)front * w);
+		memmove((void*)((uintptr_t)vector->v + (size_t)front * w), vector->v, (size_t)back * w);
+		memcpy(vector->v, buffer, (size_t)front * w);
 	}
-	return false;
+	if (tmp == NULL) {
+		lucu_deallocate(&vector->allocator, buffer);
+	}
+	vector->head = 0;
+	vector->tail = front + back;
 }
 
-LucuVector lucu_vector_filter(LucuVector vector, bool (* const filter_func)(void*, void*), void* const params) {
-	LucuVector new_vector = lucu_vector_new(vector->bytewidth, vector->free_function);
-	LucuGenericFunction ff = { (void (*)(void))filter_func };
-	void* pars[] = {(void*)new_vector, (void*)&ff, params};
-	lucu_vector_iterate(vector, lucu_vector_filter_func, (void*)pars);
-	return new_vector;
+void* lucu_vector_make_contiguous(LucuVector vector) {
+	lucu_vector_unwrap(vector, NULL);
+	return (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth);
 }
 
-static bool lucu_vector_map_func(void* const data, void* const params) {
-	void** pars = (void**)params;
-	LucuVector vector = (LucuVector)pars[0];
-	void* (*map_func)(void*, void*) = (void* (*)(void*, void*))((LucuGenericFunction*)pars[1])->f;
-	void* (*map_func_return_free)(void*) = (void* (*)(void*))((LucuGenericFunction*)pars[2])->f;
-	void* par = pars[3];
-	void* mapped = map_func(data, par);
-	lucu_vector_push_back(vector, mapped);
-	if (map_func_return_free != NULL) {
-		map_func_return_free(mapped);
+void lucu_vector_iterate(LucuVector vector, bool (* const func)(void*, void*), void* const params) {
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			if (func((void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth), params)) {
+				return;
+			}
+		}
 	}
-	return false;
 }
 
-LucuVector lucu_vector_map(LucuVector vector, const size_t target_bytewidth, void (* const target_free_function)(void*), void* (* const map_func)(void*, void*), void (* const map_func_return_free)(void*), void* const params) {
-	LucuVector new_vector = lucu_vector_new(target_bytewidth, target_free_function);
-	LucuGenericFunction mf = { (void (*)(void))map_func };
-	LucuGenericFunction rf = { (void (*)(void))map_func_return_free };
-	void* pars[] = {(void*)new_vector, (void*)&mf, (void*)&rf, params};
-	lucu_vector_iterate(vector, lucu_vector_map_func, (void*)pars);
+LucuVector lucu_vector_filter(LucuVector vector, bool (* const filter_func)(void*, void*), void* const params) {
+	LucuVector new_vector = lucu_vector_new_with_allocator(LUCU_VECTOR_INIT_SIZE, vector->bytewidth, vector->free_function, &vector->allocator);
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			void* data = (void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth);
+			if (filter_func(data, params)) {
+				lucu_vector_push_back(new_vector, data);
+			}
+		}
+	}
 	return new_vector;
 }
 
-static bool lucu_vector_min_max_func(void* const data, void* const params) {
-	void** pars = (void**)params;
-	bool (*compare_func)(void*, void*, void*) = (bool (*)(void*, void*, void*))((LucuGenericFunction*)pars[0])->f;
-	void** min_max = (void**)pars[1];
-	void* par = pars[2];
-	if (compare_func(data, *min_max, par))
-		*min_max = data;
-	return false;
+LucuVector lucu_vector_map(LucuVector vector, const size_t target_bytewidth, void (* const target_free_function)(void*), void* (* const map_func)(void*, void*), void (* const map_func_return_free)(void*), void* const params) {
+	LucuVector new_vector = lucu_vector_new_with_allocator(lucu_vector_length(vector), target_bytewidth, target_free_function, &vector->allocator);
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			void* mapped = map_func((void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth), params);
+			lucu_vector_push_back(new_vector, mapped);
+			if (map_func_return_free != NULL) {
+				map_func_return_free(mapped);
+			}
+		}
+	}
+	return new_vector;
 }
 
 void* lucu_vector_min_max(LucuVector vector, bool (* const compare_func)(void*, void*, void*), void* const params) {
 	void* min_max = (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth);
-	LucuGenericFunction cf = { (void (*)(void))compare_func };
-	void* pars[] = {(void*)&cf, (void*)&min_max, params};
-	lucu_vector_iterate(vector, lucu_vector_min_max_func, (void*)pars);
+	LucuVectorSpan spans[2];
+	const int count = lucu_vector_spans(vector, spans);
+	for (int s = 0; s < count; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			void* data = (void*)((uintptr_t)spans[s].data + (size_t)i * vector->bytewidth);
+			if (compare_func(data, min_max, params)) {
+				min_max = data;
+			}
+		}
+	}
 	return min_max;
 }
 
-static void merge(LucuVector vector, const int start, const int middle, const int end, bool (*compare_function)(void*, void*, void*), void* params) {
-	LucuVector merged = lucu_vector_new(vector->bytewidth, vector->free_function);
+/**
+ * Length of the runs that are insertion sorted before merging.
+ */
+#define LUCU_VECTOR_SORT_RUN 16
+
+/**
+ * Insertion sorts `length` contiguous elements starting at `arr`.
+ *
+ * @param tmp Scratch memory with room for one element.
+ */
+static void insertion_sort(void* const arr, const int length, const size_t w, void* const tmp, bool (*compare_function)(void*, void*, void*), void* params) {
+	for (int i = 1; i < length; i++) {
+		void* const element = (void*)((uintptr_t)arr + (size_t)i * w);
+		// Only move past elements the new one should strictly come before, to stay stable.
+		if (!compare_function(element, (void*)((uintptr_t)element - w), params)) {
+			continue;
+		}
+		memcpy(tmp, element, w);
+		int j = i;
+		do {
+			j--;
+		} while (j > 0 && compare_function(tmp, (void*)((uintptr_t)arr + (size_t)(j - 1) * w), params));
+		memmove((void*)((uintptr_t)arr + (size_t)(j + 1) * w), (void*)((uintptr_t)arr + (size_t)j * w), (size_t)(i - j) * w);
+		memcpy((void*)((uintptr_t)arr + (size_t)j * w), tmp, w);
+	}
+}
+
+/**
+ * Merges the sorted runs `left` and `right` into `dst`.
+ *
+ * Takes from `right` only if its element should strictly come first,
+ * so equal elements keep their order.
+ */
+static void merge(const void* const left, const int left_length, const void* const right, const int right_length, void* const dst, const size_t w, bool (*compare_function)(void*, void*, void*), void* params) {
+	uintptr_t i = (uintptr_t)left;
+	uintptr_t j = (uintptr_t)right;
+	const uintptr_t i_end = i + (size_t)left_length * w;
+	const uintptr_t j_end = j + (size_t)right_length * w;
+	uintptr_t out = (uintptr_t)dst;
 
-	int i = start;
-	int j = middle;
+	// Already in order, which is common for partially sorted input.
+	if (left_length == 0 || right_length == 0 || !compare_function((void*)j, (void*)(i_end - w), params)) {
+		memcpy((void*)out, (void*)i, i_end - i);
+		memcpy((void*)(out + (i_end - i)), (void*)j, j_end - j);
+		return;
+	}
 
-	while (i < middle && j < end) {
-		if (compare_function(lucu_vector_get(vector, i), lucu_vector_get(vector, j), params)) {
-			lucu_vector_push(merged, lucu_vector_get(vector, i));
-			i++;
+	while (i < i_end && j < j_end) {
+		if (compare_function((void*)j, (void*)i, params)) {
+			memcpy((void*)out, (void*)j, w);
+			j += w;
 		} else {
-			lucu_vector_push(merged, lucu_vector_get(vector, j));
-			j++;
+			memcpy((void*)out, (void*)i, w);
+			i += w;
 		}
+		out += w;
+	}
+	memcpy((void*)out, (void*)i, i_end - i);
+	memcpy((void*)(out + (i_end - i)), (void*)j, j_end - j);
+}
+
+/**
+ * Stable bottom-up merge sort of `length` contiguous elements.
+ *
+ * @param scratch Memory with room for `length` elements.
+ */
+static void merge_sort(void* const arr, const int length, const size_t w, void* const scratch, bool (*compare_function)(void*, void*, void*), void* params) {
+	for (int start = 0; start < length; start += LUCU_VECTOR_SORT_RUN) {
+		const int run = length - start < LUCU_VECTOR_SORT_RUN ? length - start : LUCU_VECTOR_SORT_RUN;
+		insertion_sort((void*)((uintptr_t)arr + (size_t)start * w), run, w, scratch, compare_function, params);
 	}
 
-	while (i < middle) {
-		lucu_vector_push(merged, lucu_vector_get(vector, i));
-		i++;
+	// Merge back and forth between `arr` and `scratch`.
+	void* src = arr;
+	void* dst = scratch;
+	for (int width = LUCU_VECTOR_SORT_RUN; width < length; width *= 2) {
+		for (int start = 0; start < length; start += 2 * width) {
+			const int middle = length - start < width ? length : start + width;
+			const int end = length - start < 2 * width ? length : start + 2 * width;
+			merge((void*)((uintptr_t)src + (size_t)start * w), middle - start, (void*)((uintptr_t)src + (size_t)middle * w), end - middle, (void*)((uintptr_t)dst + (size_t)start * w), w, compare_function, params);
+		}
+		void* const t = src;
+		src = dst;
+		dst = t;
 	}
+	if (src != arr) {
+		memcpy(arr, src, (size_t)length * w);
+	}
+}
 
-	while (j < end) {
-		lucu_vector_push(merged, lucu_vector_get(vector, j));
-		j++;
+void lucu_vector_sort(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params) {
+	const int length = lucu_vector_length(vector);
+	if (length < 2) {
+		return;
 	}
+	void* scratch = lucu_allocate(&vector->allocator, (size_t)length * vector->bytewidth);
+	lucu_vector_unwrap(vector, scratch);
+	void* arr = (void*)((uintptr_t)vector->v + (size_t)vector->head * vector->bytewidth);
+	merge_sort(arr, length, vector->bytewidth, scratch, compare_function, params);
+	lucu_deallocate(&vector->allocator, scratch);
+}
 
-	const int local_head = lucu_vector_local_index_to_global_index(vector, start);
-	const int local_end = lucu_vector_local_index_to_global_index(vector, end);
+/**
+ * A piece of work for one thread of `lucu_vector_sort_parallel`.
+ *
+ * Either sorts `left` in place using `scratch`, or merges `left`
+ * and `right` into `dst` if `scratch` is `NULL`.
+ */
+typedef struct SortTask {
+	void* left;
+	int left_length;
+	void* right;
+	int right_length;
+	void* dst;
+	void* scratch;
+	size_t bytewidth;
+	bool (*compare_function)(void*, void*, void*);
+	void* params;
+} SortTask;
 
-	if (local_end >= local_head) {
-		memcpy((void*)((uintptr_t)vector->v + (size_t)local_head * vector->bytewidth), merged->v, vector->bytewidth * (size_t)lucu_vector_length(merged));
+static void* sort_task_run(void* t) {
+	SortTask* task = t;
+	if (task->scratch != NULL) {
+		merge_sort(task->left, task->left_length, task->bytewidth, task->scratch, task->compare_function, task->params);
 	} else {
-		memcpy((void*)((uintptr_t)vector->v + (size_t)local_head * vector->bytewidth), merged->v, vector->bytewidth * (size_t)(vector->size - local_head));
-		memcpy(vector->v, (void*)((uintptr_t)merged->v + (size_t)(vector->size - local_head)), vector->bytewidth * (size_t)(lucu_vector_length(merged) - (vector->size - local_head)));
+		merge(task->left, task->left_length, task->right, task->right_length, task->dst, task->bytewidth, task->compare_function, task->params);
 	}
+	return NULL;
+}
 
-	lucu_vector_destroy(merged);
+/**
+ * Runs every task, each on its own thread, and waits for them to finish.
+ *
+ * The calling thread runs the first task itself. A task whose thread
+ * can't be created is run on the calling thread as well.
+ * @param allocator Where to allocate the bookkeeping for the threads from.
+ */
+static void sort_tasks_run(SortTask* tasks, const int task_count, const LucuAllocator* allocator) {
+	pthread_t* threads = lucu_allocate(allocator, sizeof(pthread_t) * (size_t)task_count);
+	bool* started = lucu_allocate(allocator, sizeof(bool) * (size_t)task_count);
+	for (int i = 1; i < task_count; i++) {
+		started[i] = pthread_create(&threads[i], NULL, sort_task_run, &tasks[i]) == 0;
+	}
+	sort_task_run(&tasks[0]);
+	for (int i = 1; i < task_count; i++) {
+		if (started[i]) {
+			pthread_join(threads[i], NULL);
+		} else {
+			sort_task_run(&tasks[i]);
+		}
+	}
+	lucu_deallocate(allocator, started);
+	lucu_deallocate(allocator, threads);
 }
 
-static void merge_sort(LucuVector vector, const int start, const int end, bool (*compare_function)(void*, void*, void*), void* params) {
-	if (start == end) {
-		return;
-	} else if (end - start == 1) {
-		return;
-	} else if (end - start == 2) {
-		if (!compare_function(lucu_vector_get(vector, start), lucu_vector_get(vector, start + 1), params)) {
-			lucu_vector_swap(vector, start, start + 1);
+/**
+ * Finds how many of the first `k` elements of the stable merge of
+ * `left` and `right` come from `left`.
+ *
+ * Lets a single merge be split into pieces that are merged independently.
+ */
+static int merge_split(const void* const left, const int left_length, const void* const right, const int right_length, const int k, const size_t w, bool (*compare_function)(void*, void*, void*), void* params) {
+	int low = k > right_length ? k - right_length : 0;
+	int high = k < left_length ? k : left_length;
+	while (low < high) {
+		const int i = low + (high - low) / 2;
+		const int j = k - i;
+		// `left[i]` is merged before `right[j - 1]`, so more than `i` come from `left`.
+		if (!compare_function((void*)((uintptr_t)right + (size_t)(j - 1) * w), (void*)((uintptr_t)left + (size_t)i * w), params)) {
+			low = i + 1;
+		} else {
+			high = i;
+		}
+	}
+	return low;
+}
+
+void lucu_vector_sort_parallel(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params, int thread_count) {
+	const int length = lucu_vector_length(vector);
+	if (thread_count <= 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+		thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if (thread_count <= 0) {
+			thread_count = 1;
 		}
+	}
+	if (thread_count > length / LUCU_VECTOR_PARALLEL_SORT_MIN) {
+		thread_count = length / LUCU_VECTOR_PARALLEL_SORT_MIN;
+	}
+	if (thread_count < 2) {
+		lucu_vector_sort(vector, compare_function, params);
 		return;
 	}
 
-	const int middle = (end - start) / 2 + start;
+	const size_t w = vector->bytewidth;
+	void* scratch = lucu_allocate(&vector->allocator, (size_t)length * w);
+	lucu_vector_unwrap(vector, scratch);
+	void* arr = (void*)((uintptr_t)vector->v + (size_t)vector->head * w);
+	SortTask* tasks = lucu_allocate(&vector->allocator, sizeof(SortTask) * (size_t)thread_count);
+
+	// `runs[r]` is the start of run `r`, and `runs[run_count]` is `length`.
+	int* runs = lucu_allocate(&vector->allocator, sizeof(int) * (size_t)(thread_count + 1));
+	int run_count = thread_count;
+	for (int r = 0; r <= run_count; r++) {
+		runs[r] = (int)((int64_t)length * r / run_count);
+	}
+	for (int r = 0; r < run_count; r++) {
+		tasks[r] = (SortTask){
+			.left = (void*)((uintptr_t)arr + (size_t)runs[r] * w),
+			.left_length = runs[r + 1] - runs[r],
+			.scratch = (void*)((uintptr_t)scratch + (size_t)runs[r] * w),
+			.bytewidth = w,
+			.compare_function = compare_function,
+			.params = params,
+		};
+	}
+	sort_tasks_run(tasks, run_count, &vector->allocator);
+
+	// Merge pairs of runs back and forth between `arr` and `scratch`,
+	// splitting each merge so that every thread has a piece.
+	void* src = arr;
+	void* dst = scratch;
+	while (run_count > 1) {
+		const int pairs = run_count / 2;
+		const int pieces = thread_count / pairs > 1 ? thread_count / pairs : 1;
+		int task_count = 0;
+		for (int p = 0; p < pairs; p++) {
+			const int start = runs[2 * p];
+			const int middle = runs[2 * p + 1];
+			const int end = runs[2 * p + 2];
+			void* const left = (void*)((uintptr_t)src + (size_t)start * w);
+			void* const right = (void*)((uintptr_t)src + (size_t)middle * w);
+			int i = 0;
+			for (int piece = 0; piece < pieces; piece++) {
+				const int k = (int)((int64_t)(end - start) * (piece + 1) / pieces);
+				const int next_i = merge_split(left, middle - start, right, end - middle, k, w, compare_function, params);
+				const int j = (int)((int64_t)(end - start) * piece / pieces) - i;
+				tasks[task_count++] = (SortTask){
+					.left = (void*)((uintptr_t)left + (size_t)i * w),
+					.left_length = next_i - i,
+					.right = (void*)((uintptr_t)right + (size_t)j * w),
+					.right_length = k - next_i - j,
+					.dst = (void*)((uintptr_t)dst + (size_t)(start + i + j) * w),
+					.scratch = NULL,
+					.bytewidth = w,
+					.compare_function = compare_function,
+					.params = params,
+				};
+				i = next_i;
+			}
+		}
+		if (run_count % 2 == 1) {
+			// The last run has no pair, so it is only moved.
+			memcpy((void*)((uintptr_t)dst + (size_t)runs[run_count - 1] * w), (void*)((uintptr_t)src + (size_t)runs[run_count - 1] * w), (size_t)(length - runs[run_count - 1]) * w);
+		}
+		sort_tasks_run(tasks, task_count, &vector->allocator);
+
+		for (int r = 0; r < pairs; r++) {
+			runs[r] = runs[2 * r];
+		}
+		if (run_count % 2 == 1) {
+			runs[pairs] = runs[run_count - 1];
+		}
+		run_count = (run_count + 1) / 2;
+		runs[run_count] = length;
 
-	merge_sort(vector, start, middle, compare_function, params);
-	merge_sort(vector, middle, end, compare_function, params);
+		void* const t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != arr) {
+		memcpy(arr, src, (size_t)length * w);
+	}
 
-	merge(vector, start, middle, end, compare_function, params);
+	lucu_deallocate(&vector->allocator, runs);
+	lucu_deallocate(&vector->allocator, tasks);
+	lucu_deallocate(&vector->allocator, scratch);
 }
 
-void lucu_vector_sort(LucuVector vector, bool (*compare_function)(void*, void*, void*), void* params) {
-	merge_sort(vector, 0, lucu_vector_length(vector), compare_function, params);
+/**
+ * Reads the key of an element as an unsigned integer that sorts
+ * in the same order as the key.
+ */
+static inline uint64_t radix_key(const void* const element, const LucuVectorKeyType key_type, const size_t key_offset) {
+	const void* const key = (void*)((uintptr_t)element + key_offset);
+	uint32_t u32;
+	uint64_t u64;
+	switch (key_type) {
+		case LUCU_VECTOR_KEY_UINT32:
+			memcpy(&u32, key, sizeof(u32));
+			return u32;
+		case LUCU_VECTOR_KEY_INT32:
+			memcpy(&u32, key, sizeof(u32));
+			return u32 ^ UINT32_C(0x80000000);
+		case LUCU_VECTOR_KEY_UINT64:
+			memcpy(&u64, key, sizeof(u64));
+			return u64;
+		case LUCU_VECTOR_KEY_INT64:
+			memcpy(&u64, key, sizeof(u64));
+			return u64 ^ UINT64_C(0x8000000000000000);
+		case LUCU_VECTOR_KEY_FLOAT:
+			// Negative floats are ordered backwards by their bits, so flip all of them.
+			memcpy(&u32, key, sizeof(u32));
+			return u32 ^ ((u32 >> 31) ? UINT32_C(0xFFFFFFFF) : UINT32_C(0x80000000));
+		case LUCU_VECTOR_KEY_DOUBLE:
+			memcpy(&u64, key, sizeof(u64));
+			return u64 ^ ((u64 >> 63) ? UINT64_C(0xFFFFFFFFFFFFFFFF) : UINT64_C(0x8000000000000000));
+	}
+	return 0;
+}
+
+/**
+ * Vectors shorter than this are insertion sorted by `lucu_vector_sort_by_key`,
+ * since a radix sort has to clear and scan its counts whatever the length.
+ */
+#define LUCU_VECTOR_RADIX_SORT_MIN 64
+
+void lucu_vector_sort_by_key(LucuVector vector, const LucuVectorKeyType key_type, const size_t key_offset) {
+	const int length = lucu_vector_length(vector);
+	if (length < 2) {
+		return;
+	}
+	const size_t w = vector->bytewidth;
+	const int key_bytes = key_type == LUCU_VECTOR_KEY_UINT32 || key_type == LUCU_VECTOR_KEY_INT32 || key_type == LUCU_VECTOR_KEY_FLOAT ? 4 : 8;
+	assert(key_offset + (size_t)key_bytes <= w);
+
+	void* scratch = lucu_allocate(&vector->allocator, (size_t)length * w);
+	lucu_vector_unwrap(vector, scratch);
+	void* const arr = (void*)((uintptr_t)vector->v + (size_t)vector->head * w);
+
+	if (length < LUCU_VECTOR_RADIX_SORT_MIN) {
+		for (int i = 1; i < length; i++) {
+			const uint64_t key = radix_key((void*)((uintptr_t)arr + (size_t)i * w), key_type, key_offset);
+			int j = i;
+			while (j > 0 && key < radix_key((void*)((uintptr_t)arr + (size_t)(j - 1) * w), key_type, key_offset)) {
+				j--;
+			}
+			if (j != i) {
+				memcpy(scratch, (void*)((uintptr_t)arr + (size_t)i * w), w);
+				memmove((void*)((uintptr_t)arr + (size_t)(j + 1) * w), (void*)((uintptr_t)arr + (size_t)j * w), (size_t)(i - j) * w);
+				memcpy((void*)((uintptr_t)arr + (size_t)j * w), scratch, w);
+			}
+		}
+		lucu_deallocate(&vector->allocator, scratch);
+		return;
+	}
+
+	// Count every byte of the key in one pass, so each sorting pass only moves elements.
+	size_t (*counts)[256] = lucu_allocate(&vector->allocator, (size_t)key_bytes * sizeof(*counts));
+	memset(counts, 0, (size_t)key_bytes * sizeof(*counts));
+	for (int i = 0; i < length; i++) {
+		const uint64_t key = radix_key((void*)((uintptr_t)arr + (size_t)i * w), key_type, key_offset);
+		for (int b = 0; b < key_bytes; b++) {
+			counts[b][(key >> (8 * b)) & 0xFF]++;
+		}
+	}
+
+	void* src = arr;
+	void* dst = scratch;
+	for (int b = 0; b < key_bytes; b++) {
+		// Every element has the same byte here, so this pass wouldn't move anything.
+		const uint64_t first = radix_key(src, key_type, key_offset);
+		if (counts[b][(first >> (8 * b)) & 0xFF] == (size_t)length) {
+			continue;
+		}
+		size_t offset = 0;
+		for (int digit = 0; digit < 256; digit++) {
+			const size_t count = counts[b][digit];
+			counts[b][digit] = offset;
+			offset += count;
+		}
+		for (int i = 0; i < length; i++) {
+			const void* const element = (void*)((uintptr_t)src + (size_t)i * w);
+			const uint64_t key = radix_key(element, key_type, key_offset);
+			memcpy((void*)((uintptr_t)dst + counts[b][(key >> (8 * b)) & 0xFF]++ * w), element, w);
+		}
+		void* const t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != arr) {
+		memcpy(arr, src, (size_t)length * w);
+	}
+
+	lucu_deallocate(&vector->allocator, counts);
+	lucu_deallocate(&vector->allocator, scratch);
 }
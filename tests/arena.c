@@ -0,0 +1,67 @@
+#include "lucu/arena.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+Test(arena, alloc) {
+	LucuArena a = lucu_arena_new(256);
+	char* first = lucu_arena_alloc(a, 10);
+	char* second = lucu_arena_alloc(a, 10);
+	cr_assert(first != second);
+	cr_expect((uintptr_t)first % alignof(max_align_t) == 0);
+	cr_expect((uintptr_t)second % alignof(max_align_t) == 0);
+	memset(first, 1, 10);
+	memset(second, 2, 10);
+	cr_expect(first[9] == 1);
+
+	// Larger than a block.
+	char* big = lucu_arena_alloc(a, 1000);
+	memset(big, 3, 1000);
+	cr_expect(second[0] == 2);
+
+	lucu_arena_destroy(a);
+}
+
+Test(arena, reset) {
+	LucuArena a = lucu_arena_new(256);
+	void* first = lucu_arena_alloc(a, 100);
+	for (int i = 0; i < 100; i++) {
+		lucu_arena_alloc(a, 100);
+	}
+	lucu_arena_reset(a);
+	cr_expect(lucu_arena_alloc(a, 100) == first);
+	for (int i = 0; i < 100; i++) {
+		memset(lucu_arena_alloc(a, 100), 0, 100);
+	}
+	lucu_arena_destroy(a);
+}
+
+Test(arena, allocator) {
+	LucuArena a = lucu_arena_new(256);
+	LucuAllocator allocator = lucu_arena_allocator(a);
+
+	int* arr = lucu_allocate(&allocator, 4 * sizeof(int));
+	for (int i = 0; i < 4; i++) {
+		arr[i] = i;
+	}
+	// The most recent allocation grows in place.
+	int* grown = lucu_reallocate(&allocator, arr, 4 * sizeof(int), 8 * sizeof(int));
+	cr_expect(grown == arr);
+
+	void* other = lucu_allocate(&allocator, 16);
+	int* moved = lucu_reallocate(&allocator, grown, 8 * sizeof(int), 16 * sizeof(int));
+	cr_expect(moved != grown);
+	for (int i = 0; i < 4; i++) {
+		cr_expect(moved[i] == i);
+	}
+
+	// The most recent allocation is given back.
+	lucu_deallocate(&allocator, moved);
+	cr_expect(lucu_allocate(&allocator, 16) == moved);
+	lucu_deallocate(&allocator, other);
+
+	lucu_arena_destroy(a);
+}
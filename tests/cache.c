@@ -4,8 +4,15 @@
 #include <string.h>
 
 bool equal(void* key_1, void* key_2, void* p);
+size_t hash(void* key, void* p);
+size_t collide(void* key, void* p);
 void* generate(void* n);
 void generate_call_test(int n[6]);
+void fifo_test(LucuCache c);
+void* identity(void* n);
+void hashed_matches_linear_test(LucuCachePolicy policy);
+
+int identity_calls;
 
 int generate_call[6];
 
@@ -14,6 +21,17 @@ bool equal(void* key_1, void* key_2, void* p) {
 	return *(int*)key_1 == *(int*)key_2;
 }
 
+size_t hash(void* key, void* p) {
+	(void)p;
+	return (size_t)*(int*)key;
+}
+
+size_t collide(void* key, void* p) {
+	(void)key;
+	(void)p;
+	return 7;
+}
+
 void* generate(void* n) {
 	generate_call[*(int*)n]++;
 
@@ -39,15 +57,19 @@ void* generate(void* n) {
 	return NULL;
 }
 
+void* identity(void* n) {
+	identity_calls++;
+	return n;
+}
+
 void generate_call_test(int n[6]) {
 	for (int i = 0; i < 6; i++) {
 		cr_expect(generate_call[i] == n[i]);
 	}
 }
 
-Test(cache, test) {
+void fifo_test(LucuCache c) {
 	int n[6] = {0, 1, 2, 3, 4, 5};
-	LucuCache c = lucu_cache_new(4, equal, NULL, generate, NULL, NULL);
 
 	generate_call_test((int[]){0, 0, 0, 0, 0, 0});
 
@@ -173,6 +195,408 @@ Test(cache, test) {
 
 	cr_expect(strcmp(lucu_cache_get(c, &n[5]), "five") == 0);
 	generate_call_test((int[]){2, 2, 2, 1, 1, 1});
+}
+
+Test(cache, test) {
+	LucuCache c = lucu_cache_new(4, equal, NULL, generate, NULL, NULL);
+	fifo_test(c);
+	lucu_cache_destroy(c);
+}
+
+Test(cache, hashed) {
+	LucuCache c = lucu_cache_new_hashed(4, hash, equal, NULL, generate, NULL, NULL);
+	fifo_test(c);
+	lucu_cache_destroy(c);
+}
+
+Test(cache, hashed_collisions) {
+	LucuCache c = lucu_cache_new_hashed(4, collide, equal, NULL, generate, NULL, NULL);
+	fifo_test(c);
+	lucu_cache_destroy(c);
+}
+
+void hashed_matches_linear_test(LucuCachePolicy policy) {
+	int keys[300];
+	for (int i = 0; i < 300; i++) {
+		keys[i] = i;
+	}
+	LucuCache linear = lucu_cache_new_with_policy(policy, 100, NULL, equal, NULL, identity, NULL, NULL);
+	LucuCache hashed = lucu_cache_new_with_policy(policy, 100, hash, equal, NULL, identity, NULL, NULL);
+
+	unsigned int state = 1;
+	for (int i = 0; i < 10000; i++) {
+		state = state * 1103515245 + 12345;
+		int* key = &keys[(state >> 16) % 300];
+
+		identity_calls = 0;
+		cr_assert(lucu_cache_get(linear, key) == key);
+		const int linear_calls = identity_calls;
+
+		identity_calls = 0;
+		cr_assert(lucu_cache_get(hashed, key) == key);
+		cr_assert(identity_calls == linear_calls);
+	}
+
+	lucu_cache_destroy(linear);
+	lucu_cache_destroy(hashed);
+}
+
+Test(cache, hashed_matches_linear) {
+	hashed_matches_linear_test(LUCU_CACHE_FIFO);
+	hashed_matches_linear_test(LUCU_CACHE_LRU);
+	hashed_matches_linear_test(LUCU_CACHE_CLOCK);
+}
+
+Test(cache, lru) {
+	int n[6] = {0, 1, 2, 3, 4, 5};
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_LRU, 3, hash, equal, NULL, generate, NULL, NULL);
+
+	// {0, 1, 2}
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[2]), "two") == 0);
+	generate_call_test((int[]){1, 1, 1, 0, 0, 0});
+
+	// {1, 2, 0}
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	generate_call_test((int[]){1, 1, 1, 0, 0, 0});
+
+	// {2, 0, 3}
+	cr_expect(strcmp(lucu_cache_get(c, &n[3]), "three") == 0);
+	generate_call_test((int[]){1, 1, 1, 1, 0, 0});
+
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	generate_call_test((int[]){1, 1, 1, 1, 0, 0});
+
+	// {3, 0, 1}
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	generate_call_test((int[]){1, 2, 1, 1, 0, 0});
+
+	// {0, 1, 3}
+	cr_expect(strcmp(lucu_cache_get(c, &n[3]), "three") == 0);
+	generate_call_test((int[]){1, 2, 1, 1, 0, 0});
+
+	// {1, 3, 2}
+	cr_expect(strcmp(lucu_cache_get(c, &n[2]), "two") == 0);
+	generate_call_test((int[]){1, 2, 2, 1, 0, 0});
+
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[3]), "three") == 0);
+	generate_call_test((int[]){1, 2, 2, 1, 0, 0});
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, frees_keys) {
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_LRU, 4, hash, equal, NULL, identity, free, NULL);
+	for (int i = 0; i < 32; i++) {
+		int* key = malloc(sizeof(int));
+		*key = i % 6;
+		void* value = lucu_cache_get(c, key);
+		if (value != key) {
+			free(key);
+		}
+	}
+	lucu_cache_destroy(c);
+}
+
+Test(cache, clock) {
+	int n[6] = {0, 1, 2, 3, 4, 5};
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_CLOCK, 3, hash, equal, NULL, generate, NULL, NULL);
+
+	// {0, 1, 2}
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[2]), "two") == 0);
+	generate_call_test((int[]){1, 1, 1, 0, 0, 0});
+
+	// {0*, 1, 2}
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	generate_call_test((int[]){1, 1, 1, 0, 0, 0});
+
+	// {2, 0, 3}
+	cr_expect(strcmp(lucu_cache_get(c, &n[3]), "three") == 0);
+	generate_call_test((int[]){1, 1, 1, 1, 0, 0});
+
+	// {2, 0*, 3}
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	generate_call_test((int[]){1, 1, 1, 1, 0, 0});
+
+	// {0*, 3, 1}
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	generate_call_test((int[]){1, 2, 1, 1, 0, 0});
+
+	cr_expect(strcmp(lucu_cache_get(c, &n[0]), "zero") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[3]), "three") == 0);
+	cr_expect(strcmp(lucu_cache_get(c, &n[1]), "one") == 0);
+	generate_call_test((int[]){1, 2, 1, 1, 0, 0});
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, s3fifo_scan_resistant) {
+	int keys[200];
+	for (int i = 0; i < 200; i++) {
+		keys[i] = i;
+	}
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_S3FIFO, 10, hash, equal, NULL, identity, NULL, NULL);
+
+	identity_calls = 0;
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < 5; i++) {
+			cr_assert(lucu_cache_get(c, &keys[i]) == &keys[i]);
+		}
+	}
+	cr_expect(identity_calls == 5);
+
+	for (int i = 100; i < 200; i++) {
+		cr_assert(lucu_cache_get(c, &keys[i]) == &keys[i]);
+	}
+	cr_expect(identity_calls == 105);
+
+	for (int i = 0; i < 5; i++) {
+		cr_assert(lucu_cache_get(c, &keys[i]) == &keys[i]);
+	}
+	cr_expect(identity_calls == 105);
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, s3fifo_ghost) {
+	int keys[100];
+	for (int i = 0; i < 100; i++) {
+		keys[i] = i;
+	}
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_S3FIFO, 10, hash, equal, NULL, identity, NULL, NULL);
+
+	identity_calls = 0;
+	for (int i = 0; i < 20; i++) {
+		lucu_cache_get(c, &keys[i]);
+	}
+	cr_expect(identity_calls == 20);
+
+	// Key 0 was evicted from the small queue without a hit, so it is
+	// readmitted straight into the main queue and survives another scan.
+	lucu_cache_get(c, &keys[0]);
+	cr_expect(identity_calls == 21);
+	for (int i = 50; i < 100; i++) {
+		lucu_cache_get(c, &keys[i]);
+	}
+	cr_expect(identity_calls == 71);
+	lucu_cache_get(c, &keys[0]);
+	cr_expect(identity_calls == 71);
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, s3fifo_pinned_not_ghosted) {
+	int keys[50];
+	for (int i = 0; i < 50; i++) {
+		keys[i] = i;
+	}
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_S3FIFO, 10, hash, equal, NULL, identity, NULL, NULL);
+	for (int round = 0; round < 2; round++) {
+		for (int i = 0; i < 10; i++) {
+			lucu_cache_get(c, &keys[i]);
+		}
+	}
+
+	// Each new key is passed over once while pinned, which mustn't ghost it.
+	void* batch[10];
+	void* values[10];
+	for (int i = 0; i < 10; i++) {
+		batch[i] = &keys[10 + i];
+	}
+	lucu_cache_get_batch(c, batch, values, 10, NULL, NULL);
+
+	// Evict 10 from the main queue, then bring it back.
+	lucu_cache_get(c, &keys[19]);
+	lucu_cache_get(c, &keys[40]);
+	identity_calls = 0;
+	lucu_cache_get(c, &keys[10]);
+	cr_expect(identity_calls == 1);
+
+	// 10 was never evicted from the small queue, so it is readmitted
+	// there and doesn't survive a couple of new keys.
+	lucu_cache_get(c, &keys[41]);
+	lucu_cache_get(c, &keys[42]);
+	lucu_cache_get(c, &keys[10]);
+	cr_expect(identity_calls == 4);
+
+	lucu_cache_destroy(c);
+}
+
+void* counting_allocate(size_t size, void* count);
+void counting_deallocate(void* ptr, void* count);
+
+void* counting_allocate(size_t size, void* count) {
+	(*(int*)count)++;
+	return malloc(size);
+}
+
+void counting_deallocate(void* ptr, void* count) {
+	(*(int*)count)--;
+	free(ptr);
+}
+
+Test(cache, with_allocator) {
+	int count = 0;
+	const LucuAllocator allocator = { .allocate = counting_allocate, .deallocate = counting_deallocate, .params = &count };
+	int keys[100];
+	for (int i = 0; i < 100; i++) {
+		keys[i] = i;
+	}
+	LucuCache c = lucu_cache_new_with_allocator(LUCU_CACHE_S3FIFO, 10, hash, equal, NULL, identity, NULL, NULL, &allocator);
+	cr_expect(count > 0);
+	for (int i = 0; i < 100; i++) {
+		cr_expect(lucu_cache_get(c, &keys[i % 30]) == &keys[i % 30]);
+	}
+
+	lucu_cache_destroy(c);
+	cr_expect(count == 0);
+}
+
+Test(cache, stats, .disabled = !LUCU_CACHE_STATS) {
+	int n[6] = {0, 1, 2, 3, 4, 5};
+	LucuCache c = lucu_cache_new_with_policy(LUCU_CACHE_LRU, 3, hash, equal, NULL, generate, NULL, NULL);
+	LucuCacheStats stats;
+
+	// Nothing is counted until enabled.
+	lucu_cache_get(c, &n[0]);
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits == 0 && stats.misses == 0);
+
+	lucu_cache_enable_stats(c, true);
+	// {0, 1, 2}, then 0 hits and 3 evicts 1.
+	lucu_cache_get(c, &n[1]);
+	lucu_cache_get(c, &n[2]);
+	lucu_cache_get(c, &n[0]);
+	lucu_cache_get(c, &n[3]);
+	cr_expect(lucu_cache_lookup(c, &n[2], NULL));
+	cr_expect(!lucu_cache_lookup(c, &n[4], NULL));
+
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits == 2);
+	cr_expect(stats.misses == 4);
+	cr_expect(stats.evictions == 1);
+	cr_expect(stats.generate_calls == 3);
+	cr_expect(stats.probes >= stats.hits);
+	cr_expect(stats.max_probes >= 1);
+	uint64_t timed = 0;
+	for (int i = 0; i < LUCU_CACHE_LATENCY_BUCKETS; i++) {
+		timed += stats.get_latency[i];
+	}
+	// Lookups aren't timed.
+	cr_expect(timed == 4);
+
+	lucu_cache_stats_reset(c);
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits == 0 && stats.misses == 0 && stats.evictions == 0 && stats.generate_calls == 0);
+
+	lucu_cache_disable_stats(c);
+	lucu_cache_get(c, &n[5]);
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.misses == 0);
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, stats_probes_unhashed, .disabled = !LUCU_CACHE_STATS) {
+	int keys[4] = {0, 1, 2, 3};
+	LucuCache c = lucu_cache_new(4, equal, NULL, identity, NULL, NULL);
+	lucu_cache_enable_stats(c, false);
+	for (int i = 0; i < 4; i++) {
+		lucu_cache_get(c, &keys[i]);
+	}
+	// Misses compare against every stored key: 0 + 1 + 2 + 3.
+	LucuCacheStats stats;
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.probes == 6);
+	cr_expect(stats.max_probes == 3);
+	cr_expect(stats.get_latency[0] == 0);
+
+	// Finding the last key compares against all 4.
+	lucu_cache_get(c, &keys[3]);
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.probes == 10);
+	cr_expect(stats.max_probes == 4);
+
+	lucu_cache_destroy(c);
+}
+
+int batch_calls;
+int batch_generated;
+
+void identity_batch(void** keys, void** values, int length, void* params) {
+	cr_expect(params == &batch_calls);
+	batch_calls++;
+	batch_generated += length;
+	for (int i = 0; i < length; i++) {
+		values[i] = keys[i];
+	}
+}
+
+void get_batch_test(LucuCachePolicy policy, size_t (*key_hash_function)(void*, void*)) {
+	int keys[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	LucuCache c = lucu_cache_new_with_policy(policy, 4, key_hash_function, equal, NULL, identity, NULL, NULL);
+	batch_calls = 0;
+	batch_generated = 0;
+	for (int i = 0; i < 4; i++) {
+		lucu_cache_get(c, &keys[i]);
+	}
+
+	// FIFO would evict 0 for 4 if it weren't being returned.
+	int other_zero = 0;
+	void* batch[4] = {&other_zero, &keys[4], &keys[5], &keys[4]};
+	void* values[4];
+	lucu_cache_get_batch(c, batch, values, 4, identity_batch, &batch_calls);
+	cr_expect(batch_calls == 1);
+	cr_expect(batch_generated == 2);
+	cr_expect(values[0] == &keys[0]);
+	cr_expect(values[1] == &keys[4]);
+	cr_expect(values[2] == &keys[5]);
+	cr_expect(values[3] == &keys[4]);
+	for (int i = 0; i < 4; i++) {
+		cr_expect(lucu_cache_lookup(c, batch[i], NULL));
+	}
+
+	// All hits don't call the batch function, and `NULL` falls back to `generate_function`.
+	lucu_cache_get_batch(c, batch, values, 3, identity_batch, &batch_calls);
+	cr_expect(batch_calls == 1);
+	identity_calls = 0;
+	void* more[2] = {&keys[6], &keys[7]};
+	lucu_cache_get_batch(c, more, values, 2, NULL, NULL);
+	cr_expect(identity_calls == 2);
+	cr_expect(values[0] == &keys[6] && values[1] == &keys[7]);
+
+	lucu_cache_destroy(c);
+}
+
+Test(cache, get_batch) {
+	for (LucuCachePolicy policy = LUCU_CACHE_FIFO; policy <= LUCU_CACHE_S3FIFO; policy++) {
+		get_batch_test(policy, hash);
+		get_batch_test(policy, NULL);
+	}
+}
+
+Test(cache, get_batch_stats, .disabled = !LUCU_CACHE_STATS) {
+	int keys[4] = {0, 1, 2, 3};
+	LucuCache c = lucu_cache_new(4, equal, NULL, identity, NULL, NULL);
+	lucu_cache_get(c, &keys[0]);
+	lucu_cache_get(c, &keys[1]);
+	lucu_cache_enable_stats(c, false);
+
+	void* batch[4] = {&keys[1], &keys[2], &keys[0], &keys[3]};
+	void* values[4];
+	lucu_cache_get_batch(c, batch, values, 4, NULL, NULL);
+	// 1 and 0 are found after comparing against 2 and 1 keys, 2 and 3 against both.
+	LucuCacheStats stats;
+	lucu_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits == 2);
+	cr_expect(stats.misses == 2);
+	cr_expect(stats.generate_calls == 2);
+	cr_expect(stats.probes == 7);
+	cr_expect(stats.max_probes == 2);
 
 	lucu_cache_destroy(c);
 }
@@ -0,0 +1,268 @@
+#include "lucu/concurrent_cache.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define THREADS 8
+
+bool equal(void* key_1, void* key_2, void* p);
+size_t hash(void* key, void* p);
+void* generate(void* n);
+void* slow_generate(void* n);
+void* get_same_key(void* c);
+void* get_many_keys(void* c);
+void* gated_generate(void* n);
+void* get_async_many_keys(void* c);
+
+atomic_int generate_calls;
+atomic_int started;
+atomic_bool gate_open;
+int keys[1000];
+
+bool equal(void* key_1, void* key_2, void* p) {
+	(void)p;
+	return *(int*)key_1 == *(int*)key_2;
+}
+
+size_t hash(void* key, void* p) {
+	(void)p;
+	return (size_t)*(int*)key;
+}
+
+void* generate(void* n) {
+	atomic_fetch_add(&generate_calls, 1);
+	return n;
+}
+
+void* slow_generate(void* n) {
+	atomic_fetch_add(&generate_calls, 1);
+	// Don't finish until every thread has had a chance to miss on the key.
+	while (atomic_load(&started) < THREADS) {
+		sched_yield();
+	}
+	for (int i = 0; i < 1000; i++) {
+		sched_yield();
+	}
+	return n;
+}
+
+Test(concurrent_cache, get) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_LRU, 8, hash, equal, NULL, generate, NULL, NULL);
+
+	for (int i = 0; i < 8; i++) {
+		keys[i] = i;
+		cr_assert(lucu_concurrent_cache_get(c, &keys[i]) == &keys[i]);
+	}
+	cr_expect(atomic_load(&generate_calls) == 8);
+
+	lucu_concurrent_cache_destroy(c);
+}
+
+void* get_same_key(void* c) {
+	atomic_fetch_add(&started, 1);
+	return lucu_concurrent_cache_get((LucuConcurrentCache)c, &keys[0]);
+}
+
+Test(concurrent_cache, single_flight) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_FIFO, 16, hash, equal, NULL, slow_generate, NULL, NULL);
+	keys[0] = 0;
+
+	pthread_t threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, get_same_key, c);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		void* value;
+		pthread_join(threads[i], &value);
+		cr_expect(value == &keys[0]);
+	}
+	cr_expect(atomic_load(&generate_calls) == 1);
+
+	lucu_concurrent_cache_destroy(c);
+}
+
+void* get_many_keys(void* c) {
+	unsigned int state = (unsigned int)atomic_fetch_add(&started, 1) + 1;
+	for (int i = 0; i < 20000; i++) {
+		state = state * 1103515245 + 12345;
+		int* key = &keys[(state >> 16) % 1000];
+		if (lucu_concurrent_cache_get((LucuConcurrentCache)c, key) != key) {
+			return (void*)1;
+		}
+	}
+	return NULL;
+}
+
+Test(concurrent_cache, many_threads) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_S3FIFO, 200, hash, equal, NULL, generate, NULL, NULL);
+	for (int i = 0; i < 1000; i++) {
+		keys[i] = i;
+	}
+
+	pthread_t threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, get_many_keys, c);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		void* failed;
+		pthread_join(threads[i], &failed);
+		cr_expect(failed == NULL);
+	}
+
+	lucu_concurrent_cache_destroy(c);
+}
+
+Test(concurrent_cache, stats, .disabled = !LUCU_CACHE_STATS) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_LRU, 200, hash, equal, NULL, generate, NULL, NULL);
+	for (int i = 0; i < 1000; i++) {
+		keys[i] = i;
+	}
+	lucu_concurrent_cache_enable_stats(c, true);
+
+	pthread_t threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, get_many_keys, c);
+	}
+	// Scrape while the other threads are using the cache.
+	LucuCacheStats stats;
+	for (int i = 0; i < 100; i++) {
+		lucu_concurrent_cache_stats_snapshot(c, &stats);
+		sched_yield();
+	}
+	for (int i = 0; i < THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	lucu_concurrent_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits + stats.misses == THREADS * 20000);
+	cr_expect(stats.generate_calls == (uint64_t)atomic_load(&generate_calls));
+	cr_expect(stats.generate_calls <= stats.misses);
+	cr_expect(stats.evictions == stats.generate_calls - 200);
+	uint64_t timed = 0;
+	for (int i = 0; i < LUCU_CACHE_LATENCY_BUCKETS; i++) {
+		timed += stats.get_latency[i];
+	}
+	cr_expect(timed == THREADS * 20000);
+
+	lucu_concurrent_cache_stats_reset(c);
+	lucu_concurrent_cache_stats_snapshot(c, &stats);
+	cr_expect(stats.hits == 0 && stats.misses == 0 && stats.get_latency[0] == 0);
+	lucu_concurrent_cache_disable_stats(c);
+
+	lucu_concurrent_cache_destroy(c);
+}
+
+void* gated_generate(void* n) {
+	atomic_fetch_add(&generate_calls, 1);
+	// Key 0 blocks until the test opens the gate.
+	while (*(int*)n == 0 && !atomic_load(&gate_open)) {
+		sched_yield();
+	}
+	return n;
+}
+
+Test(concurrent_cache, get_async) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_LRU, 16, hash, equal, NULL, gated_generate, NULL, NULL);
+	lucu_concurrent_cache_start_workers(c, 1);
+	keys[0] = 0;
+	keys[1] = 1;
+
+	void* value;
+	LucuCacheFuture first;
+	LucuCacheFuture second;
+	cr_assert(!lucu_concurrent_cache_get_async(c, &keys[0], &value, &first));
+	// The second lookup attaches to the key that is already in flight.
+	cr_assert(!lucu_concurrent_cache_get_async(c, &keys[0], &value, &second));
+	cr_expect(first == second);
+	while (atomic_load(&generate_calls) == 0) {
+		sched_yield();
+	}
+	cr_expect(!lucu_cache_future_is_done(first));
+
+	// The only worker is stuck on key 0, so waiting on key 1 generates it here.
+	LucuCacheFuture other;
+	cr_assert(!lucu_concurrent_cache_get_async(c, &keys[1], &value, &other));
+	cr_expect(lucu_cache_future_wait(other) == &keys[1]);
+	cr_expect(!lucu_cache_future_is_done(first));
+
+	atomic_store(&gate_open, true);
+	cr_expect(lucu_cache_future_wait(first) == &keys[0]);
+	cr_expect(lucu_cache_future_is_done(second));
+	lucu_cache_future_release(second);
+	cr_expect(atomic_load(&generate_calls) == 2);
+
+	cr_expect(lucu_concurrent_cache_get_async(c, &keys[0], &value, &first));
+	cr_expect(value == &keys[0]);
+	cr_expect(lucu_concurrent_cache_get(c, &keys[1]) == &keys[1]);
+	cr_expect(atomic_load(&generate_calls) == 2);
+
+	lucu_concurrent_cache_destroy(c);
+}
+
+Test(concurrent_cache, get_async_without_workers) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(2, LUCU_CACHE_FIFO, 4, hash, equal, NULL, generate, NULL, NULL);
+	keys[3] = 3;
+	void* value = NULL;
+	LucuCacheFuture future;
+	cr_expect(lucu_concurrent_cache_get_async(c, &keys[3], &value, &future));
+	cr_expect(value == &keys[3]);
+	cr_expect(atomic_load(&generate_calls) == 1);
+	lucu_concurrent_cache_destroy(c);
+}
+
+void* get_async_many_keys(void* c) {
+	unsigned int state = (unsigned int)atomic_fetch_add(&started, 1) + 1;
+	LucuCacheFuture futures[8];
+	int* pending[8];
+	int count = 0;
+	for (int i = 0; i < 5000; i++) {
+		state = state * 1103515245 + 12345;
+		int* key = &keys[(state >> 16) % 1000];
+		void* value;
+		if (lucu_concurrent_cache_get_async((LucuConcurrentCache)c, key, &value, &futures[count])) {
+			if (value != key) {
+				return (void*)1;
+			}
+		} else {
+			pending[count++] = key;
+		}
+		if (count == 8) {
+			for (int j = 0; j < count; j++) {
+				if (j % 2 == 0) {
+					if (lucu_cache_future_wait(futures[j]) != pending[j]) {
+						return (void*)1;
+					}
+				} else {
+					lucu_cache_future_release(futures[j]);
+				}
+			}
+			count = 0;
+		}
+	}
+	for (int j = 0; j < count; j++) {
+		lucu_cache_future_release(futures[j]);
+	}
+	return NULL;
+}
+
+Test(concurrent_cache, get_async_many_threads) {
+	LucuConcurrentCache c = lucu_concurrent_cache_new(4, LUCU_CACHE_S3FIFO, 200, hash, equal, NULL, generate, NULL, NULL);
+	lucu_concurrent_cache_start_workers(c, 3);
+	for (int i = 0; i < 1000; i++) {
+		keys[i] = i;
+	}
+
+	pthread_t threads[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		pthread_create(&threads[i], NULL, i % 2 == 0 ? get_async_many_keys : get_many_keys, c);
+	}
+	for (int i = 0; i < THREADS; i++) {
+		void* failed;
+		pthread_join(threads[i], &failed);
+		cr_expect(failed == NULL);
+	}
+
+	lucu_concurrent_cache_destroy(c);
+}
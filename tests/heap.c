@@ -0,0 +1,194 @@
+#include "lucu/heap.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <stdint.h>
+
+typedef struct Node {
+	int priority;
+	/// Index of the node in the heap, kept up to date by `set_index`.
+	int index;
+} Node;
+
+bool int_less(void* a, void* b, void* p);
+bool int_greater(void* a, void* b, void* p);
+bool int_pointer_less(void* a, void* b, void* p);
+bool node_less(void* a, void* b, void* p);
+void set_index(void* node, int index, void* p);
+void free_pointer(void* p);
+int next_random(uint64_t* state);
+
+bool int_less(void* a, void* b, void* p) {
+	(void)p;
+	return *(int*)a < *(int*)b;
+}
+
+bool int_greater(void* a, void* b, void* p) {
+	(void)p;
+	return *(int*)a > *(int*)b;
+}
+
+bool int_pointer_less(void* a, void* b, void* p) {
+	(void)p;
+	return **(int**)a < **(int**)b;
+}
+
+bool node_less(void* a, void* b, void* p) {
+	(void)p;
+	return ((Node*)a)->priority < ((Node*)b)->priority;
+}
+
+void set_index(void* node, int index, void* p) {
+	(void)p;
+	((Node*)node)->index = index;
+}
+
+void free_pointer(void* p) {
+	free(*(void**)p);
+}
+
+int next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (int)(*state % 1000);
+}
+
+Test(heap, push_pop) {
+	LucuHeap h = lucu_heap_new(sizeof(int), NULL, int_less, NULL);
+	cr_assert(lucu_heap_is_empty(h));
+	cr_assert(lucu_heap_peek(h) == NULL);
+
+	uint64_t state = 12345;
+	for (int i = 0; i < 1000; i++) {
+		const int x = next_random(&state);
+		lucu_heap_push(h, &x);
+	}
+	cr_assert(lucu_heap_length(h) == 1000);
+
+	int last = -1;
+	int x;
+	for (int i = 0; i < 1000; i++) {
+		const int front = *(int*)lucu_heap_peek(h);
+		cr_assert(lucu_heap_pop_into(h, &x));
+		cr_assert(x == front);
+		cr_assert(x >= last);
+		last = x;
+	}
+	cr_assert(!lucu_heap_pop_into(h, &x));
+
+	lucu_heap_destroy(h);
+}
+
+Test(heap, interleaved) {
+	LucuHeap h = lucu_heap_new(sizeof(int), NULL, int_greater, NULL);
+	uint64_t state = 99;
+	int counts[1000] = {0};
+	int length = 0;
+
+	for (int i = 0; i < 5000; i++) {
+		if (length == 0 || next_random(&state) < 600) {
+			const int x = next_random(&state);
+			lucu_heap_push(h, &x);
+			counts[x]++;
+			length++;
+		} else {
+			int max = 999;
+			while (counts[max] == 0) {
+				max--;
+			}
+			int x;
+			cr_assert(lucu_heap_pop_into(h, &x));
+			cr_assert(x == max);
+			counts[max]--;
+			length--;
+		}
+		cr_assert(lucu_heap_length(h) == length);
+	}
+
+	lucu_heap_destroy(h);
+}
+
+Test(heap, from_vector) {
+	int arr[100];
+	for (int i = 0; i < 100; i++) {
+		arr[i] = (i * 37) % 100;
+	}
+	LucuVector v = lucu_vector_from_array(arr, 100, sizeof(int), NULL);
+	// Wrap the vector around the end of its array.
+	for (int i = 0; i < 30; i++) {
+		int x;
+		lucu_vector_pop_front_into(v, &x);
+		lucu_vector_push_back(v, &x);
+	}
+
+	LucuHeap h = lucu_heap_from_vector(v, int_less, NULL);
+	cr_assert(lucu_heap_length(h) == 100);
+	for (int i = 0; i < 100; i++) {
+		int x;
+		cr_assert(lucu_heap_pop_into(h, &x));
+		cr_assert(x == i);
+	}
+
+	lucu_heap_destroy(h);
+}
+
+Test(heap, decrease_key) {
+	Node nodes[50];
+	LucuHeap h = lucu_heap_new(sizeof(Node), NULL, node_less, NULL);
+	lucu_heap_set_index_function(h, set_index);
+	for (int i = 0; i < 50; i++) {
+		nodes[i] = (Node){100 + i, -1};
+		lucu_heap_push(h, &nodes[i]);
+	}
+	for (int i = 0; i < 50; i++) {
+		Node* node = lucu_heap_get(h, i);
+		cr_assert(node->index == i);
+	}
+
+	// Find node 40 by looking for its priority, then move it to the front.
+	int index = -1;
+	for (int i = 0; i < 50; i++) {
+		if (((Node*)lucu_heap_get(h, i))->priority == 140) {
+			index = i;
+		}
+	}
+	((Node*)lucu_heap_get(h, index))->priority = 1;
+	lucu_heap_decrease_key(h, index);
+	cr_assert(((Node*)lucu_heap_peek(h))->priority == 1);
+	cr_assert(((Node*)lucu_heap_peek(h))->index == 0);
+
+	// Move the front to the back.
+	((Node*)lucu_heap_get(h, 0))->priority = 1000;
+	lucu_heap_update(h, 0);
+	for (int i = 0; i < lucu_heap_length(h); i++) {
+		cr_assert(((Node*)lucu_heap_get(h, i))->index == i);
+	}
+
+	Node node;
+	int last = 0;
+	for (int i = 0; i < 50; i++) {
+		cr_assert(lucu_heap_pop_into(h, &node));
+		cr_assert(node.priority >= last);
+		last = node.priority;
+	}
+	cr_assert(last == 1000);
+
+	lucu_heap_destroy(h);
+}
+
+Test(heap, frees) {
+	LucuHeap h = lucu_heap_new(sizeof(int*), free_pointer, int_pointer_less, NULL);
+	for (int i = 0; i < 10; i++) {
+		int* p = malloc(sizeof(int));
+		*p = i;
+		lucu_heap_push(h, &p);
+	}
+	// Popped without `out`, freed by the heap.
+	cr_assert(lucu_heap_pop_into(h, NULL));
+	int* p;
+	cr_assert(lucu_heap_pop_into(h, &p));
+	cr_assert(*p == 1);
+	free(p);
+
+	lucu_heap_destroy(h);
+}
@@ -0,0 +1,221 @@
+#include "lucu/map.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <stdint.h>
+
+bool equal(void* key_1, void* key_2, void* p);
+size_t hash(void* key, void* p);
+size_t collide(void* key, void* p);
+void free_pointer(void* p);
+bool sum_values(void* key, void* value, void* sum);
+void* largest_allocate(size_t size, void* params);
+void largest_deallocate(void* ptr, void* params);
+
+bool equal(void* key_1, void* key_2, void* p) {
+	(void)p;
+	return *(int*)key_1 == *(int*)key_2;
+}
+
+size_t hash(void* key, void* p) {
+	(void)p;
+	return (size_t)*(int*)key;
+}
+
+size_t collide(void* key, void* p) {
+	(void)key;
+	(void)p;
+	return 7;
+}
+
+void free_pointer(void* p) {
+	free(*(void**)p);
+}
+
+bool sum_values(void* key, void* value, void* sum) {
+	(void)key;
+	*(int64_t*)sum += *(int64_t*)value;
+	return false;
+}
+
+void* largest_allocate(size_t size, void* params) {
+	size_t* const largest = params;
+	if (size > *largest) {
+		*largest = size;
+	}
+	return malloc(size);
+}
+
+void largest_deallocate(void* ptr, void* params) {
+	(void)params;
+	free(ptr);
+}
+
+Test(map, insert_get) {
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int64_t), hash, equal, NULL, NULL, NULL);
+	cr_assert(lucu_map_length(m) == 0);
+	int key = 1;
+	cr_assert(lucu_map_get(m, &key) == NULL);
+
+	for (int i = 0; i < 1000; i++) {
+		const int64_t value = (int64_t)i * 10;
+		cr_assert(lucu_map_insert(m, &i, &value));
+	}
+	cr_assert(lucu_map_length(m) == 1000);
+	for (int i = 0; i < 1000; i++) {
+		int64_t* value = lucu_map_get(m, &i);
+		cr_assert(value != NULL);
+		cr_expect(*value == (int64_t)i * 10);
+	}
+	key = 1000;
+	cr_expect(lucu_map_get(m, &key) == NULL);
+
+	// Replacing keeps the length.
+	key = 5;
+	const int64_t value = -1;
+	cr_expect(!lucu_map_insert(m, &key, &value));
+	cr_expect(lucu_map_length(m) == 1000);
+	cr_expect(*(int64_t*)lucu_map_get(m, &key) == -1);
+
+	lucu_map_destroy(m);
+}
+
+Test(map, remove) {
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int), hash, equal, NULL, NULL, NULL);
+	for (int i = 0; i < 100; i++) {
+		lucu_map_insert(m, &i, &i);
+	}
+	for (int i = 0; i < 100; i += 2) {
+		cr_assert(lucu_map_remove(m, &i));
+	}
+	int key = 0;
+	cr_expect(!lucu_map_remove(m, &key));
+	cr_assert(lucu_map_length(m) == 50);
+	for (int i = 0; i < 100; i++) {
+		cr_expect((lucu_map_get(m, &i) != NULL) == (i % 2 == 1));
+	}
+
+	key = 1;
+	int key_out;
+	int value_out;
+	cr_assert(lucu_map_remove_into(m, &key, &key_out, &value_out));
+	cr_expect(key_out == 1 && value_out == 1);
+
+	lucu_map_destroy(m);
+}
+
+Test(map, churn) {
+	// Inserting and removing keeps reusing deleted slots without growing.
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int), hash, equal, NULL, NULL, NULL);
+	lucu_map_reserve(m, 64);
+	const int capacity = lucu_map_capacity(m);
+	cr_assert(capacity >= 64);
+	for (int i = 0; i < 100000; i++) {
+		lucu_map_insert(m, &i, &i);
+		if (i >= 32) {
+			const int old = i - 32;
+			cr_assert(lucu_map_remove(m, &old));
+		}
+	}
+	cr_expect(lucu_map_length(m) == 32);
+	cr_expect(lucu_map_capacity(m) == capacity);
+	for (int i = 100000 - 32; i < 100000; i++) {
+		cr_expect(*(int*)lucu_map_get(m, &i) == i);
+	}
+
+	lucu_map_destroy(m);
+}
+
+Test(map, collisions) {
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int), collide, equal, NULL, NULL, NULL);
+	for (int i = 0; i < 200; i++) {
+		lucu_map_insert(m, &i, &i);
+	}
+	for (int i = 0; i < 200; i += 3) {
+		lucu_map_remove(m, &i);
+	}
+	for (int i = 0; i < 200; i++) {
+		int* value = lucu_map_get(m, &i);
+		if (i % 3 == 0) {
+			cr_expect(value == NULL);
+		} else {
+			cr_assert(value != NULL);
+			cr_expect(*value == i);
+		}
+	}
+
+	lucu_map_destroy(m);
+}
+
+Test(map, iterate) {
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int64_t), hash, equal, NULL, NULL, NULL);
+	int64_t expected = 0;
+	for (int i = 0; i < 300; i++) {
+		const int64_t value = i;
+		lucu_map_insert(m, &i, &value);
+		expected += i;
+	}
+
+	int64_t sum = 0;
+	lucu_map_iterate(m, sum_values, &sum);
+	cr_expect(sum == expected);
+
+	sum = 0;
+	int count = 0;
+	int position = 0;
+	void* key;
+	void* value;
+	while (lucu_map_next(m, &position, &key, &value)) {
+		cr_expect(*(int*)key == (int)*(int64_t*)value);
+		sum += *(int64_t*)value;
+		count++;
+	}
+	cr_expect(count == 300);
+	cr_expect(sum == expected);
+
+	lucu_map_clear(m);
+	cr_expect(lucu_map_length(m) == 0);
+	position = 0;
+	cr_expect(!lucu_map_next(m, &position, NULL, NULL));
+
+	lucu_map_destroy(m);
+}
+
+Test(map, frees) {
+	LucuMap m = lucu_map_new(sizeof(int), sizeof(int*), hash, equal, NULL, NULL, free_pointer);
+	for (int i = 0; i < 50; i++) {
+		int* value = malloc(sizeof(int));
+		*value = i;
+		lucu_map_insert(m, &i, &value);
+	}
+	// Replacing frees the old value.
+	int key = 3;
+	int* value = malloc(sizeof(int));
+	lucu_map_insert(m, &key, &value);
+	key = 4;
+	lucu_map_remove(m, &key);
+
+	lucu_map_destroy(m);
+}
+
+Test(map, set) {
+	LucuMap m = lucu_map_new(sizeof(int), 0, hash, equal, NULL, NULL, NULL);
+	for (int i = 0; i < 10; i++) {
+		lucu_map_insert(m, &i, NULL);
+	}
+	int key = 3;
+	cr_expect(lucu_map_get(m, &key) != NULL);
+	key = 10;
+	cr_expect(lucu_map_get(m, &key) == NULL);
+	lucu_map_destroy(m);
+
+	// Entries should only be as big as the keys, plus a control byte per slot.
+	size_t largest = 0;
+	const LucuAllocator allocator = {largest_allocate, NULL, largest_deallocate, &largest};
+	m = lucu_map_new_with_allocator(sizeof(int), 0, hash, equal, NULL, NULL, NULL, &allocator);
+	for (int i = 0; i < 1000; i++) {
+		lucu_map_insert(m, &i, NULL);
+	}
+	const size_t max_slots = (size_t)lucu_map_capacity(m) * 8 / 7 + 1;
+	cr_expect(largest <= max_slots * (sizeof(int) + 1) + 16);
+	lucu_map_destroy(m);
+}
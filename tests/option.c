@@ -34,3 +34,80 @@ Test(option, set) {
 	free(n_p);
 	lucu_option_destroy(o);
 }
+
+Test(option, large_data) {
+	int arr[32];
+	for (int i = 0; i < 32; i++) {
+		arr[i] = i;
+	}
+	LucuOption o = lucu_option_new_some(arr, sizeof(arr));
+	cr_assert(lucu_option_is_some(o));
+	cr_expect(((int*)lucu_option_get(o))[31] == 31);
+	int* arr_p = lucu_option_take(o);
+	cr_assert(!lucu_option_is_some(o));
+	cr_expect(arr_p[31] == 31);
+	free(arr_p);
+
+	lucu_option_set(o, arr, sizeof(arr));
+	int copy[32];
+	lucu_option_take_into(o, copy);
+	cr_assert(!lucu_option_is_some(o));
+	cr_expect(copy[31] == 31);
+	lucu_option_destroy(o);
+}
+
+Test(option, take_into) {
+	int n = 3;
+	LucuOption o = lucu_option_new_some(&n, sizeof(int));
+	int m = 0;
+	lucu_option_take_into(o, &m);
+	cr_assert(!lucu_option_is_some(o));
+	cr_expect(m == n);
+	lucu_option_destroy(o);
+}
+
+Test(option, init_none) {
+	LucuOptionData data;
+	LucuOption o = lucu_option_init_none(&data);
+	cr_assert(!lucu_option_is_some(o));
+	double d = 2.5;
+	lucu_option_set(o, &d, sizeof(double));
+	cr_assert(lucu_option_is_some(o));
+	cr_expect(*(double*)lucu_option_get(o) == d);
+	double e;
+	lucu_option_take_into(o, &e);
+	cr_assert(!lucu_option_is_some(o));
+	cr_expect(e == d);
+}
+
+void* counting_allocate(size_t size, void* count);
+void counting_deallocate(void* ptr, void* count);
+
+void* counting_allocate(size_t size, void* count) {
+	(*(int*)count)++;
+	return malloc(size);
+}
+
+void counting_deallocate(void* ptr, void* count) {
+	(*(int*)count)--;
+	free(ptr);
+}
+
+Test(option, with_allocator) {
+	int count = 0;
+	const LucuAllocator allocator = { .allocate = counting_allocate, .deallocate = counting_deallocate, .params = &count };
+	int n = 3;
+	LucuOption o = lucu_option_new_some_with_allocator(&n, sizeof(int), &allocator);
+	cr_expect(count == 1);
+	int* n_p = lucu_option_take(o);
+	cr_expect(count == 2);
+	cr_expect(*n_p == n);
+	lucu_deallocate(&allocator, n_p);
+
+	int arr[32] = {0};
+	lucu_option_set(o, arr, sizeof(arr));
+	cr_expect(count == 2);
+	lucu_option_take_into(o, arr);
+	lucu_option_destroy(o);
+	cr_expect(count == 0);
+}
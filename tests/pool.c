@@ -0,0 +1,62 @@
+#include "lucu/pool.h"
+#include "lucu/vector.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <string.h>
+
+Test(pool, alloc_free) {
+	LucuPool p = lucu_pool_new(24, 4);
+	void* elements[10];
+	for (int i = 0; i < 10; i++) {
+		elements[i] = lucu_pool_alloc(p);
+		memset(elements[i], i, 24);
+	}
+	for (int i = 0; i < 10; i++) {
+		for (int j = i + 1; j < 10; j++) {
+			cr_expect(elements[i] != elements[j]);
+		}
+		cr_expect(((unsigned char*)elements[i])[23] == i);
+	}
+
+	lucu_pool_free(p, elements[3]);
+	cr_expect(lucu_pool_alloc(p) == elements[3]);
+
+	lucu_pool_destroy(p);
+}
+
+Test(pool, allocator) {
+	LucuPool p = lucu_pool_new(sizeof(double), 8);
+	LucuAllocator allocator = lucu_pool_allocator(p);
+	double* d = lucu_allocate(&allocator, sizeof(double));
+	*d = 1.5;
+	lucu_deallocate(&allocator, d);
+	cr_expect(lucu_pool_alloc(p) == d);
+	lucu_pool_destroy(p);
+}
+
+Test(pool, allocator_oversize) {
+	LucuPool p = lucu_pool_new(sizeof(double), 8);
+	LucuAllocator allocator = lucu_pool_allocator(p);
+	char* big = lucu_allocate(&allocator, 100);
+	memset(big, 7, 100);
+	double* d = lucu_allocate(&allocator, sizeof(double));
+	*d = 2.5;
+	// Outgrowing an element moves it out of the pool, keeping its contents.
+	d = lucu_reallocate(&allocator, d, sizeof(double), 4 * sizeof(double));
+	cr_expect(*d == 2.5);
+	big = lucu_reallocate(&allocator, big, 100, 1000);
+	cr_expect(big[99] == 7);
+	lucu_deallocate(&allocator, big);
+	lucu_deallocate(&allocator, d);
+
+	// A vector's storage is bigger than an element, but its growth is fine.
+	LucuVector v = lucu_vector_new_with_allocator(4, sizeof(int), NULL, &allocator);
+	for (int i = 0; i < 1000; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	for (int i = 0; i < 1000; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i);
+	}
+	lucu_vector_destroy(v);
+	lucu_pool_destroy(p);
+}
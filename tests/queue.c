@@ -0,0 +1,263 @@
+#include "lucu/queue.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define ITEMS 200000
+#define THREADS 4
+
+typedef struct Record {
+	int producer;
+	int sequence;
+	int64_t payload;
+} Record;
+
+void* spsc_produce(void* q);
+void* mpmc_produce(void* q);
+void* mpmc_consume(void* q);
+
+Test(spsc_queue, fifo) {
+	LucuSpscQueue q = lucu_spsc_queue_new(5, sizeof(int));
+	cr_assert(lucu_spsc_queue_capacity(q) == 8);
+
+	int x;
+	cr_assert(!lucu_spsc_queue_dequeue(q, &x));
+	for (int i = 0; i < 8; i++) {
+		cr_assert(lucu_spsc_queue_enqueue(q, &i));
+	}
+	cr_assert(!lucu_spsc_queue_enqueue(q, &x));
+	cr_assert(lucu_spsc_queue_length(q) == 8);
+	for (int i = 0; i < 8; i++) {
+		cr_assert(lucu_spsc_queue_dequeue(q, &x));
+		cr_assert(x == i);
+	}
+	cr_assert(lucu_spsc_queue_length(q) == 0);
+
+	lucu_spsc_queue_destroy(q);
+}
+
+Test(spsc_queue, batch_wraps) {
+	LucuSpscQueue q = lucu_spsc_queue_new(8, sizeof(int));
+	int in[12];
+	int out[12];
+	int next = 0;
+	int expected = 0;
+
+	// Offset the positions so that batches wrap around the end of the array.
+	for (int round = 0; round < 10; round++) {
+		for (int i = 0; i < 12; i++) {
+			in[i] = next + i;
+		}
+		const int added = lucu_spsc_queue_enqueue_batch(q, in, 5 + round % 4);
+		cr_assert(added == 5 + round % 4);
+		next += added;
+		const int removed = lucu_spsc_queue_dequeue_batch(q, out, 3);
+		cr_assert(removed == 3);
+		for (int i = 0; i < removed; i++) {
+			cr_assert(out[i] == expected++);
+		}
+		const int rest = lucu_spsc_queue_dequeue_batch(q, out, 12);
+		cr_assert(rest == added - 3);
+		for (int i = 0; i < rest; i++) {
+			cr_assert(out[i] == expected++);
+		}
+	}
+
+	for (int i = 0; i < 12; i++) {
+		in[i] = i;
+	}
+	cr_assert(lucu_spsc_queue_enqueue_batch(q, in, 12) == 8);
+	cr_assert(lucu_spsc_queue_enqueue_batch(q, in, 1) == 0);
+	cr_assert(lucu_spsc_queue_dequeue_batch(q, out, 12) == 8);
+	for (int i = 0; i < 8; i++) {
+		cr_assert(out[i] == i);
+	}
+
+	lucu_spsc_queue_destroy(q);
+}
+
+void* spsc_produce(void* q) {
+	Record batch[7];
+	int sequence = 0;
+	while (sequence < ITEMS) {
+		int n = 0;
+		for (; n < 7 && sequence + n < ITEMS; n++) {
+			batch[n] = (Record){0, sequence + n, (int64_t)(sequence + n) * 3};
+		}
+		int sent = 0;
+		while (sent < n) {
+			// Alternate between single and batch enqueues.
+			if (sequence % 2 == 0) {
+				sent += lucu_spsc_queue_enqueue(q, &batch[sent]);
+			} else {
+				sent += lucu_spsc_queue_enqueue_batch(q, &batch[sent], n - sent);
+			}
+			if (sent < n) {
+				sched_yield();
+			}
+		}
+		sequence += n;
+	}
+	return NULL;
+}
+
+Test(spsc_queue, threads) {
+	LucuSpscQueue q = lucu_spsc_queue_new(64, sizeof(Record));
+	pthread_t producer;
+	pthread_create(&producer, NULL, spsc_produce, q);
+
+	Record out[16];
+	int expected = 0;
+	while (expected < ITEMS) {
+		const int n = lucu_spsc_queue_dequeue_batch(q, out, 16);
+		if (n == 0) {
+			sched_yield();
+		}
+		for (int i = 0; i < n; i++) {
+			cr_assert(out[i].sequence == expected);
+			cr_assert(out[i].payload == (int64_t)expected * 3);
+			expected++;
+		}
+	}
+
+	pthread_join(producer, NULL);
+	cr_assert(lucu_spsc_queue_length(q) == 0);
+	lucu_spsc_queue_destroy(q);
+}
+
+Test(mpmc_queue, fifo) {
+	LucuMpmcQueue q = lucu_mpmc_queue_new(16, sizeof(int));
+	cr_assert(lucu_mpmc_queue_capacity(q) == 16);
+
+	int x;
+	cr_assert(!lucu_mpmc_queue_dequeue(q, &x));
+	// Go around the array a few times.
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < 16; i++) {
+			cr_assert(lucu_mpmc_queue_enqueue(q, &i));
+		}
+		cr_assert(!lucu_mpmc_queue_enqueue(q, &x));
+		cr_assert(lucu_mpmc_queue_length(q) == 16);
+		for (int i = 0; i < 16; i++) {
+			cr_assert(lucu_mpmc_queue_dequeue(q, &x));
+			cr_assert(x == i);
+		}
+		cr_assert(!lucu_mpmc_queue_dequeue(q, NULL));
+	}
+
+	lucu_mpmc_queue_destroy(q);
+}
+
+Test(mpmc_queue, batch) {
+	LucuMpmcQueue q = lucu_mpmc_queue_new(8, sizeof(int));
+	int in[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	int out[10];
+
+	cr_assert(lucu_mpmc_queue_enqueue_batch(q, in, 3) == 3);
+	cr_assert(lucu_mpmc_queue_enqueue_batch(q, &in[3], 7) == 5);
+	cr_assert(lucu_mpmc_queue_enqueue_batch(q, in, 1) == 0);
+	cr_assert(lucu_mpmc_queue_dequeue_batch(q, out, 2) == 2);
+	cr_assert(out[0] == 0 && out[1] == 1);
+	cr_assert(lucu_mpmc_queue_enqueue_batch(q, &in[8], 2) == 2);
+	cr_assert(lucu_mpmc_queue_dequeue_batch(q, out, 10) == 8);
+	for (int i = 0; i < 8; i++) {
+		cr_assert(out[i] == i + 2);
+	}
+	cr_assert(lucu_mpmc_queue_dequeue_batch(q, out, 10) == 0);
+
+	lucu_mpmc_queue_destroy(q);
+}
+
+typedef struct MpmcTest {
+	LucuMpmcQueue queue;
+	int producer;
+	/// Sum of the payloads a consumer dequeued.
+	int64_t sum;
+	int count;
+} MpmcTest;
+
+atomic_int consumed;
+
+void* mpmc_produce(void* t) {
+	MpmcTest* test = t;
+	Record batch[5];
+	int sequence = 0;
+	while (sequence < ITEMS) {
+		int n = 0;
+		for (; n < 5 && sequence + n < ITEMS; n++) {
+			batch[n] = (Record){test->producer, sequence + n, sequence + n};
+		}
+		int sent = 0;
+		while (sent < n) {
+			if (test->producer % 2 == 0) {
+				sent += lucu_mpmc_queue_enqueue(test->queue, &batch[sent]);
+			} else {
+				sent += lucu_mpmc_queue_enqueue_batch(test->queue, &batch[sent], n - sent);
+			}
+			if (sent < n) {
+				sched_yield();
+			}
+		}
+		sequence += n;
+	}
+	return NULL;
+}
+
+void* mpmc_consume(void* t) {
+	MpmcTest* test = t;
+	// Every producer's records must come out in order.
+	int last[THREADS];
+	for (int i = 0; i < THREADS; i++) {
+		last[i] = -1;
+	}
+	Record out[6];
+	while (atomic_load(&consumed) < ITEMS * THREADS) {
+		const int n = test->producer % 2 == 0 ? lucu_mpmc_queue_dequeue(test->queue, out) : lucu_mpmc_queue_dequeue_batch(test->queue, out, 6);
+		if (n == 0) {
+			sched_yield();
+		}
+		for (int i = 0; i < n; i++) {
+			if (out[i].sequence <= last[out[i].producer]) {
+				test->count = -1;
+				return NULL;
+			}
+			last[out[i].producer] = out[i].sequence;
+			test->sum += out[i].payload;
+		}
+		test->count += n;
+		atomic_fetch_add(&consumed, n);
+	}
+	return NULL;
+}
+
+Test(mpmc_queue, threads) {
+	LucuMpmcQueue q = lucu_mpmc_queue_new(128, sizeof(Record));
+	pthread_t producers[THREADS];
+	pthread_t consumers[THREADS];
+	MpmcTest produce[THREADS];
+	MpmcTest consume[THREADS];
+
+	for (int i = 0; i < THREADS; i++) {
+		produce[i] = (MpmcTest){q, i, 0, 0};
+		consume[i] = (MpmcTest){q, i, 0, 0};
+		pthread_create(&producers[i], NULL, mpmc_produce, &produce[i]);
+		pthread_create(&consumers[i], NULL, mpmc_consume, &consume[i]);
+	}
+	int64_t sum = 0;
+	int count = 0;
+	for (int i = 0; i < THREADS; i++) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+		cr_assert(consume[i].count >= 0, "records from one producer came out of order");
+		sum += consume[i].sum;
+		count += consume[i].count;
+	}
+
+	cr_assert(count == ITEMS * THREADS);
+	cr_assert(sum == (int64_t)ITEMS * (ITEMS - 1) / 2 * THREADS);
+	cr_assert(lucu_mpmc_queue_length(q) == 0);
+	lucu_mpmc_queue_destroy(q);
+}
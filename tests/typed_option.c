@@ -0,0 +1,56 @@
+#include "lucu/typed_option.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+
+LUCU_OPTION_DEFINE(IntOption, int);
+
+typedef struct Point {
+	double x;
+	double y;
+} Point;
+
+LUCU_OPTION_DEFINE(PointOption, Point);
+
+IntOption find(const int* arr, int length, int n);
+
+IntOption find(const int* arr, int length, int n) {
+	for (int i = 0; i < length; i++) {
+		if (arr[i] == n) {
+			return IntOption_new_some(i);
+		}
+	}
+	return IntOption_new_none();
+}
+
+Test(typed_option, create_none) {
+	IntOption o = IntOption_new_none();
+	cr_assert(!IntOption_is_some(&o));
+}
+
+Test(typed_option, create_some) {
+	IntOption o = IntOption_new_some(3);
+	cr_assert(IntOption_is_some(&o));
+	cr_expect(*IntOption_get(&o) == 3);
+	*IntOption_get(&o) = 4;
+	cr_expect(IntOption_take(&o) == 4);
+	cr_assert(!IntOption_is_some(&o));
+}
+
+Test(typed_option, set) {
+	PointOption o = PointOption_new_none();
+	PointOption_set(&o, (Point){ .x = 1, .y = 2 });
+	cr_assert(PointOption_is_some(&o));
+	cr_expect(PointOption_get(&o)->y == 2);
+	const Point p = PointOption_take(&o);
+	cr_assert(!PointOption_is_some(&o));
+	cr_expect(p.x == 1 && p.y == 2);
+}
+
+Test(typed_option, return_value) {
+	const int arr[] = {5, 6, 7};
+	IntOption found = find(arr, 3, 7);
+	cr_assert(IntOption_is_some(&found));
+	cr_expect(IntOption_take(&found) == 2);
+	IntOption missing = find(arr, 3, 8);
+	cr_assert(!IntOption_is_some(&missing));
+}
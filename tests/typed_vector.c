@@ -0,0 +1,134 @@
+#include "lucu/typed_vector.h"
+#include "lucu/vector.h"
+#include <criterion/criterion.h>
+#include <criterion/internal/assert.h>
+
+LUCU_VECTOR_DEFINE(IntVector, int);
+
+typedef struct Point {
+	double x;
+	double y;
+} Point;
+
+LUCU_VECTOR_DEFINE(PointVector, Point);
+
+Test(typed_vector, push_get_pop) {
+	IntVector v = IntVector_new();
+	cr_assert(IntVector_is_empty(v));
+
+	for (int i = 0; i < 100; i++) {
+		IntVector_push_back(v, i);
+	}
+	cr_assert(IntVector_length(v) == 100);
+	for (int i = 0; i < 100; i++) {
+		cr_expect(*IntVector_get(v, i) == i);
+	}
+
+	int n;
+	cr_assert(IntVector_pop_front_into(v, &n) && n == 0);
+	cr_assert(IntVector_pop_back_into(v, &n) && n == 99);
+	IntVector_push_front(v, -1);
+	cr_expect(*IntVector_get(v, 0) == -1);
+	cr_expect(*IntVector_get(v, 1) == 1);
+
+	while (IntVector_pop_into(v, NULL)) {
+	}
+	cr_assert(IntVector_is_empty(v));
+	cr_assert(!IntVector_dequeue_into(v, &n));
+
+	IntVector_destroy(v);
+}
+
+Test(typed_vector, struct_elements) {
+	PointVector v = PointVector_new_with_size(4);
+	for (int i = 0; i < 10; i++) {
+		PointVector_push_back(v, (Point){ .x = i, .y = -i });
+	}
+	PointVector_swap(v, 0, 9);
+	cr_expect(PointVector_get(v, 0)->x == 9);
+	cr_expect(PointVector_get(v, 9)->y == 0);
+	PointVector_get(v, 5)->y = 100;
+	cr_expect(PointVector_get(v, 5)->y == 100);
+
+	PointVector_destroy(v);
+}
+
+Test(typed_vector, bulk) {
+	const int arr[] = {3, 4, 5};
+	const int front[] = {0, 1, 2};
+	IntVector v = IntVector_from_array(arr, 3);
+	IntVector_prepend(v, front, 3);
+	IntVector_extend(v, v);
+	IntVector_append(v, arr, 0);
+	cr_assert(IntVector_length(v) == 12);
+	for (int i = 0; i < 12; i++) {
+		cr_expect(*IntVector_get(v, i) == i % 6);
+	}
+
+	size_t size;
+	int* copy = IntVector_to_array(v, &size);
+	cr_assert(size == 12 * sizeof(int));
+	int* contiguous = IntVector_make_contiguous(v);
+	for (int i = 0; i < 12; i++) {
+		cr_expect(copy[i] == i % 6);
+		cr_expect(contiguous[i] == i % 6);
+	}
+	free(copy);
+
+	IntVector_reserve(v, 100);
+	cr_expect(IntVector_capacity(v) == 100);
+	IntVector_shrink_to_fit(v);
+	cr_expect(IntVector_capacity(v) == 12);
+
+	IntVector_destroy(v);
+}
+
+Test(typed_vector, matches_lucu_vector) {
+	IntVector typed = IntVector_new_with_size(8);
+	LucuVector untyped = lucu_vector_new_with_size(8, sizeof(int), NULL);
+
+	unsigned int state = 1;
+	for (int step = 0; step < 20000; step++) {
+		state = state * 1103515245 + 12345;
+		const int op = (int)((state >> 16) % 6);
+		const int length = lucu_vector_length(untyped);
+		const int n = (int)(state >> 8) & 0xFF;
+		int a = 0;
+		int b = 0;
+		switch (op) {
+			case 0:
+				IntVector_push_back(typed, n);
+				lucu_vector_push_back(untyped, &n);
+				break;
+			case 1:
+				IntVector_push_front(typed, n);
+				lucu_vector_push_front(untyped, &n);
+				break;
+			case 2:
+				cr_assert(IntVector_pop_front_into(typed, &a) == lucu_vector_pop_front_into(untyped, &b));
+				cr_assert(length == 0 || a == b);
+				break;
+			case 3:
+				cr_assert(IntVector_pop_back_into(typed, &a) == lucu_vector_pop_back_into(untyped, &b));
+				cr_assert(length == 0 || a == b);
+				break;
+			case 4:
+				IntVector_insert(typed, n, length == 0 ? 0 : n % length);
+				lucu_vector_insert(untyped, &n, length == 0 ? 0 : n % length);
+				break;
+			case 5:
+				if (length > 0) {
+					IntVector_remove(typed, n % length);
+					lucu_vector_remove(untyped, n % length);
+				}
+				break;
+		}
+		cr_assert(IntVector_length(typed) == lucu_vector_length(untyped));
+	}
+	for (int i = 0; i < lucu_vector_length(untyped); i++) {
+		cr_expect(*IntVector_get(typed, i) == *(int*)lucu_vector_get(untyped, i));
+	}
+
+	IntVector_destroy(typed);
+	lucu_vector_destroy(untyped);
+}
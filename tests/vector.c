@@ -1,12 +1,30 @@
 #include "lucu/vector.h"
 #include <criterion/criterion.h>
 #include <criterion/internal/assert.h>
+#include <math.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 bool int_equal(void* a, void* b, void* p);
 bool even(void* n, void* p);
 void* map(void* n, void* p);
 bool min(void* a, void* b, void* p);
 bool max(void* a, void* b, void* p);
+bool key_less(void* a, void* b, void* p);
+bool key_less_equal(void* a, void* b, void* p);
+bool uint64_less(void* a, void* b, void* p);
+bool int32_less(void* a, void* b, void* p);
+bool double_less(void* a, void* b, void* p);
+void free_int_pointer(void* p);
+void* sized_allocate(size_t size, void* live);
+void sized_deallocate(void* ptr, void* live);
+
+typedef struct Keyed {
+	int key;
+	int sequence;
+} Keyed;
 
 Test(vector, from_array) {
 	const int arr[] = {0, 1, 2, 3, 4, 5};
@@ -577,3 +595,840 @@ Test(vector, broken_array) {
 	free(arr);
 	lucu_vector_destroy(v);
 }
+
+Test(vector, pop_into) {
+	LucuVector v = lucu_vector_new(sizeof(int), NULL);
+	for (int i = 0; i < 4; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+
+	int n = -1;
+	cr_assert(lucu_vector_pop_front_into(v, &n) == true);
+	cr_expect(n == 0);
+	cr_assert(lucu_vector_pop_back_into(v, &n) == true);
+	cr_expect(n == 3);
+	cr_assert(lucu_vector_dequeue_into(v, &n) == true);
+	cr_expect(n == 1);
+	cr_assert(lucu_vector_pop_into(v, NULL) == true);
+	cr_assert(lucu_vector_is_empty(v) == true);
+
+	n = -1;
+	cr_expect(lucu_vector_pop_front_into(v, &n) == false);
+	cr_expect(lucu_vector_pop_back_into(v, &n) == false);
+	cr_expect(n == -1);
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, queue_wraps) {
+	LucuVector v = lucu_vector_new_with_size(4, sizeof(int), NULL);
+	int next = 0;
+	for (int i = 0; i < 3; i++) {
+		lucu_vector_enqueue(v, &next);
+		next++;
+	}
+
+	for (int expected = 0; expected < 100; expected++) {
+		int n;
+		cr_assert(lucu_vector_dequeue_into(v, &n) == true);
+		cr_assert(n == expected);
+		lucu_vector_enqueue(v, &next);
+		next++;
+		cr_assert(lucu_vector_length(v) == 3);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, append) {
+	LucuVector v = lucu_vector_new_with_size(4, sizeof(int), NULL);
+	const int arr[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	lucu_vector_append(v, arr, 3);
+	cr_assert(lucu_vector_length(v) == 3);
+	// Move head along so the next append wraps around the end of the ring.
+	lucu_vector_pop_front_into(v, NULL);
+	lucu_vector_pop_front_into(v, NULL);
+	lucu_vector_append(v, arr, 2);
+	lucu_vector_append(v, arr + 3, 7);
+
+	const int ref_arr[] = {2, 0, 1, 3, 4, 5, 6, 7, 8, 9};
+	cr_assert(lucu_vector_length(v) == 10);
+	for (int i = 0; i < 10; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == ref_arr[i]);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, prepend) {
+	LucuVector v = lucu_vector_new_with_size(4, sizeof(int), NULL);
+	const int arr[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+	lucu_vector_push_back(v, &arr[9]);
+	lucu_vector_prepend(v, arr + 6, 3);
+	lucu_vector_prepend(v, arr, 6);
+
+	cr_assert(lucu_vector_length(v) == 10);
+	for (int i = 0; i < 10; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, extend) {
+	LucuVector v = lucu_vector_new_with_size(8, sizeof(int), NULL);
+	LucuVector w = lucu_vector_new_with_size(8, sizeof(int), NULL);
+
+	for (int i = 0; i < 6; i++) {
+		lucu_vector_push_back(w, &i);
+	}
+	// Make `w` wrap around the end of its ring.
+	lucu_vector_pop_front_into(w, NULL);
+	lucu_vector_pop_front_into(w, NULL);
+	for (int i = 6; i < 9; i++) {
+		lucu_vector_push_back(w, &i);
+	}
+
+	lucu_vector_extend(v, w);
+	cr_assert(lucu_vector_length(v) == 7);
+	cr_assert(lucu_vector_length(w) == 7);
+	lucu_vector_extend(v, v);
+	cr_assert(lucu_vector_length(v) == 14);
+	for (int i = 0; i < 14; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i % 7 + 2);
+	}
+
+	lucu_vector_destroy(v);
+	lucu_vector_destroy(w);
+}
+
+Test(vector, reserve) {
+	LucuVector v = lucu_vector_new_with_size(4, sizeof(int), NULL);
+	cr_assert(lucu_vector_capacity(v) == 4);
+
+	for (int i = 0; i < 3; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	lucu_vector_pop_front_into(v, NULL);
+	for (int i = 3; i < 5; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+
+	lucu_vector_reserve(v, 100);
+	cr_assert(lucu_vector_capacity(v) == 100);
+	lucu_vector_reserve(v, 10);
+	cr_assert(lucu_vector_capacity(v) == 100);
+
+	cr_assert(lucu_vector_length(v) == 4);
+	for (int i = 0; i < 4; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i + 1);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, shrink_to_fit) {
+	size_t live = 0;
+	const LucuAllocator allocator = { .allocate = sized_allocate, .deallocate = sized_deallocate, .params = &live };
+	LucuVector v = lucu_vector_new_with_allocator(100000, sizeof(int), NULL, &allocator);
+	for (int i = 0; i < 10; i++) {
+		lucu_vector_push_front(v, &i);
+	}
+
+	const size_t before = live;
+	lucu_vector_shrink_to_fit(v);
+	cr_assert(lucu_vector_capacity(v) == 10);
+	cr_expect(lucu_vector_allocated_bytes(v) == 11 * sizeof(int));
+	cr_expect(live == before - 100001 * sizeof(int) + 11 * sizeof(int));
+	for (int i = 0; i < 10; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == 9 - i);
+	}
+
+	const int n = 10;
+	lucu_vector_push_back(v, &n);
+	cr_assert(lucu_vector_length(v) == 11);
+	cr_expect(*(int*)lucu_vector_get(v, 10) == 10);
+
+	lucu_vector_destroy(v);
+	cr_expect(live == 0);
+
+	// Elements in the vector's own allocation, or a buffer it was given,
+	// stay where they are since moving them would free nothing.
+	LucuVector small = lucu_vector_new_with_allocator(16, sizeof(int), NULL, &allocator);
+	lucu_vector_push_back(small, &n);
+	const size_t small_live = live;
+	lucu_vector_shrink_to_fit(small);
+	cr_expect(live == small_live);
+	cr_expect(lucu_vector_capacity(small) == 16);
+	lucu_vector_destroy(small);
+
+	int buffer[8];
+	LucuVectorData data;
+	LucuVector w = lucu_vector_init(&data, buffer, 8, sizeof(int), NULL);
+	lucu_vector_push_back(w, &n);
+	lucu_vector_shrink_to_fit(w);
+	cr_expect(lucu_vector_capacity(w) == 7);
+	cr_expect(*(int*)lucu_vector_get(w, 0) == n);
+	lucu_vector_deinit(w);
+}
+
+Test(vector, growth_factor) {
+	LucuVector v = lucu_vector_new_with_size(1, sizeof(int), NULL);
+	lucu_vector_set_growth_factor(v, 4);
+
+	for (int i = 0; i < 2; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_expect(lucu_vector_capacity(v) == 7);
+
+	for (int i = 2; i < 100; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	for (int i = 0; i < 100; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+typedef struct HookCounts {
+	size_t live_bytes;
+	int allocs;
+	int frees;
+	int grows;
+	int shrinks;
+	int last_capacity;
+} HookCounts;
+
+static void count_alloc(const LucuVector vector, size_t bytes, void* params) {
+	HookCounts* counts = params;
+	cr_expect(bytes == lucu_vector_allocated_bytes(vector));
+	counts->live_bytes += bytes;
+	counts->allocs++;
+}
+
+static void count_free(const LucuVector vector, size_t bytes, void* params) {
+	HookCounts* counts = params;
+	// Not always `lucu_vector_allocated_bytes(vector)`: a grown vector frees
+	// the storage in its own allocation when it is destroyed.
+	(void)vector;
+	cr_expect(bytes <= counts->live_bytes);
+	counts->live_bytes -= bytes;
+	counts->frees++;
+}
+
+static void count_grow(const LucuVector vector, int old_capacity, int new_capacity, size_t bytes_copied, void* params) {
+	HookCounts* counts = params;
+	cr_expect(old_capacity == counts->last_capacity);
+	cr_expect(new_capacity > old_capacity);
+	cr_expect(new_capacity == lucu_vector_capacity(vector));
+	cr_expect(bytes_copied <= (size_t)lucu_vector_length(vector) * sizeof(int));
+	counts->last_capacity = new_capacity;
+	counts->grows++;
+}
+
+static void count_shrink(const LucuVector vector, int old_capacity, int new_capacity, size_t bytes_copied, void* params) {
+	HookCounts* counts = params;
+	cr_expect(old_capacity == counts->last_capacity);
+	cr_expect(new_capacity < old_capacity);
+	cr_expect(new_capacity == lucu_vector_capacity(vector));
+	cr_expect(bytes_copied <= (size_t)lucu_vector_length(vector) * sizeof(int));
+	counts->last_capacity = new_capacity;
+	counts->shrinks++;
+}
+
+Test(vector, hooks, .disabled = !LUCU_VECTOR_HOOKS) {
+	HookCounts counts = { 0 };
+	const LucuVectorHooks hooks = {
+		.on_alloc = count_alloc,
+		.on_free = count_free,
+		.on_grow = count_grow,
+		.on_shrink = count_shrink,
+		.params = &counts,
+	};
+	lucu_vector_set_hooks(&hooks);
+
+	LucuVector v = lucu_vector_new_with_size(4, sizeof(int), NULL);
+	cr_assert(counts.allocs == 1);
+	cr_assert(counts.live_bytes == 5 * sizeof(int));
+	cr_assert(lucu_vector_bytewidth(v) == sizeof(int));
+	counts.last_capacity = lucu_vector_capacity(v);
+
+	for (int i = 0; i < 100; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_expect(counts.grows > 0);
+	// The 5 ints of storage in the vector's own allocation aren't freed yet.
+	cr_expect(counts.live_bytes == lucu_vector_allocated_bytes(v) + 5 * sizeof(int));
+	cr_expect(lucu_vector_allocated_bytes(v) >= 100 * sizeof(int));
+
+	lucu_vector_remove_range(v, 0, 90);
+	lucu_vector_shrink_to_fit(v);
+	cr_expect(counts.shrinks == 1);
+	cr_expect(counts.live_bytes == 11 * sizeof(int) + 5 * sizeof(int));
+
+	lucu_vector_destroy(v);
+	cr_expect(counts.live_bytes == 0);
+	cr_expect(counts.allocs == counts.frees);
+
+	// Buffers given to `lucu_vector_init` aren't the vector's to report.
+	int buffer[2];
+	LucuVectorData data;
+	LucuVector w = lucu_vector_init(&data, buffer, 2, sizeof(int), NULL);
+	const int allocs = counts.allocs;
+	counts.last_capacity = lucu_vector_capacity(w);
+	for (int i = 0; i < 2; i++) {
+		lucu_vector_push_back(w, &i);
+	}
+	cr_expect(counts.allocs == allocs + 1);
+	cr_expect(counts.frees == allocs);
+	lucu_vector_deinit(w);
+	cr_expect(counts.live_bytes == 0);
+
+	lucu_vector_set_hooks(NULL);
+	LucuVector u = lucu_vector_new(sizeof(int), NULL);
+	lucu_vector_destroy(u);
+	cr_expect(counts.allocs == counts.frees);
+	cr_expect(counts.live_bytes == 0);
+}
+
+Test(vector, power_of_two) {
+	LucuVector v = lucu_vector_new_power_of_two(5, sizeof(int), NULL);
+	LucuVector w = lucu_vector_new_with_size(5, sizeof(int), NULL);
+	cr_assert(lucu_vector_capacity(v) == 7);
+
+	unsigned int state = 1;
+	for (int i = 0; i < 5000; i++) {
+		state = state * 1103515245 + 12345;
+		const unsigned int r = state >> 16;
+		const int length = lucu_vector_length(w);
+		switch (r % 6) {
+			case 0:
+				lucu_vector_push_back(v, &i);
+				lucu_vector_push_back(w, &i);
+				break;
+			case 1:
+				lucu_vector_push_front(v, &i);
+				lucu_vector_push_front(w, &i);
+				break;
+			case 2:
+				lucu_vector_pop_back_into(v, NULL);
+				lucu_vector_pop_back_into(w, NULL);
+				break;
+			case 3:
+				lucu_vector_pop_front_into(v, NULL);
+				lucu_vector_pop_front_into(w, NULL);
+				break;
+			case 4:
+				lucu_vector_insert(v, &i, length == 0 ? 0 : (int)(r / 6) % length);
+				lucu_vector_insert(w, &i, length == 0 ? 0 : (int)(r / 6) % length);
+				break;
+			default:
+				if (length > 0) {
+					lucu_vector_remove(v, (int)(r / 6) % length);
+					lucu_vector_remove(w, (int)(r / 6) % length);
+				}
+				break;
+		}
+
+		cr_assert(lucu_vector_length(v) == lucu_vector_length(w));
+		for (int j = 0; j < lucu_vector_length(w); j++) {
+			cr_assert(*(int*)lucu_vector_get(v, j) == *(int*)lucu_vector_get(w, j));
+		}
+	}
+
+	const int capacity = lucu_vector_capacity(v);
+	cr_expect(((capacity + 1) & capacity) == 0);
+
+	lucu_vector_destroy(v);
+	lucu_vector_destroy(w);
+}
+
+Test(vector, insert_remove_range) {
+	// Checks random range edits against a plain array, for both kinds of
+	// vector, with the head moved around so that edits cross the wrap point.
+	for (int kind = 0; kind < 2; kind++) {
+		LucuVector v = kind == 0 ? lucu_vector_new_with_size(7, sizeof(int), NULL) : lucu_vector_new_power_of_two(7, sizeof(int), NULL);
+		int model[512];
+		int model_length = 0;
+		int arr[16];
+		uint64_t r = 0x9E3779B97F4A7C15ull;
+
+		for (int i = 0; i < 3000; i++) {
+			r ^= r << 13;
+			r ^= r >> 7;
+			r ^= r << 17;
+			const int index = model_length == 0 ? 0 : (int)((r >> 8) % (uint64_t)(model_length + 1));
+			int count = (int)((r >> 20) % 9);
+			if ((r & 3) != 0 && model_length + count < 512) {
+				for (int j = 0; j < count; j++) {
+					arr[j] = i * 16 + j;
+				}
+				lucu_vector_insert_range(v, arr, count, index);
+				memmove(&model[index + count], &model[index], sizeof(int) * (size_t)(model_length - index));
+				memcpy(&model[index], arr, sizeof(int) * (size_t)count);
+				model_length += count;
+			} else {
+				count = count < model_length - index ? count : model_length - index;
+				lucu_vector_remove_range(v, index, count);
+				memmove(&model[index], &model[index + count], sizeof(int) * (size_t)(model_length - index - count));
+				model_length -= count;
+			}
+			if ((r >> 40) % 4 == 0 && model_length > 0) {
+				// Rotate so the head moves.
+				int x;
+				lucu_vector_pop_front_into(v, &x);
+				lucu_vector_push_back(v, &x);
+				memmove(model, &model[1], sizeof(int) * (size_t)(model_length - 1));
+				model[model_length - 1] = x;
+			}
+
+			cr_assert(lucu_vector_length(v) == model_length);
+			for (int j = 0; j < model_length; j++) {
+				cr_assert(*(int*)lucu_vector_get(v, j) == model[j]);
+			}
+		}
+
+		lucu_vector_destroy(v);
+	}
+}
+
+void free_int_pointer(void* p) {
+	free(*(int**)p);
+}
+
+Test(vector, remove_range_frees) {
+	LucuVector v = lucu_vector_new(sizeof(int*), free_int_pointer);
+	for (int i = 0; i < 10; i++) {
+		int* p = malloc(sizeof(int));
+		*p = i;
+		lucu_vector_push_back(v, &p);
+	}
+	lucu_vector_remove_range(v, 2, 5);
+	cr_assert(lucu_vector_length(v) == 5);
+	const int expected[] = {0, 1, 7, 8, 9};
+	for (int i = 0; i < 5; i++) {
+		cr_assert(**(int**)lucu_vector_get(v, i) == expected[i]);
+	}
+	lucu_vector_remove_range(v, 0, 0);
+	cr_assert(lucu_vector_length(v) == 5);
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, spans) {
+	LucuVector v = lucu_vector_new_with_size(8, sizeof(int), NULL);
+	LucuVectorSpan spans[2];
+	cr_assert(lucu_vector_spans(v, spans) == 0);
+
+	for (int i = 0; i < 6; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_assert(lucu_vector_spans(v, spans) == 1);
+	cr_expect(spans[0].length == 6);
+	cr_expect(((int*)spans[0].data)[5] == 5);
+
+	for (int i = 0; i < 4; i++) {
+		lucu_vector_pop_front_into(v, NULL);
+	}
+	for (int i = 6; i < 11; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_assert(lucu_vector_spans(v, spans) == 2);
+	cr_assert(spans[0].length + spans[1].length == 7);
+	int expected = 4;
+	for (int s = 0; s < 2; s++) {
+		for (int i = 0; i < spans[s].length; i++) {
+			cr_expect(((int*)spans[s].data)[i] == expected);
+			expected++;
+		}
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, make_contiguous) {
+	for (int popped = 1; popped < 8; popped++) {
+		LucuVector v = lucu_vector_new_with_size(8, sizeof(int), NULL);
+		for (int i = 0; i < 8; i++) {
+			lucu_vector_push_back(v, &i);
+		}
+		for (int i = 0; i < popped; i++) {
+			lucu_vector_pop_front_into(v, NULL);
+		}
+		for (int i = 8; i < 8 + popped; i++) {
+			lucu_vector_push_back(v, &i);
+		}
+
+		int* arr = lucu_vector_make_contiguous(v);
+		LucuVectorSpan spans[2];
+		cr_assert(lucu_vector_spans(v, spans) == 1);
+		cr_assert(spans[0].data == arr);
+		cr_assert(spans[0].length == 8);
+		for (int i = 0; i < 8; i++) {
+			cr_expect(arr[i] == popped + i);
+		}
+
+		lucu_vector_destroy(v);
+	}
+}
+
+bool key_less(void* a, void* b, void* p) {
+	(void)p;
+	return ((Keyed*)a)->key < ((Keyed*)b)->key;
+}
+
+Test(vector, sort_stable) {
+	const int lengths[] = {0, 1, 2, 15, 16, 17, 33, 100, 1000};
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		const int length = lengths[l];
+		LucuVector v = lucu_vector_new_with_size(length, sizeof(Keyed), NULL);
+		// Wrap the vector around the end of its allocation.
+		for (int i = 0; i < length / 2; i++) {
+			const Keyed k = { .key = 0, .sequence = -1 };
+			lucu_vector_push_back(v, &k);
+		}
+		for (int i = 0; i < length / 2; i++) {
+			lucu_vector_pop_front_into(v, NULL);
+		}
+		unsigned int state = 12345;
+		for (int i = 0; i < length; i++) {
+			state = state * 1103515245 + 12345;
+			const Keyed k = { .key = (int)((state >> 16) % 10), .sequence = i };
+			lucu_vector_push_back(v, &k);
+		}
+
+		lucu_vector_sort(v, key_less, NULL);
+		cr_assert(lucu_vector_length(v) == length);
+		for (int i = 1; i < length; i++) {
+			const Keyed* a = lucu_vector_get(v, i - 1);
+			const Keyed* b = lucu_vector_get(v, i);
+			cr_expect(a->key < b->key || (a->key == b->key && a->sequence < b->sequence));
+		}
+
+		lucu_vector_destroy(v);
+	}
+}
+
+Test(vector, sort_parallel) {
+	const int thread_counts[] = {0, 1, 2, 3, 4, 7};
+	const int length = 50000;
+	for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+		LucuVector v = lucu_vector_new_with_size(length, sizeof(Keyed), NULL);
+		for (int i = 0; i < 1000; i++) {
+			const Keyed k = { .key = 0, .sequence = -1 };
+			lucu_vector_push_back(v, &k);
+		}
+		for (int i = 0; i < 1000; i++) {
+			lucu_vector_pop_front_into(v, NULL);
+		}
+		unsigned int state = 12345;
+		for (int i = 0; i < length; i++) {
+			state = state * 1103515245 + 12345;
+			const Keyed k = { .key = (int)((state >> 16) % 100), .sequence = i };
+			lucu_vector_push_back(v, &k);
+		}
+
+		lucu_vector_sort_parallel(v, key_less, NULL, thread_counts[t]);
+		cr_assert(lucu_vector_length(v) == length);
+		for (int i = 1; i < length; i++) {
+			const Keyed* a = lucu_vector_get(v, i - 1);
+			const Keyed* b = lucu_vector_get(v, i);
+			cr_expect(a->key < b->key || (a->key == b->key && a->sequence < b->sequence));
+		}
+
+		lucu_vector_destroy(v);
+	}
+}
+
+bool key_less_equal(void* a, void* b, void* p) {
+	(void)p;
+	return ((Keyed*)a)->key <= ((Keyed*)b)->key;
+}
+
+// A `<=` comparison isn't stable, but must still sort every element.
+Test(vector, sort_less_equal) {
+	const int thread_counts[] = {-1, 1, 2, 3};
+	const int length = 20000;
+	for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+		LucuVector v = lucu_vector_new_with_size(length, sizeof(Keyed), NULL);
+		unsigned int state = 12345;
+		for (int i = 0; i < length; i++) {
+			state = state * 1103515245 + 12345;
+			const Keyed k = { .key = (int)((state >> 16) % 10), .sequence = i };
+			lucu_vector_push_back(v, &k);
+		}
+
+		if (thread_counts[t] < 0) {
+			lucu_vector_sort(v, key_less_equal, NULL);
+		} else {
+			lucu_vector_sort_parallel(v, key_less_equal, NULL, thread_counts[t]);
+		}
+		cr_assert(lucu_vector_length(v) == length);
+		bool* const seen = calloc((size_t)length, sizeof(bool));
+		for (int i = 0; i < length; i++) {
+			const Keyed* b = lucu_vector_get(v, i);
+			cr_assert(b->sequence >= 0 && b->sequence < length && !seen[b->sequence]);
+			seen[b->sequence] = true;
+			if (i > 0) {
+				const Keyed* a = lucu_vector_get(v, i - 1);
+				cr_expect(a->key <= b->key);
+			}
+		}
+		free(seen);
+
+		lucu_vector_destroy(v);
+	}
+}
+
+bool uint64_less(void* a, void* b, void* p) {
+	(void)p;
+	return *(uint64_t*)a < *(uint64_t*)b;
+}
+
+bool int32_less(void* a, void* b, void* p) {
+	(void)p;
+	return *(int32_t*)a < *(int32_t*)b;
+}
+
+bool double_less(void* a, void* b, void* p) {
+	(void)p;
+	return *(double*)a < *(double*)b;
+}
+
+Test(vector, sort_by_key) {
+	const int lengths[] = {1, 10, 63, 64, 1000};
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		const int length = lengths[l];
+		LucuVector u = lucu_vector_new(sizeof(uint64_t), NULL);
+		LucuVector i = lucu_vector_new(sizeof(int32_t), NULL);
+		LucuVector d = lucu_vector_new(sizeof(double), NULL);
+		uint64_t state = 88172645463325252ull;
+		for (int n = 0; n < length; n++) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			lucu_vector_push_back(u, &state);
+			const int32_t i32 = (int32_t)(state >> 40) - (1 << 23);
+			lucu_vector_push_back(i, &i32);
+			const double f = (double)i32 / 3.0;
+			lucu_vector_push_back(d, &f);
+		}
+		LucuVector u_expected = lucu_vector_from_array(lucu_vector_make_contiguous(u), length, sizeof(uint64_t), NULL);
+		LucuVector i_expected = lucu_vector_from_array(lucu_vector_make_contiguous(i), length, sizeof(int32_t), NULL);
+		LucuVector d_expected = lucu_vector_from_array(lucu_vector_make_contiguous(d), length, sizeof(double), NULL);
+
+		lucu_vector_sort_by_key(u, LUCU_VECTOR_KEY_UINT64, 0);
+		lucu_vector_sort_by_key(i, LUCU_VECTOR_KEY_INT32, 0);
+		lucu_vector_sort_by_key(d, LUCU_VECTOR_KEY_DOUBLE, 0);
+		lucu_vector_sort(u_expected, uint64_less, NULL);
+		lucu_vector_sort(i_expected, int32_less, NULL);
+		lucu_vector_sort(d_expected, double_less, NULL);
+		for (int n = 0; n < length; n++) {
+			cr_expect(*(uint64_t*)lucu_vector_get(u, n) == *(uint64_t*)lucu_vector_get(u_expected, n));
+			cr_expect(*(int32_t*)lucu_vector_get(i, n) == *(int32_t*)lucu_vector_get(i_expected, n));
+			cr_expect(*(double*)lucu_vector_get(d, n) == *(double*)lucu_vector_get(d_expected, n));
+		}
+
+		lucu_vector_destroy(u);
+		lucu_vector_destroy(i);
+		lucu_vector_destroy(d);
+		lucu_vector_destroy(u_expected);
+		lucu_vector_destroy(i_expected);
+		lucu_vector_destroy(d_expected);
+	}
+}
+
+Test(vector, sort_by_key_float_order) {
+	const float arr[] = {1.0f, -0.0f, -INFINITY, 0.0f, -2.5f, INFINITY, 2.5f, -1.0f};
+	const float expected[] = {-INFINITY, -2.5f, -1.0f, -0.0f, 0.0f, 1.0f, 2.5f, INFINITY};
+
+	LucuVector v = lucu_vector_from_array(arr, 8, sizeof(float), NULL);
+	lucu_vector_sort_by_key(v, LUCU_VECTOR_KEY_FLOAT, 0);
+	for (int i = 0; i < 8; i++) {
+		const float f = *(float*)lucu_vector_get(v, i);
+		cr_expect(f == expected[i] && signbit(f) == signbit(expected[i]));
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, sort_by_key_stable) {
+	LucuVector v = lucu_vector_new_with_size(1000, sizeof(Keyed), NULL);
+	// Wrap the vector around the end of its allocation.
+	for (int i = 0; i < 500; i++) {
+		const Keyed k = { .key = 0, .sequence = -1 };
+		lucu_vector_push_back(v, &k);
+	}
+	for (int i = 0; i < 500; i++) {
+		lucu_vector_pop_front_into(v, NULL);
+	}
+	unsigned int state = 12345;
+	for (int i = 0; i < 1000; i++) {
+		state = state * 1103515245 + 12345;
+		const Keyed k = { .key = (int)((state >> 16) % 20) - 10, .sequence = i };
+		lucu_vector_push_back(v, &k);
+	}
+
+	lucu_vector_sort_by_key(v, LUCU_VECTOR_KEY_INT32, offsetof(Keyed, key));
+	for (int i = 1; i < 1000; i++) {
+		const Keyed* a = lucu_vector_get(v, i - 1);
+		const Keyed* b = lucu_vector_get(v, i);
+		cr_expect(a->key < b->key || (a->key == b->key && a->sequence < b->sequence));
+	}
+
+	lucu_vector_destroy(v);
+}
+
+Test(vector, init) {
+	LucuVectorData data;
+	int buffer[8];
+	LucuVector v = lucu_vector_init(&data, buffer, 8, sizeof(int), NULL);
+	cr_assert(lucu_vector_capacity(v) == 7);
+
+	for (int i = 0; i < 7; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_expect(v->v == buffer);
+	// Outgrows the buffer.
+	for (int i = 7; i < 100; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_expect(v->v != buffer);
+	for (int i = 0; i < 100; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i);
+	}
+
+	lucu_vector_deinit(v);
+}
+
+Test(vector, init_wrapped) {
+	LucuVectorData data;
+	int buffer[4];
+	LucuVector v = lucu_vector_init(&data, buffer, 4, sizeof(int), NULL);
+	for (int i = 0; i < 3; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	lucu_vector_pop_front_into(v, NULL);
+	lucu_vector_pop_front_into(v, NULL);
+	for (int i = 3; i < 10; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	cr_assert(lucu_vector_length(v) == 8);
+	for (int i = 0; i < 8; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i + 2);
+	}
+
+	lucu_vector_deinit(v);
+}
+
+void* counting_allocate(size_t size, void* count);
+void counting_deallocate(void* ptr, void* count);
+
+void* counting_allocate(size_t size, void* count) {
+	(*(int*)count)++;
+	return malloc(size);
+}
+
+void counting_deallocate(void* ptr, void* count) {
+	(*(int*)count)--;
+	free(ptr);
+}
+
+Test(vector, with_allocator) {
+	int count = 0;
+	const LucuAllocator allocator = { .allocate = counting_allocate, .deallocate = counting_deallocate, .params = &count };
+	LucuVector v = lucu_vector_new_with_allocator(4, sizeof(int), NULL, &allocator);
+	cr_assert(count == 1);
+	for (int i = 0; i < 100; i++) {
+		const int n = 99 - i;
+		lucu_vector_push_back(v, &n);
+	}
+	lucu_vector_sort(v, min, NULL);
+	LucuVector evens = lucu_vector_filter(v, even, NULL);
+	cr_expect(count > 2);
+	for (int i = 0; i < 100; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i);
+	}
+
+	lucu_vector_destroy(evens);
+	lucu_vector_destroy(v);
+	cr_expect(count == 0);
+}
+
+void* tally_allocate(size_t size, void* calls);
+void tally_deallocate(void* ptr, void* calls);
+
+void* tally_allocate(size_t size, void* calls) {
+	(*(int*)calls)++;
+	return malloc(size);
+}
+
+void tally_deallocate(void* ptr, void* calls) {
+	(void)calls;
+	free(ptr);
+}
+
+Test(vector, sort_with_allocator) {
+	int calls = 0;
+	const LucuAllocator allocator = { .allocate = tally_allocate, .deallocate = tally_deallocate, .params = &calls };
+	const int length = 10000;
+	LucuVector v = lucu_vector_new_with_allocator(length, sizeof(int), NULL, &allocator);
+	for (int i = 0; i < length; i++) {
+		const int n = length - i;
+		lucu_vector_push_back(v, &n);
+	}
+
+	// Scratch space, the tasks, the runs, and a thread list and start flags per round of merging.
+	calls = 0;
+	lucu_vector_sort_parallel(v, min, NULL, 4);
+	cr_expect(calls >= 5);
+	// Scratch space and the counts.
+	calls = 0;
+	lucu_vector_sort_by_key(v, LUCU_VECTOR_KEY_INT32, 0);
+	cr_expect(calls == 2);
+	for (int i = 0; i < length; i++) {
+		cr_expect(*(int*)lucu_vector_get(v, i) == i + 1);
+	}
+
+	lucu_vector_destroy(v);
+}
+
+// Keeps the number of live bytes in `live`, storing each size in front of its allocation.
+void* sized_allocate(size_t size, void* live) {
+	*(size_t*)live += size;
+	max_align_t* block = malloc(sizeof(max_align_t) + size);
+	*(size_t*)block = size;
+	return block + 1;
+}
+
+void sized_deallocate(void* ptr, void* live) {
+	max_align_t* block = (max_align_t*)ptr - 1;
+	*(size_t*)live -= *(size_t*)block;
+	free(block);
+}
+
+Test(vector, live_bytes_after_growth) {
+	size_t live = 0;
+	const LucuAllocator allocator = { .allocate = sized_allocate, .deallocate = sized_deallocate, .params = &live };
+	const int length = 1 << 20;
+	LucuVector v = lucu_vector_new_with_allocator(length, sizeof(int), NULL, &allocator);
+	for (int i = 0; i <= length; i++) {
+		lucu_vector_push_back(v, &i);
+	}
+	// Only the grown storage and the vector itself are still allocated.
+	cr_expect(live == lucu_vector_allocated_bytes(v) + sizeof(LucuVectorData));
+	lucu_vector_destroy(v);
+	cr_expect(live == 0);
+
+	// Small vectors share one allocation, which is all that is left over after growing.
+	LucuVector w = lucu_vector_new_with_allocator(4, sizeof(int), NULL, &allocator);
+	for (int i = 0; i < 100; i++) {
+		lucu_vector_push_back(w, &i);
+	}
+	cr_expect(live <= lucu_vector_allocated_bytes(w) + sizeof(LucuVectorData) + 256 + alignof(max_align_t));
+	lucu_vector_destroy(w);
+	cr_expect(live == 0);
+}